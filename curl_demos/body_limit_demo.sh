@@ -0,0 +1,4 @@
+#!/bin/zsh
+
+# The body is past the 1 KiB `max_body_size`, so the server answers 413 and closes.
+curl -i -X POST --output - http://localhost:8080/ -H "Content-Type: text/plain" -H "Connection: close" --data-binary "$(printf 'a%.0s' {1..2048})" || echo "\033[1;32mDemo is DONE\033[0m";
@@ -0,0 +1,5 @@
+#!/bin/zsh
+
+etag=$(curl -sI http://localhost:8080/ -H "Connection: close" | grep -i '^etag:' | cut -d' ' -f2 | tr -d '\r')
+
+curl -i -X GET --output - http://localhost:8080/ -H "If-None-Match: ${etag}" -H "Content-Length: 0" -H "Connection: close" || echo "\033[1;32mDemo is DONE\033[0m";
@@ -0,0 +1,3 @@
+#!/bin/zsh
+
+curl -v -X GET --compressed --output - http://localhost:8080/ -H "Accept-Encoding: gzip, deflate;q=0.5" -H "Content-Length: 0" -H "Connection: close" || echo "\033[1;32mDemo is DONE\033[0m";
@@ -0,0 +1,3 @@
+#!/bin/zsh
+
+curl -i -X GET --output - http://localhost:8080/now -H "Content-Length: 0" -H "Connection: close" && curl -i -X GET --output - http://localhost:8080/now -H "Content-Length: 0" -H "Connection: close" || echo "\033[1;32mDemo is DONE\033[0m";
@@ -0,0 +1,3 @@
+#!/bin/zsh
+
+curl -i -X GET --output - http://localhost:8080/index.js -H "Content-Length: 0" -H "Connection: close" && curl -i --path-as-is -X GET --output - http://localhost:8080/../src/main.cpp -H "Content-Length: 0" -H "Connection: close" || echo "\033[1;32mDemo is DONE\033[0m";
@@ -0,0 +1,4 @@
+#!/bin/zsh
+
+# Shows the handler executor's queue depth, runs and steals next to the memory budget, for tuning the I/O and worker split.
+curl -i --output - http://localhost:8080/stats -H "Connection: close" || echo "\033[1;32mDemo is DONE\033[0m";
@@ -0,0 +1,71 @@
+#ifndef DERKHTTPD_MYAPP_CONNECTION_POOL_HPP
+#define DERKHTTPD_MYAPP_CONNECTION_POOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "myhttp/intake.hpp"
+#include "myhttp/outtake.hpp"
+
+namespace DerkHttpd::App {
+    /// NOTE: What a connection reuses across its exchanges: the parser and its buffers, the serializer, and the arena for each request's headers and URI. It never moves, as the arena points into it.
+    struct ConnectionState {
+        static constexpr std::size_t arena_size = 16384;
+
+        alignas(std::max_align_t) std::array<std::byte, arena_size> arena_bytes;
+        std::pmr::monotonic_buffer_resource arena; // spills to the default heap when a request outgrows `arena_bytes`
+        Http::HttpIntake intake;
+        Http::HttpOuttake outtake;
+
+        /// NOTE: Charges its own size to `Net::MemoryBudget` for as long as it lives.
+        explicit ConnectionState(Http::IntakeConfig intake_config);
+        ~ConnectionState();
+
+        ConnectionState(const ConnectionState&) = delete;
+        ConnectionState& operator=(const ConnectionState&) = delete;
+        ConnectionState(ConnectionState&&) = delete;
+        ConnectionState& operator=(ConnectionState&&) = delete;
+
+        /// NOTE: Rewinds the arena to its own bytes, freeing everything the last exchange allocated, so it must only run between exchanges.
+        void rewind_arena() noexcept;
+
+        /// NOTE: Drops whatever the last exchange still held, for the next client that checks this state out.
+        void reset() noexcept;
+    };
+
+    /**
+     * @brief Keeps the `ConnectionState` of every connection, indexed by its fd. States are made up front, bound to a client on accept and put back on close without being freed, so connection churn only allocates once more clients are open at once than the pool was sized for. Only the reactor thread may check states in or out, see `Net::SessionPool`.
+     */
+    class ConnectionPool {
+    public:
+        using Session = ConnectionState;
+
+    private:
+        Http::IntakeConfig m_intake_config;
+        std::vector<std::unique_ptr<ConnectionState>> m_idle; // capacity covers every state made, so returning one never allocates
+        std::vector<std::unique_ptr<ConnectionState>> m_active; // indexed by client fd
+        std::size_t m_total_n;
+
+    public:
+        explicit ConnectionPool(std::size_t idle_n, Http::IntakeConfig intake_config);
+
+        ConnectionPool(const ConnectionPool&) = delete;
+        ConnectionPool& operator=(const ConnectionPool&) = delete;
+        ConnectionPool(ConnectionPool&&) = delete;
+        ConnectionPool& operator=(ConnectionPool&&) = delete;
+
+        /// NOTE: Binds an idle state to a newly accepted `fd`, making a new one only if every state is taken.
+        void checkout(int fd);
+
+        /// NOTE: Returns the state of a closing `fd` to the idle list.
+        void checkin(int fd) noexcept;
+
+        /// NOTE: `fd` must be checked out.
+        [[nodiscard]] auto session_of(int fd) noexcept -> ConnectionState&;
+    };
+}
+
+#endif
@@ -1,32 +1,107 @@
 #ifndef DERKHTTPD_MYAPP_CONTENTS_HPP
 #define DERKHTTPD_MYAPP_CONTENTS_HPP
 
+#include <cstdint>
+#include <string>
 #include <string_view>
 #include <optional>
 #include <filesystem>
-#include <fstream>
+#include <future>
+#include <memory>
+#include <variant>
 
 #include "myhttp/msgs.hpp"
 
 namespace DerkHttpd::App {
-    class TextIterator : public ChunkIterBase {
+    /// NOTE: Holds the metadata that identifies one version of a file, gathered without opening it.
+    struct FileIdentity {
+        std::uintmax_t inode;
+        std::uintmax_t size;
+        std::filesystem::file_time_type modify_time;
+
+        [[nodiscard]] friend auto operator==(const FileIdentity&, const FileIdentity&) noexcept -> bool = default;
+    };
+
+    [[nodiscard]] auto stat_file_identity(const std::filesystem::path& path) noexcept -> std::optional<FileIdentity>;
+
+    /// NOTE: Reads a file's byte span by positional reads, so no prefix bytes are read and discarded.
+    [[nodiscard]] auto read_file_region(const Http::FileRegion& region) -> std::optional<Http::Blob>;
+
+    /// NOTE: Like `read_file_region` for an already open file. A short read (e.g a truncated file) is an error.
+    [[nodiscard]] auto read_file_at(int fd, std::uintmax_t offset, std::size_t length) -> std::optional<Http::Blob>;
+
+    /// NOTE: Owns an open file descriptor, closing it on destruction.
+    class FileHandle {
     private:
-        std::ifstream m_ifstream_p;
-        std::size_t m_chunk_len;
+        int m_fd;
 
     public:
-        TextIterator(std::ifstream fs_p, std::size_t chunk_len) noexcept;
+        constexpr FileHandle() noexcept
+        : m_fd {-1} {}
+
+        explicit FileHandle(int fd) noexcept;
+        ~FileHandle();
+
+        FileHandle(const FileHandle&) = delete;
+        FileHandle& operator=(const FileHandle&) = delete;
+        FileHandle(FileHandle&& other) noexcept;
+        FileHandle& operator=(FileHandle&& other) noexcept;
+
+        [[nodiscard]] constexpr auto get() const noexcept -> int {
+            return m_fd;
+        }
+
+        [[nodiscard]] constexpr auto is_open() const noexcept -> bool {
+            return m_fd != -1;
+        }
+    };
+
+    /// NOTE: Gets the same metadata as `stat_file_identity` from an already open file, which avoids a second path lookup.
+    [[nodiscard]] auto fstat_file_identity(int fd) noexcept -> std::optional<FileIdentity>;
+
+    /// NOTE: Generates chunks of a known-size file span in pre-sized `pread` blocks, so any bytes (not just text) pass through unchanged. Each block is read on the `FileIOPool` one step ahead of the sender, with sequential readahead hints for the kernel.
+    class FileBlockIterator : public ChunkIterBase {
+    private:
+        std::shared_ptr<const FileHandle> m_file;
+        std::future<std::optional<Http::Blob>> m_pending_block;
+        std::uintmax_t m_next_offset; // where the next unrequested block starts
+        std::uintmax_t m_unrequested_n;
+        std::size_t m_block_len;
+        bool m_wakes_reactor; // without a completion signal, a stalled stream would never resume, so `is_ready` must not report stalls
+
+        void request_next_block();
+
+    public:
+        FileBlockIterator(FileHandle file, std::uintmax_t offset, std::uintmax_t length, std::size_t block_len);
 
         [[nodiscard]] auto next() -> std::optional<Http::Blob> override;
 
         /// NOTE: This should only be used for clearing a chunked payload before responding to a `HEAD` request.
         void clear() override;
+
+        [[nodiscard]] auto is_ready() const -> bool override;
+    };
+
+    struct CachedFile;
+
+    /// NOTE: Slices chunks out of a `FileCache` snapshot, which stays alive for as long as this iterator does.
+    class CachedFileIterator : public ChunkIterBase {
+    private:
+        std::shared_ptr<const CachedFile> m_file;
+        std::size_t m_pos;
+        std::size_t m_chunk_len;
+
+    public:
+        CachedFileIterator(std::shared_ptr<const CachedFile> file, std::size_t chunk_len) noexcept;
+
+        [[nodiscard]] auto next() -> std::optional<Http::Blob> override;
+
+        void clear() override;
     };
 
-    // Implements the `ResourceKind` requirements for a human-readable file's content.
+    // Implements the `ResourceKind` requirements for a human-readable file's content. Its content is served from `FileCache` when possible, so the file is only opened on a cache miss.
     class TextualFile {
     private:
-        std::ifstream m_data;
         std::filesystem::path m_path;
         std::string_view m_mime;
         std::size_t m_chunk_len;
@@ -45,16 +120,53 @@ namespace DerkHttpd::App {
         [[nodiscard]] auto as_full_blob() noexcept -> Http::Blob;
 
         [[nodiscard]] auto get_modify_time() -> std::filesystem::file_time_type;
+
+        [[nodiscard]] auto get_path() const noexcept -> const std::filesystem::path&;
     };
 
+    // Implements the `ResourceKind` requirements for any file, e.g images and fonts. The file is opened and `fstat`-ed once on creation, and its bytes are read in large `pread` blocks.
+    class BinaryFile {
+    private:
+        FileHandle m_file;
+        std::filesystem::path m_path;
+        FileIdentity m_identity;
+        std::string_view m_mime;
+        std::size_t m_block_len;
+
+        BinaryFile(FileHandle file, std::filesystem::path path, FileIdentity identity, std::string_view mime, std::size_t block_n) noexcept;
+
+    public:
+        static constexpr std::size_t default_block_len = 64 * 1024;
+
+        /// NOTE: Gives `std::nullopt` if the path cannot be opened or is not a regular file.
+        [[nodiscard]] static auto create(std::filesystem::path path, std::string_view mime_identifier, std::size_t block_n = default_block_len) noexcept -> std::optional<BinaryFile>;
+
+        [[nodiscard]] constexpr auto get_mime_desc() const noexcept -> std::string_view {
+            return m_mime;
+        }
+
+        /// NOTE: Destructive like `TextualFile::as_chunk_iter`, as the open file moves into the chunk generator.
+        [[nodiscard]] auto as_chunk_iter() noexcept -> ChunkIterPtr;
+
+        /// NOTE: Consumes the open file like `as_chunk_iter`, so it only works on an rvalue.
+        [[nodiscard]] auto as_full_blob() && noexcept -> Http::Blob;
+
+        [[nodiscard]] auto get_identity() const noexcept -> const FileIdentity&;
+
+        [[nodiscard]] auto get_path() const noexcept -> const std::filesystem::path&;
+    };
+
+    /// NOTE: Holds a generated payload in a form the response body can take over without a copy: a `Http::Blob` passes through untouched, e.g an echoed request body, and an owned `std::string` is shared as a `Http::SharedBytes`. Only text passed by view is copied.
     class StringReply {
     private:
-        std::string m_data;
+        std::variant<Http::Blob, std::string> m_data;
         std::string_view m_mime;
     
     public:
-        StringReply(std::string s, std::string_view mime) noexcept;
-        StringReply(Http::Blob&& b, std::string_view mime);
+        StringReply(std::string_view s, std::string_view mime);
+        StringReply(const char* s, std::string_view mime);
+        StringReply(std::string&& s, std::string_view mime) noexcept;
+        StringReply(Http::Blob&& b, std::string_view mime) noexcept;
 
         [[nodiscard]] constexpr auto get_mime_desc() const noexcept -> std::string_view {
             return m_mime;
@@ -64,7 +176,13 @@ namespace DerkHttpd::App {
             return nullptr;
         }
 
-        [[nodiscard]] auto as_full_blob() noexcept -> Http::Blob;
+        [[nodiscard]] auto as_full_blob() const& -> Http::Blob;
+
+        /// NOTE: Moves a `Http::Blob` payload out, but must copy an owned string's bytes, so prefer `as_body` when filling a response.
+        [[nodiscard]] auto as_full_blob() && -> Http::Blob;
+
+        /// NOTE: Moves the payload out as it is held, leaving this reply empty.
+        [[nodiscard]] auto as_body() && -> std::variant<Http::Blob, Http::SharedBytes>;
     };
 
     class EmptyReply {
@@ -0,0 +1,68 @@
+#ifndef DERKHTTPD_MYAPP_EMBEDDED_ASSETS_HPP
+#define DERKHTTPD_MYAPP_EMBEDDED_ASSETS_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "myhttp/enums.hpp"
+#include "myhttp/msgs.hpp"
+
+namespace DerkHttpd::App {
+    /// NOTE: One file packed into the binary by the `pack_assets` build step. Every view refers to constant data of the generated bundle.
+    struct EmbeddedAsset {
+        std::string_view path; // URI path, e.g `/index.html`
+        std::string_view mime;
+        std::string_view etag;
+        std::string_view last_modified; // preformatted like `get_date_string()`
+        std::int64_t modify_epoch_s;
+        std::string_view identity;
+        std::array<std::string_view, Http::scoped_enum_len<Http::ContentCoding>()> coded_variants; // empty for codings that would not shrink the asset
+    };
+
+    /// NOTE: Gives the bundle's assets sorted by path. Without `DERKHTTPD_EMBED_ASSETS`, the bundle is empty.
+    [[nodiscard]] auto embedded_asset_index() noexcept -> std::span<const EmbeddedAsset>;
+
+    /// NOTE: Binary searches the sorted index, giving `nullptr` for an unknown path.
+    [[nodiscard]] auto find_embedded_asset(std::string_view uri_path) noexcept -> const EmbeddedAsset*;
+
+    /// NOTE: Slices chunks out of an embedded asset for chunked transfers.
+    class EmbeddedChunkIterator : public ChunkIterBase {
+    private:
+        std::string_view m_rest;
+        std::size_t m_chunk_len;
+
+    public:
+        EmbeddedChunkIterator(std::string_view bytes, std::size_t chunk_len) noexcept;
+
+        [[nodiscard]] auto next() -> std::optional<Http::Blob> override;
+
+        void clear() override;
+    };
+
+    // Implements the `ResourceKind` requirements for an embedded asset. Creating and serving one does no I/O, as its bytes, validators and precompressed variants were all made at build time.
+    class EmbeddedFile {
+    private:
+        const EmbeddedAsset* m_asset;
+        std::size_t m_chunk_len;
+
+        EmbeddedFile(const EmbeddedAsset* asset, std::size_t chunk_n) noexcept;
+
+    public:
+        [[nodiscard]] static auto create(std::string_view uri_path, std::size_t chunk_n) noexcept -> std::optional<EmbeddedFile>;
+
+        [[nodiscard]] constexpr auto get_mime_desc() const noexcept -> std::string_view {
+            return m_asset->mime;
+        }
+
+        [[nodiscard]] auto as_chunk_iter() noexcept -> ChunkIterPtr;
+
+        [[nodiscard]] auto as_full_blob() noexcept -> Http::Blob;
+
+        [[nodiscard]] auto get_asset() const noexcept -> const EmbeddedAsset&;
+    };
+}
+
+#endif
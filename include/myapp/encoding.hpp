@@ -0,0 +1,96 @@
+#ifndef DERKHTTPD_MYAPP_ENCODING_HPP
+#define DERKHTTPD_MYAPP_ENCODING_HPP
+
+#include <array>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <filesystem>
+#include <functional>
+#include <map>
+
+#include "myhttp/enums.hpp"
+#include "myhttp/msgs.hpp"
+
+namespace DerkHttpd::App {
+    struct EncodeConfig {
+        int level = 6; // compression level passed to zlib / zstd
+        std::size_t min_size = 256; // smaller full payloads are sent as `identity` since the coding overhead outweighs the savings
+    };
+
+    /// NOTE: Picks the most preferred coding by the client's q-values from an `Accept-Encoding` value, breaking ties by server preference. Gives `std::nullopt` when every coding, `identity` included, is refused.
+    [[nodiscard]] auto negotiate_content_coding(std::string_view accept_encoding) noexcept -> std::optional<Http::ContentCoding>;
+
+    /// NOTE: Only textual MIME types are worth compressing, as most binary formats are already compressed.
+    [[nodiscard]] auto is_compressible_mime(std::string_view mime) noexcept -> bool;
+
+    /// NOTE: Compresses a whole payload at once, giving `std::nullopt` on an unsupported coding or codec failure.
+    [[nodiscard]] auto encode_blob(std::string_view bytes, Http::ContentCoding coding, int level) -> std::optional<Http::Blob>;
+
+    [[nodiscard]] auto encode_blob(const Http::Blob& blob, Http::ContentCoding coding, int level) -> std::optional<Http::Blob>;
+
+    /// NOTE: Wraps the zlib / zstd stream state, so it is only visible to encoding.cpp.
+    class StreamEncoder;
+
+    /// NOTE: Compresses another chunk generator's output on the fly for chunked transfers.
+    class EncodingChunkIter : public ChunkIterBase {
+    private:
+        ChunkIterPtr m_source;
+        std::unique_ptr<StreamEncoder> m_encoder;
+        bool m_done;
+
+    public:
+        EncodingChunkIter(ChunkIterPtr source, Http::ContentCoding coding, int level);
+        ~EncodingChunkIter() override;
+
+        [[nodiscard]] auto next() -> std::optional<Http::Blob> override;
+
+        void clear() override;
+
+        [[nodiscard]] auto is_ready() const -> bool override;
+    };
+
+    /**
+     * @brief Side cache of precompressed `TextualFile` variants: each coding of a file is compressed once per modification time, and later responses for that file share the stored bytes. Like `FileCache`, it is bounded by a byte budget with LRU eviction by file, and its variants are charged to `Net::MemoryBudget`, so new ones are only stored while memory is to spare.
+     */
+    class EncodedVariantCache {
+    private:
+        struct Entry {
+            std::filesystem::file_time_type modify_time;
+            std::array<std::optional<Http::SharedBytes>, Http::scoped_enum_len<Http::ContentCoding>()> variants;
+            std::list<std::filesystem::path>::iterator lru_it;
+            std::size_t byte_n; // across all stored variants
+        };
+
+        std::mutex m_entries_mtx;
+        std::map<std::filesystem::path, Entry> m_entries;
+        std::list<std::filesystem::path> m_lru_origins; // most recently used first
+        std::size_t m_byte_budget;
+        std::size_t m_used_bytes;
+
+        EncodedVariantCache() noexcept;
+
+        /// NOTE: Assumes `m_entries_mtx` is held.
+        void drop_entry(std::map<std::filesystem::path, Entry>::iterator entry_it) noexcept;
+
+    public:
+        static constexpr std::size_t default_byte_budget = 16 * 1024 * 1024;
+
+        [[nodiscard]] static auto instance() noexcept -> EncodedVariantCache&;
+
+        EncodedVariantCache(const EncodedVariantCache&) = delete;
+        EncodedVariantCache& operator=(const EncodedVariantCache&) = delete;
+        EncodedVariantCache(EncodedVariantCache&&) = delete;
+        EncodedVariantCache& operator=(EncodedVariantCache&&) = delete;
+
+        /// NOTE: Shrinking the budget evicts least recently used files right away.
+        void set_byte_budget(std::size_t byte_budget);
+
+        /// NOTE: Only calls `load_identity` for the file's uncompressed bytes on a miss, so warm variants never touch the disk. A variant that is not stored, being over a quarter of the budget or short of memory, is still given for this response.
+        [[nodiscard]] auto fetch(const std::filesystem::path& origin, std::filesystem::file_time_type modify_time, Http::ContentCoding coding, int level, const std::function<std::optional<Http::Blob>()>& load_identity) -> std::optional<Http::SharedBytes>;
+    };
+}
+
+#endif
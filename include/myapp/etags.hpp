@@ -0,0 +1,21 @@
+#ifndef DERKHTTPD_MYAPP_ETAGS_HPP
+#define DERKHTTPD_MYAPP_ETAGS_HPP
+
+#include <string>
+#include <string_view>
+
+#include "myhttp/enums.hpp"
+#include "myapp/contents.hpp"
+
+namespace DerkHttpd::App {
+    /// NOTE: Makes a strong entity tag from a file's inode, size and nanosecond modify time, so no file content is hashed and same-second edits still change it.
+    [[nodiscard]] auto make_entity_tag(const FileIdentity& identity) -> std::string;
+
+    /// NOTE: Content-coded representations need their own strong tag, e.g `"abc"` becomes `"abc-gzip"`.
+    [[nodiscard]] auto make_coded_entity_tag(std::string_view etag, Http::ContentCoding coding) -> std::string;
+
+    /// NOTE: Checks an `If-Match` / `If-None-Match` / `If-Range` list against `etag`. The strong comparison rejects weak tags and needs the exact opaque tag, while the weak one only compares opaque tags and also lets coded variants of `etag` match.
+    [[nodiscard]] auto match_entity_tag(std::string_view candidates, std::string_view etag, bool strong) noexcept -> bool;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef DERKHTTPD_MYAPP_FILE_CACHE_HPP
+#define DERKHTTPD_MYAPP_FILE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "myhttp/msgs.hpp"
+#include "myapp/contents.hpp"
+
+namespace DerkHttpd::App {
+    /// NOTE: An immutable snapshot of one file version, shared by every response that serves it.
+    struct CachedFile {
+        Http::SharedBytes bytes; // responses take refcounted views of these instead of copies
+        FileIdentity identity;
+        std::string etag;
+        std::string_view mime; // see `ResourceKind`: must be a string literal
+    };
+
+    using CachedFilePtr = std::shared_ptr<const CachedFile>;
+
+    /**
+     * @brief Hot static file cache keyed by normalized path, bounded by a byte budget with LRU eviction. On Linux, entries are dropped by an inotify watcher thread as soon as their file changes, so hits never `stat` the file. Elsewhere, a hit compares the file's modify time instead. Entries are also charged to `Net::MemoryBudget`, and new ones are skipped while it runs low.
+     */
+    class FileCache {
+    private:
+        struct Slot {
+            CachedFilePtr file;
+            std::list<std::string>::iterator lru_it;
+            int watch_desc;
+        };
+
+        /// NOTE: What an inotify watch belongs to. Every event bumps `change_n`, so a load that began before it can tell its bytes may be stale.
+        struct WatchedKey {
+            std::string key;
+            std::uint64_t change_n;
+        };
+
+        std::mutex m_slots_mtx;
+        std::unordered_map<std::string, Slot> m_slots;
+        std::unordered_map<int, WatchedKey> m_watched_keys; // inotify watch descriptor -> slot key, registered before a miss reads the file
+        std::list<std::string> m_lru_keys; // most recently used first
+        std::size_t m_byte_budget;
+        std::size_t m_used_bytes;
+        int m_notify_fd;
+        std::jthread m_watcher;
+
+        FileCache();
+
+        /// NOTE: Assumes `m_slots_mtx` is held.
+        void drop_slot(std::unordered_map<std::string, Slot>::iterator slot_it);
+
+        /// NOTE: Assumes `m_slots_mtx` is held. Removes the watch of a load that stored nothing, unless an entry for `slot_key` still relies on it.
+        void release_load_watch(int watch_desc, const std::string& slot_key);
+
+        void watch_changes(std::stop_token stop_tk);
+
+    public:
+        static constexpr std::size_t default_byte_budget = 32 * 1024 * 1024;
+
+        [[nodiscard]] static auto instance() -> FileCache&;
+
+        ~FileCache();
+
+        FileCache(const FileCache&) = delete;
+        FileCache& operator=(const FileCache&) = delete;
+        FileCache(FileCache&&) = delete;
+        FileCache& operator=(FileCache&&) = delete;
+
+        /// NOTE: Shrinking the budget evicts least recently used entries right away.
+        void set_byte_budget(std::size_t byte_budget);
+
+        /// NOTE: Gives `nullptr` when the file is missing or too large to be worth caching (over a quarter of the budget), so the caller should send it from disk.
+        [[nodiscard]] auto fetch(const std::filesystem::path& path, std::string_view mime) -> CachedFilePtr;
+
+        void invalidate(const std::filesystem::path& path);
+    };
+}
+
+#endif
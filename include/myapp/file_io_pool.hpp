@@ -0,0 +1,59 @@
+#ifndef DERKHTTPD_MYAPP_FILE_IO_POOL_HPP
+#define DERKHTTPD_MYAPP_FILE_IO_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "mynet/wake_signal.hpp"
+#include "myhttp/msgs.hpp"
+#include "myapp/contents.hpp"
+
+namespace DerkHttpd::App {
+    /**
+     * @brief Dedicated threads for blocking disk reads, so a cold page cache never stalls a thread that is sending to clients. Each finished job pokes the reactor's `Net::WakeSignal`, which re-arms the connections whose streams were waiting on it.
+     */
+    class FileIOPool {
+    private:
+        using Job = std::move_only_function<void()>;
+
+        std::mutex m_jobs_mtx;
+        std::condition_variable_any m_jobs_cv;
+        std::deque<Job> m_jobs;
+        std::shared_ptr<Net::WakeSignal> m_completion_signal;
+        std::vector<std::jthread> m_workers;
+
+        FileIOPool();
+
+        void run_jobs(std::stop_token stop_tk);
+
+    public:
+        static constexpr std::size_t default_worker_n = 2;
+
+        [[nodiscard]] static auto instance() -> FileIOPool&;
+
+        ~FileIOPool();
+
+        FileIOPool(const FileIOPool&) = delete;
+        FileIOPool& operator=(const FileIOPool&) = delete;
+        FileIOPool(FileIOPool&&) = delete;
+        FileIOPool& operator=(FileIOPool&&) = delete;
+
+        /// NOTE: Should be set before serving, as jobs finished without a signal cannot wake the reactor.
+        void set_completion_signal(std::shared_ptr<Net::WakeSignal> completion_signal);
+
+        [[nodiscard]] auto has_completion_signal() -> bool;
+
+        /// NOTE: Reads `length` bytes of `file` at `offset` on a pool thread. The shared handle keeps the fd open until the read is done, even if the requester is gone by then.
+        [[nodiscard]] auto read_async(std::shared_ptr<const FileHandle> file, std::uintmax_t offset, std::size_t length) -> std::future<std::optional<Http::Blob>>;
+    };
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef DERKHTTPD_MYAPP_FILTERS_HPP
+#define DERKHTTPD_MYAPP_FILTERS_HPP
+
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "myhttp/msgs.hpp"
+#include "myapp/small_function.hpp"
+
+namespace DerkHttpd::App {
+    class FilterNext;
+
+    /// NOTE: Type-erased filter stage. A filter may edit the request, answer it by itself, or call `next` and edit the response it gives.
+    using FilterBox = SmallFunction<Http::Response(Http::Request&, FilterNext)>;
+
+    /**
+     * @brief Continuation of a filter chain: calling it runs the remaining stages and then the chain's terminal, e.g routing. It only holds views, so passing it by value costs a few pointer copies.
+     */
+    class FilterNext {
+    public:
+        using Terminal = auto (*)(const void* context, Http::Request& req) -> Http::Response;
+
+    private:
+        std::span<const FilterBox> m_rest;
+        Terminal m_terminal;
+        const void* m_context;
+
+    public:
+        constexpr FilterNext(std::span<const FilterBox> rest, Terminal terminal, const void* context) noexcept
+        : m_rest {rest}, m_terminal {terminal}, m_context {context} {}
+
+        auto operator()(Http::Request& req) const -> Http::Response {
+            if (m_rest.empty()) {
+                return m_terminal(m_context, req);
+            }
+
+            return m_rest.front()(req, FilterNext {m_rest.subspan(1), m_terminal, m_context});
+        }
+    };
+
+    template <typename F>
+    concept RequestFilter = std::is_nothrow_move_constructible_v<F> && std::is_invocable_r_v<Http::Response, const F&, Http::Request&, FilterNext>;
+
+    /**
+     * @brief Statically typed run of filters that acts as one filter, so its stages call each other directly instead of through one `FilterBox` each. Stateless filters take no space, so a whole chain usually fits into a single `FilterBox`.
+     */
+    template <RequestFilter ... Filters>
+    class StaticFilterChain {
+    private:
+        struct StageContext {
+            const StaticFilterChain* chain;
+            const FilterNext* outer_next;
+        };
+
+        [[no_unique_address]] std::tuple<Filters...> m_filters;
+
+        template <std::size_t Stage>
+        [[nodiscard]] static auto run_stage(const void* context, Http::Request& req) -> Http::Response {
+            const auto& [chain_p, outer_next_p] = *static_cast<const StageContext*>(context);
+
+            if constexpr (Stage == sizeof...(Filters)) {
+                return (*outer_next_p)(req);
+            } else {
+                return std::get<Stage>(chain_p->m_filters)(req, FilterNext {{}, &run_stage<Stage + 1>, context});
+            }
+        }
+
+    public:
+        constexpr explicit StaticFilterChain(Filters ... filters) noexcept
+        : m_filters {std::move(filters)...} {}
+
+        auto operator()(Http::Request& req, FilterNext next) const -> Http::Response {
+            const StageContext context {.chain = this, .outer_next = &next};
+
+            return run_stage<0>(&context, req);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef DERKHTTPD_MYAPP_HANDLER_EXECUTOR_HPP
+#define DERKHTTPD_MYAPP_HANDLER_EXECUTOR_HPP
+
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace DerkHttpd::App {
+    /// NOTE: A snapshot of `HandlerExecutor` counters for tuning how many threads do I/O versus handler work. A deep queue means too few workers, and many steals mean skewed submissions.
+    struct ExecutorStats {
+        std::size_t worker_n;
+        std::size_t queued_n; // jobs waiting across every worker's deque
+        std::size_t run_n; // jobs finished since startup
+        std::size_t steal_n; // jobs a worker took from another worker's deque
+    };
+
+    /**
+     * @brief Work-stealing pool that runs route handlers on a fixed set of workers, so CPU-heavy handlers never outnumber the cores. `MsgExchangeTask` posts each parsed request here and the job reports its finished exchange to the reactor, so I/O tasks never wait on handlers. Each worker owns a deque: it runs its newest job first, and when empty it steals the oldest job of another worker, so one burst of slow handlers cannot leave the other workers idle. Jobs from outside the pool are spread round-robin over the deques, while jobs that a handler submits go to its own worker's deque.
+     */
+    class HandlerExecutor {
+    private:
+        using Job = std::move_only_function<void()>;
+
+        struct WorkerQueue {
+            std::mutex jobs_mtx;
+            std::deque<Job> jobs; // the owner pops the back, thieves take the front
+            std::atomic<std::size_t> run_n {0};
+            std::atomic<std::size_t> steal_n {0};
+        };
+
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+        std::mutex m_idle_mtx;
+        std::condition_variable_any m_idle_cv;
+        std::atomic<std::size_t> m_queued_n;
+        std::atomic<std::size_t> m_next_queue_idx;
+        std::vector<std::jthread> m_workers; // declared last, so they stop before the queues go away
+
+        void push_job(Job job);
+
+        [[nodiscard]] auto pop_own(std::size_t worker_idx) -> std::optional<Job>;
+
+        /// NOTE: Visits the other workers starting after `thief_idx`, so thieves do not all pile onto the first deque.
+        [[nodiscard]] auto steal(std::size_t thief_idx) -> std::optional<Job>;
+
+        void run_jobs(std::stop_token stop_tk, std::size_t worker_idx);
+
+    public:
+        /// NOTE: Gives the hardware thread count, but at least 2.
+        [[nodiscard]] static auto default_worker_n() noexcept -> std::size_t;
+
+        explicit HandlerExecutor(std::size_t worker_n = default_worker_n());
+        ~HandlerExecutor();
+
+        HandlerExecutor(const HandlerExecutor&) = delete;
+        HandlerExecutor& operator=(const HandlerExecutor&) = delete;
+        HandlerExecutor(HandlerExecutor&&) = delete;
+        HandlerExecutor& operator=(HandlerExecutor&&) = delete;
+
+        /// NOTE: Runs `fn` on a worker. Its result or exception comes back through the future, and jobs still queued at shutdown leave a broken promise.
+        template <std::invocable Fn>
+        [[nodiscard]] auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>> {
+            std::packaged_task<std::invoke_result_t<Fn>()> task {std::forward<Fn>(fn)};
+            auto task_result = task.get_future();
+
+            push_job([task = std::move(task)]() mutable {
+                task();
+            });
+
+            return task_result;
+        }
+
+        /// NOTE: Runs `fn` on a worker without a future, for jobs that report their own outcome. `fn` must not throw, and jobs still queued at shutdown are dropped unrun.
+        template <std::invocable Fn>
+        void post(Fn&& fn) {
+            push_job(Job {std::forward<Fn>(fn)});
+        }
+
+        [[nodiscard]] auto get_stats() const noexcept -> ExecutorStats;
+    };
+}
+
+#endif
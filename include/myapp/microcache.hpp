@@ -0,0 +1,63 @@
+#ifndef DERKHTTPD_MYAPP_MICROCACHE_HPP
+#define DERKHTTPD_MYAPP_MICROCACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "myhttp/msgs.hpp"
+#include "myuri/uri.hpp"
+
+namespace DerkHttpd::App {
+    struct MicrocachePolicy {
+        std::chrono::milliseconds ttl = std::chrono::seconds {1}; // upper bound on freshness, a response's own `max-age` can only shorten it
+        std::vector<std::string> vary_headers {}; // request headers that select different responses, e.g `Accept-Language`
+        std::size_t max_entries = 1024;
+    };
+
+    /**
+     * @brief Opt-in response cache for one dynamic route. Entries are keyed by method, path, sorted query and the policy's `Vary` headers, and live for the policy's TTL or the response's `Cache-Control` lifetime. On a miss, concurrent identical requests share one handler run instead of each calling it.
+     */
+    class ResponseMicrocache {
+    public:
+        using Handler = std::function<Http::Response(Http::Request&, const Uri::QueryParams&)>;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry {
+            Http::Response response;
+            Clock::time_point stored_at;
+            Clock::time_point expires_at;
+        };
+
+        /// NOTE: Holds `std::nullopt` when the leader's response was not shareable, so waiters run the handler themselves.
+        using SharedFill = std::shared_future<std::optional<Http::Response>>;
+
+        MicrocachePolicy m_policy;
+        std::mutex m_entries_mtx;
+        std::unordered_map<std::string, Entry> m_entries;
+        std::unordered_map<std::string, SharedFill> m_fills; // in-flight handler runs by key
+
+        [[nodiscard]] auto make_key(const Http::Request& req, const Uri::QueryParams& params) const -> std::string;
+
+        /// NOTE: Gives how long a response may be reused, or `std::nullopt` if it must not be stored at all.
+        [[nodiscard]] auto deduce_lifetime(const Http::Response& res) const -> std::optional<std::chrono::milliseconds>;
+
+        /// NOTE: Assumes `m_entries_mtx` is held.
+        void store(std::string key, const Http::Response& res, std::chrono::milliseconds lifetime);
+
+    public:
+        explicit ResponseMicrocache(MicrocachePolicy policy);
+
+        [[nodiscard]] auto fetch_or_fill(Http::Request& req, const Uri::QueryParams& params, const Handler& handler) -> Http::Response;
+    };
+}
+
+#endif
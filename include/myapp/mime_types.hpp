@@ -0,0 +1,61 @@
+#ifndef DERKHTTPD_MYAPP_MIME_TYPES_HPP
+#define DERKHTTPD_MYAPP_MIME_TYPES_HPP
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <utility>
+
+namespace DerkHttpd::App {
+    using MimeEntry = std::pair<std::string_view, std::string_view>;
+
+    constexpr std::string_view fallback_mime_type = "application/octet-stream";
+
+    /// NOTE: Lower-case file extensions (without the dot) mapped to MIME names. Keep this sorted by extension for the binary search in `lookup_mime_type`. Every MIME name here is a string literal, so they satisfy the `ResourceKind` lifetime rule.
+    constexpr std::array<MimeEntry, 27> mime_type_table {{
+        {"avif", "image/avif"},
+        {"bmp", "image/bmp"},
+        {"css", "text/css; charset=utf-8"},
+        {"csv", "text/csv; charset=utf-8"},
+        {"gif", "image/gif"},
+        {"gz", "application/gzip"},
+        {"htm", "text/html; charset=utf-8"},
+        {"html", "text/html; charset=utf-8"},
+        {"ico", "image/vnd.microsoft.icon"},
+        {"jpeg", "image/jpeg"},
+        {"jpg", "image/jpeg"},
+        {"js", "text/javascript; charset=utf-8"},
+        {"json", "application/json"},
+        {"map", "application/json"},
+        {"md", "text/markdown; charset=utf-8"},
+        {"mjs", "text/javascript; charset=utf-8"},
+        {"mp4", "video/mp4"},
+        {"otf", "font/otf"},
+        {"pdf", "application/pdf"},
+        {"png", "image/png"},
+        {"svg", "image/svg+xml"},
+        {"ttf", "font/ttf"},
+        {"txt", "text/plain; charset=utf-8"},
+        {"wasm", "application/wasm"},
+        {"webp", "image/webp"},
+        {"woff2", "font/woff2"},
+        {"xml", "application/xml"},
+    }};
+
+    static_assert(std::ranges::is_sorted(mime_type_table, {}, &MimeEntry::first), "mime_type_table must stay sorted by extension");
+
+    /// NOTE: Takes an extension like `"html"` or `".html"`, giving `fallback_mime_type` for unknown ones. Matching is case-sensitive, as the table only has lower-case keys.
+    [[nodiscard]] constexpr auto lookup_mime_type(std::string_view extension) noexcept -> std::string_view {
+        if (extension.starts_with('.')) {
+            extension.remove_prefix(1);
+        }
+
+        if (const auto entry_it = std::ranges::lower_bound(mime_type_table, extension, {}, &MimeEntry::first); entry_it != mime_type_table.end() && entry_it->first == extension) {
+            return entry_it->second;
+        }
+
+        return fallback_mime_type;
+    }
+}
+
+#endif
@@ -6,19 +6,25 @@
 #include <iostream>
 #include <print>
 
+#include "mynet/handles.hpp"
 #include "myhttp/intake.hpp"
 #include "myhttp/outtake.hpp"
-#include "myapp/routes.hpp"
+#include "myapp/connection_pool.hpp"
+#include "myapp/encoding.hpp"
+#include "myapp/etags.hpp"
+#include "myapp/handler_executor.hpp"
+#include "myapp/ranges.hpp"
+#include "myapp/vhosts.hpp"
 
 namespace DerkHttpd::App {
     template <typename ResultType>
     concept TaskResultKind = requires (ResultType result) {
-        {auto(result.pollfd_idx)} -> std::same_as<int>;
+        {auto(result.conn)} -> std::same_as<Net::ConnectionId>;
         {auto(result.ok)} -> std::same_as<bool>;
     };
 
     /**
-     * @brief The callable object meant for the async promises within mynet/handles.cpp... Its logic should handle a request and response I/O exchange between server and client.
+     * @brief The callable object meant for the async promises within mynet/handles.cpp... Its logic should handle a request and response I/O exchange between server and client. Responses are sent through the connection's `Net::OutboundQueue`, so a client with a full TCP window never stalls the worker.
      */
     template <TaskResultKind ResultType>
     class MsgExchangeTask {
@@ -34,19 +40,20 @@ namespace DerkHttpd::App {
             ModifyBoundTag is_afterward; // Whether the resource's modification timestamp must exceed `ResourceTimeBound::time` to send.
         };
 
-        Http::HttpIntake m_http_in;
-        Http::HttpOuttake m_http_out;
+        EncodeConfig m_encode_config;
+        HandlerExecutor* m_executor; // runs route handlers and sends their responses on its workers when set, see `operator()`
 
         // NOTE: By MDN, the If-Modified-Since applies only for HEAD & GET requests if applicable. For If-Unmodified-Since, it applies only for non-HEAD & non-GET requests if applicable. This helper member function is important for respecting the caching mechanics of HTTP/1.1.
         [[nodiscard]] auto deduce_resource_time_bound(const Http::Request& request) -> ResourceTimeBound {
             const auto request_verb = request.http_verb;
 
-            if (request.headers.contains("If-Modified-Since") && (request_verb == Http::Verb::http_head || request_verb == Http::Verb::http_get)) {
+            // As per RFC 9110 (section 13.2.2), a date precondition is skipped when its entity-tag counterpart is present.
+            if (request.headers.contains("If-Modified-Since") && !request.headers.contains("If-None-Match") && (request_verb == Http::Verb::http_head || request_verb == Http::Verb::http_get)) {
                 return {
                     .time = App::parse_date_string(request.headers.at("If-Modified-Since")),
                     .is_afterward = ModifyBoundTag::minimum,
                 };
-            } else if (request.headers.contains("If-Unmodified-Since") && (request_verb != Http::Verb::http_head && request_verb != Http::Verb::http_get)) {
+            } else if (request.headers.contains("If-Unmodified-Since") && !request.headers.contains("If-Match") && (request_verb != Http::Verb::http_head && request_verb != Http::Verb::http_get)) {
                 return {
                     .time = App::parse_date_string(request.headers.at("If-Unmodified-Since")),
                     .is_afterward = ModifyBoundTag::maximum,
@@ -59,20 +66,249 @@ namespace DerkHttpd::App {
             }
         }
 
-    public:
-        MsgExchangeTask()
-        : m_http_in { Http::IntakeConfig {.max_body_size = 1024} }, m_http_out {} {}
+        /// NOTE: Turns a response into a payload-less 304 / 412, keeping only the validators that a client's cache needs.
+        static void put_validators_only(Http::Response& response, Http::Status status) {
+            Http::HeaderMap validator_headers {response.headers.get_allocator()};
 
-        [[nodiscard]] auto operator()(int fd_idx, int fd, const App::Routes& routes) -> ResultType {
-            auto req_result = m_http_in(fd);
+            for (const auto validator_name : {"ETag", "Last-Modified"}) {
+                if (auto validator_it = response.headers.find(validator_name); validator_it != response.headers.end()) {
+                    validator_headers.insert(std::move(*validator_it));
+                }
+            }
 
-            // 1. Check if request decode was OK. Usually, a bad exchange means the connection's invariants are broken- It must be closed.
-            if (!req_result.has_value()) {
-                std::println(std::cerr, "MsgExchangeTask ERROR:\n{}", req_result.error());
-                return {fd_idx, false};
+            response.body = {};
+            response.headers = std::move(validator_headers);
+            response.http_status = status;
+        }
+
+        // NOTE: Checks `If-Match` and `If-None-Match` against the `ETag` of the representation a 200 would send, i.e the coded tag when `coding` applies, and a 304 / 412 carries that same tag. These run before any range or coding work, so a revalidation reads no payload here, though a handler may still have loaded it, e.g a `FileCache` miss.
+        void apply_entity_tag_preconditions(const Http::Request& request, Http::Response& response, Http::ContentCoding coding) {
+            if (response.http_status != Http::Status::http_ok || !response.headers.contains("ETag")) {
+                return;
+            }
+
+            const auto etag = App::make_coded_entity_tag(response.headers.at("ETag"), coding);
+            const auto request_verb = request.http_verb;
+
+            if (request.headers.contains("If-Match") && !App::match_entity_tag(request.headers.at("If-Match"), etag, true)) {
+                put_validators_only(response, Http::Status::http_precondition_failed);
+            } else if (request.headers.contains("If-None-Match") && App::match_entity_tag(request.headers.at("If-None-Match"), etag, false)) {
+                put_validators_only(response, (request_verb == Http::Verb::http_get || request_verb == Http::Verb::http_head) ? Http::Status::http_not_modified : Http::Status::http_precondition_failed);
+            } else {
+                return;
+            }
+
+            response.headers.insert_or_assign("ETag", etag);
+        }
+
+        // NOTE: As per RFC 9110, a `Range` is only honored when `If-Range` is absent or still matches the file's validator: a strong `ETag` or the exact `Last-Modified` date.
+        [[nodiscard]] auto check_if_range(const Http::Request& request, const Http::Response& response) -> bool {
+            if (!request.headers.contains("If-Range")) {
+                return true;
+            }
+
+            const auto& if_range_value = request.headers.at("If-Range");
+
+            if (if_range_value.starts_with('"') || if_range_value.starts_with("W/")) {
+                return response.headers.contains("ETag") && App::match_entity_tag(if_range_value, response.headers.at("ETag"), true);
+            }
+
+            const auto file_time_p = std::get_if<std::filesystem::file_time_type>(&response.modify_timestamp);
+
+            return file_time_p && App::parse_date_string(if_range_value) == std::chrono::duration_cast<std::chrono::seconds>(file_time_p->time_since_epoch());
+        }
+
+        /// NOTE: Picks the byte ranges to send out of a full file payload, without reading any of it. Gives nothing when the full representation should be sent instead.
+        [[nodiscard]] auto plan_range_request(const Http::Request& request, const Http::Response& response) -> std::optional<App::RangeSet> {
+            if (response.http_status != Http::Status::http_ok || !request.headers.contains("Range")) {
+                return {};
+            }
+
+            std::uintmax_t full_size = 0;
+
+            // Only file payloads support ranges: an on-disk region, a cached snapshot or an embedded asset.
+            if (const auto region_p = std::get_if<Http::FileRegion>(&response.body); region_p) {
+                full_size = region_p->length;
+            } else if (const auto cached_bytes_p = std::get_if<Http::SharedBytes>(&response.body); cached_bytes_p && !response.origin.empty()) {
+                full_size = cached_bytes_p->size();
+            } else if (const auto cached_blob_p = std::get_if<Http::Blob>(&response.body); cached_blob_p && !response.origin.empty()) {
+                full_size = cached_blob_p->size();
+            } else if (const auto static_bytes_p = std::get_if<Http::StaticBytes>(&response.body); static_bytes_p) {
+                full_size = static_bytes_p->bytes.size();
+            } else {
+                return {};
+            }
+
+            if (!check_if_range(request, response)) {
+                return {};
+            }
+
+            if (auto range_set = App::parse_byte_ranges(request.headers.at("Range"), full_size); range_set.verdict != App::RangeVerdict::ignored) {
+                return range_set;
+            }
+
+            return {};
+        }
+
+        /// NOTE: Whether `encode_response_body` can code this payload: streams, generated text and files past `EncodeConfig::min_size`, and embedded assets with a build-time variant.
+        [[nodiscard]] auto is_codable_payload(const Http::Response& response, Http::ContentCoding coding) const -> bool {
+            const auto min_size = m_encode_config.min_size;
+            const auto has_file_time = std::holds_alternative<std::filesystem::file_time_type>(response.modify_timestamp);
+
+            if (std::holds_alternative<App::ChunkIterPtr>(response.body)) {
+                return true;
+            } else if (const auto static_bytes_p = std::get_if<Http::StaticBytes>(&response.body); static_bytes_p) {
+                return !static_bytes_p->coded_variants[static_cast<std::size_t>(coding)].empty();
+            } else if (const auto cached_bytes_p = std::get_if<Http::SharedBytes>(&response.body); cached_bytes_p) {
+                return cached_bytes_p->size() >= min_size && (response.origin.empty() || has_file_time);
+            } else if (const auto identity_blob_p = std::get_if<Http::Blob>(&response.body); identity_blob_p) {
+                return identity_blob_p->size() >= min_size;
+            } else if (const auto region_p = std::get_if<Http::FileRegion>(&response.body); region_p) {
+                return region_p->length >= min_size && has_file_time;
             }
 
-            Http::Request req = std::exchange(req_result.value(), {});
+            return false;
+        }
+
+        // NOTE: Negotiates `Accept-Encoding` against a 200 response's textual payload, giving the coding that `encode_response_body` applies later. It is settled before the preconditions, as a coded payload has its own entity tag. A client that refused `identity` too gets a 406 rather than a representation it ruled out.
+        [[nodiscard]] auto negotiate_response_coding(const Http::Request& request, Http::Response& response) const -> Http::ContentCoding {
+            if (response.http_status != Http::Status::http_ok || response.headers.contains("Content-Encoding")) {
+                return Http::ContentCoding::identity;
+            }
+
+            if (!response.headers.contains("Content-Type") || !App::is_compressible_mime(response.headers.at("Content-Type"))) {
+                return Http::ContentCoding::identity;
+            }
+
+            // Caches must key these representations by the request's codings, even when identity is sent.
+            if (auto vary_it = response.headers.find("Vary"); vary_it == response.headers.end()) {
+                response.headers.emplace("Vary", "Accept-Encoding");
+            } else if (!vary_it->second.contains("Accept-Encoding") && vary_it->second != "*") {
+                vary_it->second += ", Accept-Encoding";
+            }
+
+            const auto coding_opt = (request.headers.contains("Accept-Encoding"))
+                ? App::negotiate_content_coding(request.headers.at("Accept-Encoding"))
+                : std::optional {Http::ContentCoding::identity};
+
+            if (!coding_opt) {
+                response.body = {};
+                response.headers.clear();
+                response.headers.emplace("Content-Length", "0");
+                response.headers.emplace("Vary", "Accept-Encoding");
+                response.http_status = Http::Status::http_not_acceptable;
+
+                return Http::ContentCoding::identity;
+            }
+
+            if (const auto coding = coding_opt.value(); coding != Http::ContentCoding::identity && is_codable_payload(response, coding)) {
+                return coding;
+            }
+
+            return Http::ContentCoding::identity;
+        }
+
+        // NOTE: Codes a 200 response's payload as negotiated. File payloads reuse the precompressed variants of `EncodedVariantCache`, while generated ones are compressed per response (or per chunk when streamed).
+        void encode_response_body(Http::Response& response, Http::ContentCoding coding) {
+            if (coding == Http::ContentCoding::identity || response.http_status != Http::Status::http_ok) {
+                return;
+            }
+
+            if (auto chunking_it_p = std::get_if<App::ChunkIterPtr>(&response.body); chunking_it_p) {
+                response.body = std::make_shared<App::EncodingChunkIter>(*chunking_it_p, coding, m_encode_config.level);
+            } else if (auto static_bytes_p = std::get_if<Http::StaticBytes>(&response.body); static_bytes_p) {
+                // Embedded assets only use their build-time variants, so no coding work ever happens per request.
+                const auto coded_sv = static_bytes_p->coded_variants[static_cast<std::size_t>(coding)];
+
+                if (coded_sv.empty()) {
+                    return;
+                }
+
+                response.headers.insert_or_assign("Content-Length", std::to_string(coded_sv.size()));
+                response.body = Http::StaticBytes {
+                    .bytes = coded_sv,
+                    .coded_variants = {},
+                };
+            } else {
+                std::optional<Http::SharedBytes> encoded_bytes;
+
+                const auto file_time_p = std::get_if<std::filesystem::file_time_type>(&response.modify_timestamp);
+
+                if (auto cached_bytes_p = std::get_if<Http::SharedBytes>(&response.body); cached_bytes_p && cached_bytes_p->size() >= m_encode_config.min_size && file_time_p && !response.origin.empty()) {
+                    // The identity bytes are only copied for compression on a miss, as a warm variant is shared as is.
+                    encoded_bytes = App::EncodedVariantCache::instance().fetch(response.origin, *file_time_p, coding, m_encode_config.level, [cached_bytes_p]() -> std::optional<Http::Blob> {
+                        const auto identity_bytes = cached_bytes_p->view();
+
+                        return Http::Blob (identity_bytes.begin(), identity_bytes.end());
+                    });
+                } else if (cached_bytes_p && cached_bytes_p->size() >= m_encode_config.min_size && response.origin.empty()) {
+                    // Generated text shared without a backing file, e.g an owned `StringReply` string, is compressed per response like a generated `Http::Blob`.
+                    if (auto encoded_blob = App::encode_blob(cached_bytes_p->view(), coding, m_encode_config.level); encoded_blob) {
+                        encoded_bytes = Http::SharedBytes {std::move(encoded_blob.value())};
+                    }
+                } else if (auto identity_blob_p = std::get_if<Http::Blob>(&response.body); identity_blob_p && identity_blob_p->size() >= m_encode_config.min_size) {
+                    if (file_time_p && !response.origin.empty()) {
+                        encoded_bytes = App::EncodedVariantCache::instance().fetch(response.origin, *file_time_p, coding, m_encode_config.level, [identity_blob_p]() -> std::optional<Http::Blob> {
+                            return *identity_blob_p;
+                        });
+                    } else if (auto encoded_blob = App::encode_blob(*identity_blob_p, coding, m_encode_config.level); encoded_blob) {
+                        encoded_bytes = Http::SharedBytes {std::move(encoded_blob.value())};
+                    }
+                } else if (auto region_p = std::get_if<Http::FileRegion>(&response.body); region_p && region_p->length >= m_encode_config.min_size && file_time_p) {
+                    encoded_bytes = App::EncodedVariantCache::instance().fetch(region_p->path, *file_time_p, coding, m_encode_config.level, [region_p]() -> std::optional<Http::Blob> {
+                        return App::read_file_region(*region_p);
+                    });
+                }
+
+                if (!encoded_bytes) {
+                    return;
+                }
+
+                response.headers.insert_or_assign("Content-Length", std::to_string(encoded_bytes->size()));
+                response.body = std::move(encoded_bytes.value());
+            }
+
+            response.headers.emplace("Content-Encoding", Http::coding_enum_to_name(coding));
+
+            if (auto etag_it = response.headers.find("ETag"); etag_it != response.headers.end()) {
+                etag_it->second = App::make_coded_entity_tag(etag_it->second, coding);
+            }
+        }
+
+        /// NOTE: Answers a refused request and closes once that is sent, as its unread body leaves the stream unusable. A 503 asks the client to retry shortly.
+        [[nodiscard]] static auto send_refusal(int fd, Net::OutboundQueue& outbound, App::ConnectionState& conn, Http::Status status) -> bool {
+            Http::Response res {
+                .body = {},
+                .headers = Http::HeaderMap {&conn.arena},
+                .modify_timestamp = App::get_epoch_seconds_now(),
+                .origin = {},
+                .http_status = status,
+                .http_schema = Http::Schema::http_1_1,
+            };
+
+            res.headers.emplace("Content-Length", "0");
+            res.headers.emplace("Connection", "close");
+            res.headers.emplace("Date", get_date_string());
+            res.headers.emplace("Server", "derkhttpd/0.1.0");
+
+            if (status == Http::Status::http_service_unavailable) {
+                res.headers.emplace("Retry-After", "1");
+            }
+
+            if (!conn.outtake(std::move(res), outbound)) {
+                return false;
+            }
+
+            outbound.close_on_drain();
+
+            const auto flush_status = outbound.flush(fd);
+
+            return flush_status == Net::FlushStatus::pending || flush_status == Net::FlushStatus::stalled;
+        }
+
+        /// NOTE: Runs the routed handler on the calling thread, then checks preconditions, narrows and encodes its response, and queues and flushes it without blocking.
+        [[nodiscard]] auto serve_request(Net::ConnectionId conn_id, Net::OutboundQueue& outbound, App::ConnectionState& conn, const App::VirtualHosts& hosts, Http::Request& req) -> ResultType {
+            const auto fd = conn_id.fd;
             const auto [resource_modify_time_bound, modify_bound_tag] = deduce_resource_time_bound(req);
             const auto req_is_head = req.http_verb == Http::Verb::http_head;
 
@@ -81,53 +317,56 @@ namespace DerkHttpd::App {
                 req.http_verb = Http::Verb::http_get;
             }
 
-            Http::Response res = routes.dispatch_handler(req);
+            Http::Response res = hosts.dispatch_handler(fd, req);
 
-            if (req_is_head) {
-                if (auto discardable_chunked_p = std::get_if<App::ChunkIterPtr>(&res.body); discardable_chunked_p) {
-                    discardable_chunked_p->get()->clear();
-                } else {
-                    res.body = {};
+            // 2b. Settle which representation a 200 would send, i.e a byte range of the identity payload or the whole payload in the negotiated coding, without reading any of it. Range handling is only defined for GET, so HEAD requests see the full representation's metadata.
+            const auto range_set = (!req_is_head) ? plan_range_request(req, res) : std::nullopt;
+            const auto coding = (!range_set) ? negotiate_response_coding(req, res) : Http::ContentCoding::identity;
+
+            // 2c. Evaluate entity-tag preconditions first, against that representation's tag. Then send a 304 when the resource's timestamp (in Epoch seconds) is below a minimum time or a 412 when the resource's timestamp exceeds the minimum unmodified-since time. See `MsgExchangeTask::deduce_resource_time_bound()`.
+            apply_entity_tag_preconditions(req, res, coding);
+
+            if (const auto res_resource_timestamp_p = std::get_if<std::filesystem::file_time_type>(&res.modify_timestamp); res_resource_timestamp_p && res.http_status == Http::Status::http_ok) {
+                const auto res_resource_seconds = std::chrono::duration_cast<std::chrono::seconds>(res_resource_timestamp_p->time_since_epoch());
+
+                // NOTE: A 304 or 412 should not send any payload, so there's no need for resource-payload headers. Only the validators should be most important for the client's possible caching.
+                if (modify_bound_tag == ModifyBoundTag::minimum && res_resource_seconds <= resource_modify_time_bound) {
+                    put_validators_only(res, Http::Status::http_not_modified);
+                } else if (modify_bound_tag == ModifyBoundTag::maximum && res_resource_seconds > resource_modify_time_bound) {
+                    put_validators_only(res, Http::Status::http_precondition_failed);
+                }
+
+                if (res.http_status != Http::Status::http_ok) {
+                    if (auto etag_it = res.headers.find("ETag"); etag_it != res.headers.end()) {
+                        etag_it->second = App::make_coded_entity_tag(etag_it->second, coding);
+                    }
+
+                    if (!res.headers.contains("Last-Modified")) {
+                        res.headers.emplace("Last-Modified", App::get_date_string(*res_resource_timestamp_p));
+                    }
                 }
             }
 
-            // 2b. Send a 304 when the resource's timestamp (in Epoch seconds) is below a minimum time or a 412 when the resource's timestamp exceeds the minimum unmodified-since time. See `MsgExchangeTask::deduce_resource_time_bound()`.
-            if (std::holds_alternative<std::filesystem::file_time_type>(res.modify_timestamp)) {
-                if (const auto& res_resource_timestamp = std::get<std::filesystem::file_time_type>(res.modify_timestamp); modify_bound_tag == ModifyBoundTag::minimum && res_resource_timestamp.time_since_epoch() <= resource_modify_time_bound) {
-                    res.body = {};
+            // 2d. Only a response that passed its preconditions reads and narrows or codes its payload.
+            if (range_set && res.http_status == Http::Status::http_ok) {
+                App::ResponseUtils::response_put_ranges(res, range_set.value());
+            }
 
-                    // NOTE: A 304 should not send any payload, so there's no need for resource-payload headers. Only `Last-Modified` should be most important for the client's possible caching.
-                    res.headers.clear();
-                    res.headers.emplace(
-                        "Last-Modified",
-                        std::format(
-                            "{0:%a}, {0:%e} {0:%b} {0:%Y} {0:%H}:{0:%M}:{0:%S} UTC",
-                            std::chrono::time_point_cast<std::chrono::seconds>(res_resource_timestamp)
-                        )
-                    );
-
-                    res.http_status = Http::Status::http_not_modified;
-                } else if (modify_bound_tag == ModifyBoundTag::maximum && res_resource_timestamp.time_since_epoch() > resource_modify_time_bound) {
-                    res.body = {};
+            encode_response_body(res, coding);
 
-                    // NOTE: A 412 should not send any payload as well, similarly to the 304 case above.
-                    res.headers.clear();
-                    res.headers.emplace(
-                        "Last-Modified",
-                        std::format(
-                            "{0:%a}, {0:%e} {0:%b} {0:%Y} {0:%H}:{0:%M}:{0:%S} UTC",
-                            std::chrono::time_point_cast<std::chrono::seconds>(res_resource_timestamp)
-                        )
-                    );
-
-                    res.http_status = Http::Status::http_precondition_failed;
+            if (req_is_head) {
+                if (auto discardable_chunked_p = std::get_if<App::ChunkIterPtr>(&res.body); discardable_chunked_p) {
+                    discardable_chunked_p->get()->clear();
+                } else {
+                    res.body = {};
                 }
             }
 
             // 3. Decorate response with other important headers e.g Server, Connection, and Date.
             res.headers.emplace("Server", "derkhttpd/0.1.0");
 
-            if (req.headers.contains("Connection") && req.http_schema == Http::Schema::http_1_1 && res.http_status != Http::Status::http_server_error) {
+            // A queue already closing, e.g. while the server drains, ends the connection after this exchange whatever the client asked for.
+            if (!outbound.is_closing() && req.headers.contains("Connection") && req.http_schema == Http::Schema::http_1_1 && res.http_status != Http::Status::http_server_error) {
                 res.headers.emplace("Connection", req.headers.at("Connection"));
             } else {
                 res.headers.emplace("Connection", "close");
@@ -137,11 +376,76 @@ namespace DerkHttpd::App {
 
             res.http_schema = req.http_schema;
 
-            if (!m_http_out(fd, res)) {
-                return {fd_idx, false};
+            const auto keeps_alive = res.headers.at("Connection") != "close";
+
+            // 4. Queue the response behind any parked output, then send what the socket takes without blocking. Leftovers resume on `POLLOUT` (or on the wake signal for stalled file reads), so a connection that is closing must stay open until its queue drains.
+            const auto queued_ok = conn.outtake(std::move(res), outbound);
+
+            // The body's bytes now live in the queue, which counts them on its own.
+            conn.intake.release_body_budget();
+
+            if (!queued_ok) {
+                return {conn_id, false};
+            }
+
+            if (!keeps_alive) {
+                outbound.close_on_drain();
+            }
+
+            if (const auto flush_status = outbound.flush(fd); flush_status == Net::FlushStatus::failed) {
+                return {conn_id, false};
+            } else {
+                return {conn_id, keeps_alive || flush_status == Net::FlushStatus::pending || flush_status == Net::FlushStatus::stalled};
+            }
+        }
+
+    public:
+        MsgExchangeTask()
+        : MsgExchangeTask {EncodeConfig {}} {}
+
+        explicit MsgExchangeTask(EncodeConfig encode_config)
+        : m_encode_config {encode_config}, m_executor {nullptr} {}
+
+        explicit MsgExchangeTask(HandlerExecutor& executor, EncodeConfig encode_config = {})
+        : m_encode_config {encode_config}, m_executor {&executor} {}
+
+        /// NOTE: The parser, serializer and arena come from the connection's pooled `conn`, so this task only carries its config and is cheap to copy per exchange.
+        void operator()(Net::ConnectionId conn_id, Net::OutboundQueue& outbound, App::ConnectionState& conn, const App::VirtualHosts& hosts, Net::TaskCompleter done) {
+            // 0. Allocate this exchange's headers and URI from the connection's arena, rewound in one go instead of freeing each string.
+            const auto fd = conn_id.fd;
+
+            conn.rewind_arena();
+
+            auto req_result = conn.intake(fd, &conn.arena);
+
+            // 1. Check if request decode was OK. Usually, a bad exchange means the connection's invariants are broken- It must be closed. A request refused over a limit is still told why, since shedding load should look different from a crash.
+            if (!req_result.has_value()) {
+                const auto& [intake_message, reply_status] = req_result.error();
+
+                std::println(std::cerr, "MsgExchangeTask ERROR:\n{}", intake_message);
+
+                if (!reply_status) {
+                    done(ResultType {conn_id, false});
+                    return;
+                }
+
+                done(ResultType {conn_id, send_refusal(fd, outbound, conn, reply_status.value())});
+                return;
+            }
+
+            // 2. Serve the request on the executor when one is set. Its job reports to the reactor itself, so this I/O task ends here instead of waiting on the handler. The request's strings live in `conn`'s arena, which stays put until that report.
+            if (!m_executor) {
+                done(serve_request(conn_id, outbound, conn, hosts, req_result.value()));
+                return;
             }
 
-            return {fd_idx, res.headers.at("Connection") != "close"};
+            m_executor->post([exchange = *this, conn_id, &outbound, &conn, &hosts, req = std::move(req_result.value()), done = std::move(done)]() mutable noexcept {
+                try {
+                    done(exchange.serve_request(conn_id, outbound, conn, hosts, req));
+                } catch (...) {
+                    done(ResultType {conn_id, false});
+                }
+            });
         }
     };
 }
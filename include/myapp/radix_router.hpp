@@ -0,0 +1,95 @@
+#ifndef DERKHTTPD_MYAPP_RADIX_ROUTER_HPP
+#define DERKHTTPD_MYAPP_RADIX_ROUTER_HPP
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace DerkHttpd::App {
+    constexpr std::size_t max_route_params = 8;
+
+    struct RouteParam {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    /// NOTE: Fixed-capacity captures of one route match. Names view the router's patterns and values view the matched path, so filling this never allocates. Both must outlive it.
+    class RouteParams {
+    private:
+        std::array<RouteParam, max_route_params> m_items;
+        std::size_t m_count;
+
+    public:
+        constexpr RouteParams() noexcept
+        : m_items {}, m_count {0} {}
+
+        [[nodiscard]] constexpr auto push(std::string_view name, std::string_view value) noexcept -> bool {
+            if (m_count == max_route_params) {
+                return false;
+            }
+
+            m_items[m_count++] = RouteParam {.name = name, .value = value};
+
+            return true;
+        }
+
+        constexpr void pop() noexcept {
+            if (m_count > 0) {
+                --m_count;
+            }
+        }
+
+        [[nodiscard]] constexpr auto get(std::string_view name) const noexcept -> std::optional<std::string_view> {
+            for (const auto& [item_name, item_value] : items()) {
+                if (item_name == name) {
+                    return item_value;
+                }
+            }
+
+            return {};
+        }
+
+        [[nodiscard]] constexpr auto items() const noexcept -> std::span<const RouteParam> {
+            return {m_items.data(), m_count};
+        }
+    };
+
+    /**
+     * @brief Compressed radix tree from path patterns to handler slots. Patterns may hold static text, `:name` captures of one whole segment and a final `*name` capture of the remaining path, e.g `/users/:id` and `*rest` after `/files/`. Matching prefers static text, then captures, then wildcards, backtracking when a preferred branch dead-ends.
+     */
+    class RadixRouter {
+    private:
+        struct Node {
+            std::string prefix; // static text consumed by this node, empty for the root and capture nodes
+            std::string capture_name; // set for `:name` and `*name` nodes
+            std::vector<std::unique_ptr<Node>> static_children; // sorted by their prefix's first char, which is unique among siblings
+            std::unique_ptr<Node> param_child;
+            std::unique_ptr<Node> wildcard_child;
+            std::optional<std::size_t> slot;
+        };
+
+        Node m_root;
+
+        [[nodiscard]] static auto insert_static(Node& parent, std::string_view text) -> Node&;
+
+        /// NOTE: Follows `text` along existing edges without changing the tree. Gives null when inserting it would split or add an edge, as the node it ends on would then be new.
+        [[nodiscard]] static auto find_static(const Node& parent, std::string_view text) noexcept -> const Node*;
+
+        [[nodiscard]] static auto match(const Node& node, std::string_view rest, RouteParams& params) noexcept -> const Node*;
+
+    public:
+        RadixRouter();
+
+        /// NOTE: Gives the slot bound to `pattern`: `slot` for a new pattern, or the earlier slot if the pattern was already taken. Fails on a malformed pattern, more captures than `max_route_params`, or a capture name clashing with another pattern's at the same position. A rejected pattern leaves the tree unchanged.
+        [[nodiscard]] auto insert(std::string_view pattern, std::size_t slot) -> std::optional<std::size_t>;
+
+        [[nodiscard]] auto find(std::string_view path, RouteParams& params) const noexcept -> std::optional<std::size_t>;
+    };
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef DERKHTTPD_MYAPP_RANGES_HPP
+#define DERKHTTPD_MYAPP_RANGES_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace DerkHttpd::App {
+    /// NOTE: Limits how many ranges one request may list, since each extra part costs a multipart header and a positional read.
+    constexpr std::size_t max_byte_ranges = 16;
+
+    struct ByteRange {
+        std::uintmax_t first;
+        std::uintmax_t last; // inclusive like the `Range` syntax
+    };
+
+    enum class RangeVerdict : uint8_t {
+        ignored, // malformed or unsupported units, so the full representation is sent
+        satisfiable,
+        unsatisfiable,
+    };
+
+    struct RangeSet {
+        std::vector<ByteRange> ranges; // sorted & coalesced byte ranges within the representation
+        std::uintmax_t full_size;
+        RangeVerdict verdict;
+    };
+
+    /// NOTE: Parses a `Range: bytes=...` value against a representation of `full_size` bytes. See RFC 9110, section 14.1.2.
+    [[nodiscard]] auto parse_byte_ranges(std::string_view range_value, std::uintmax_t full_size) -> RangeSet;
+}
+
+#endif
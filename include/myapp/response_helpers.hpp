@@ -5,46 +5,128 @@
 #include <concepts>
 #include <chrono>
 #include <string>
+#include <string_view>
+#include <variant>
 
 #include "myhttp/msgs.hpp"
 #include "myapp/contents.hpp"
+#include "myapp/embedded_assets.hpp"
+#include "myapp/etags.hpp"
+#include "myapp/file_cache.hpp"
+#include "myapp/ranges.hpp"
 
 namespace DerkHttpd::App {
-    // NOTE: this constraint on web resources MUST have lifetimes like Rust's `'static` for the returned MIME name: the `std::string_view` must be a string literal.
+    // NOTE: this constraint on web resources MUST have lifetimes like Rust's `'static` for the returned MIME name: the `std::string_view` must be a string literal. The full payload is extracted from an rvalue, so a resource that owns its bytes can move them out instead of copying.
     template <typename T>
     concept ResourceKind = requires (T arg) {
         {auto(arg.get_mime_desc())} -> std::same_as<std::string_view>;
         {auto(arg.as_chunk_iter())} -> std::same_as<ChunkIterPtr>;
-        {auto(arg.as_full_blob())} -> std::same_as<Http::Blob>;
+        {auto(std::move(arg).as_full_blob())} -> std::same_as<Http::Blob>;
     };
 
     // Generates a GMT string for HTTP/1.1 responses: `%a, %e %b %Y %T UTC`, referencing: http://stackoverflow.com/questions/63501664/ddg#63502919
     [[nodiscard]] auto get_date_string() -> std::string;
 
+    /// NOTE: Formats a file's modify time in the same layout, e.g for `Last-Modified`.
+    [[nodiscard]] auto get_date_string(std::filesystem::file_time_type file_time) -> std::string;
+
     /// NOTE: LLVM 21 for macOS lacks `std::chrono::parse()`, so I'll do this the old-fashioned way: `std::istringstream` and `std::get_time`.
-    [[nodiscard]] auto parse_date_string(const std::string& date) -> std::chrono::seconds;
+    [[nodiscard]] auto parse_date_string(std::string_view date) -> std::chrono::seconds;
 
     [[nodiscard]] auto get_epoch_seconds_now() -> std::chrono::seconds;
 
     // Contains utils for helper functions which add to a response object. All errors are thrown with messages, and these messages are placed into 500 responses.
     namespace ResponseUtils {
+        /// NOTE: Passing `resource` as an rvalue lets an owned payload, e.g a `StringReply` made from a request body, move into the response without a copy.
         template <ResourceKind Resource>
-        void response_put_all(Http::Response& res, Resource& resource, Http::Status status) {
-            Http::Blob response_resource = resource.as_full_blob();
-            const auto response_size = response_resource.size();
+        void response_put_all(Http::Response& res, Resource&& resource, Http::Status status) {
+            if constexpr (std::is_same_v<std::remove_cvref_t<Resource>, App::TextualFile> || std::is_same_v<std::remove_cvref_t<Resource>, App::BinaryFile>) {
+                const auto& file_path = resource.get_path();
+
+                // NOTE: Hot files come from `FileCache` with their validators precomputed, so a hit needs no file system calls at all.
+                if (const auto cached_file = FileCache::instance().fetch(file_path, resource.get_mime_desc()); cached_file) {
+                    // Shares the cached buffer, so concurrent hits never copy the file's bytes.
+                    res.body = cached_file->bytes;
+
+                    res.headers.emplace("Content-Length", std::to_string(cached_file->bytes.size()));
+                    res.headers.emplace("Accept-Ranges", "bytes");
+                    res.headers.emplace("ETag", cached_file->etag);
+                    res.headers.emplace("Last-Modified", get_date_string(cached_file->identity.modify_time));
+                    res.headers.emplace("Content-Type", cached_file->mime.data());
+                    res.modify_timestamp = cached_file->identity.modify_time;
+                    res.origin = file_path;
+                    res.http_status = status;
+
+                    return;
+                }
+
+                // NOTE: Otherwise, file payloads stay on disk as a region until the outtake sends them, so conditional or ranged responses never read unused bytes.
+                const auto file_identity = ([&resource, &file_path]() -> std::optional<FileIdentity> {
+                    // A `BinaryFile` was already `fstat`-ed when it was opened.
+                    if constexpr (std::is_same_v<std::remove_cvref_t<Resource>, App::BinaryFile>) {
+                        return resource.get_identity();
+                    } else {
+                        return stat_file_identity(file_path);
+                    }
+                })();
+
+                if (!file_identity) {
+                    res.body = Http::Blob {};
+                    res.headers.emplace("Content-Length", "0");
+                    res.headers.emplace("Content-Type", "*/*");
+                    res.modify_timestamp = get_epoch_seconds_now();
+                    res.http_status = Http::Status::http_not_found;
+
+                    return;
+                }
+
+                res.body = Http::FileRegion {
+                    .path = file_path,
+                    .offset = 0,
+                    .length = file_identity->size,
+                };
+
+                res.headers.emplace("Content-Length", std::to_string(file_identity->size));
+                res.headers.emplace("Accept-Ranges", "bytes");
+                res.headers.emplace("ETag", make_entity_tag(file_identity.value()));
+                res.headers.emplace("Last-Modified", get_date_string(file_identity->modify_time));
+                res.modify_timestamp = file_identity->modify_time;
+                res.origin = file_path;
+            } else if constexpr (std::is_same_v<std::remove_cvref_t<Resource>, App::EmbeddedFile>) {
+                // NOTE: `pack_assets` precomputed everything at build time, so this only points the payload at the bundle's bytes.
+                const auto& asset = resource.get_asset();
+
+                res.body = Http::StaticBytes {
+                    .bytes = asset.identity,
+                    .coded_variants = asset.coded_variants,
+                };
+
+                res.headers.emplace("Content-Length", std::to_string(asset.identity.size()));
+                res.headers.emplace("Accept-Ranges", "bytes");
+                res.headers.emplace("ETag", asset.etag);
+                res.headers.emplace("Last-Modified", asset.last_modified);
+                res.modify_timestamp = std::chrono::file_clock::from_sys(std::chrono::sys_seconds {std::chrono::seconds {asset.modify_epoch_s}});
+            } else if constexpr (std::is_same_v<std::remove_cvref_t<Resource>, App::StringReply> && !std::is_lvalue_reference_v<Resource>) {
+                // NOTE: An owned string is shared as is, so its bytes are never copied into a `Http::Blob`.
+                std::visit([&res](auto&& payload) {
+                    res.headers.emplace("Content-Length", std::to_string(payload.size()));
+                    res.body = std::move(payload);
+                }, std::move(resource).as_body());
 
-            res.body = std::move(response_resource);
-            
-            res.headers.emplace("Content-Length", std::to_string(response_size));
-            // @see `App::ResourceKind -> get_mime_desc requirement!`
-            res.headers.emplace("Content-Type", resource.get_mime_desc().data());
-
-            if constexpr (std::is_same_v<std::remove_cvref_t<Resource>, App::TextualFile>) {
-                res.modify_timestamp = resource.get_modify_time();
+                res.modify_timestamp = get_epoch_seconds_now();
             } else {
+                Http::Blob response_resource = std::forward<Resource>(resource).as_full_blob();
+                const auto response_size = response_resource.size();
+
+                res.body = std::move(response_resource);
+
+                res.headers.emplace("Content-Length", std::to_string(response_size));
                 res.modify_timestamp = get_epoch_seconds_now();
             }
 
+            // @see `App::ResourceKind -> get_mime_desc requirement!`
+            res.headers.emplace("Content-Type", resource.get_mime_desc().data());
+
             res.http_status = status;
         }
 
@@ -62,6 +144,12 @@ namespace DerkHttpd::App {
             res.http_status = status_only_dud.get_status();
         }
 
+        /// NOTE: Answers a verb that a route has no handler for. `allowed` holds the route's handled verbs, to which HEAD (when GET is allowed) and OPTIONS are added. OPTIONS gets a 204 listing them in `Allow`, and any other verb a 405 with the same header.
+        void response_put_allowed_verbs(Http::Response& res, Http::Verb verb, Http::VerbSet allowed);
+
+        /// NOTE: Narrows a full file response (an `Http::FileRegion`, cached `Http::SharedBytes`, generated `Http::Blob` or embedded `Http::StaticBytes`) to `range_set`: a 416 when nothing is satisfiable, a single-part 206, or a `multipart/byteranges` 206.
+        void response_put_ranges(Http::Response& res, const RangeSet& range_set);
+
         template <ResourceKind Resource>
         void response_put_chunked(Http::Response& res, Resource& resource) {
             ChunkIterPtr file_txt_it = resource.as_chunk_iter();
@@ -70,8 +158,26 @@ namespace DerkHttpd::App {
             res.headers.emplace("Content-Type", resource.get_mime_desc().data());
             res.headers.emplace("Transfer-Encoding", "chunked");
 
-            if constexpr (std::is_same_v<Resource, App::TextualFile>) {
-                res.modify_timestamp = resource.get_modify_time();
+            if constexpr (std::is_same_v<Resource, App::BinaryFile>) {
+                // The chunks stream from the file version opened by `create`, so its validators must describe that version.
+                res.headers.emplace("ETag", make_entity_tag(resource.get_identity()));
+                res.headers.emplace("Last-Modified", get_date_string(resource.get_identity().modify_time));
+                res.modify_timestamp = resource.get_identity().modify_time;
+                res.origin = resource.get_path();
+            } else if constexpr (std::is_same_v<Resource, App::TextualFile>) {
+                if (const auto cached_file = FileCache::instance().fetch(resource.get_path(), resource.get_mime_desc()); cached_file) {
+                    res.headers.emplace("ETag", cached_file->etag);
+                    res.headers.emplace("Last-Modified", get_date_string(cached_file->identity.modify_time));
+                    res.modify_timestamp = cached_file->identity.modify_time;
+                } else if (const auto file_identity = stat_file_identity(resource.get_path()); file_identity) {
+                    res.headers.emplace("ETag", make_entity_tag(file_identity.value()));
+                    res.headers.emplace("Last-Modified", get_date_string(file_identity->modify_time));
+                    res.modify_timestamp = file_identity->modify_time;
+                } else {
+                    res.modify_timestamp = get_epoch_seconds_now();
+                }
+
+                res.origin = resource.get_path();
             } else {
                 res.modify_timestamp = get_epoch_seconds_now();
             }
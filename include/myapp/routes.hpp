@@ -2,63 +2,88 @@
 #define DERKHTTPD_MYAPP_ROUTES_HPP
 
 #include <algorithm>
-#include <map>
+#include <array>
+#include <expected>
+#include <filesystem>
+#include <memory>
 #include <functional>
-#include <type_traits>
+#include <vector>
 
 #include "myhttp/msgs.hpp"
 #include "myuri/uri.hpp"
 #include "myuri/parse.hpp"
+#include "myapp/filters.hpp"
+#include "myapp/microcache.hpp"
+#include "myapp/radix_router.hpp"
 #include "myapp/response_helpers.hpp"
+#include "myapp/static_mount.hpp"
+#include "myapp/static_routes.hpp"
 
 namespace DerkHttpd::App {
-    /// NOTE: Provides an alias for any callable entity that generates a web response given a path and some parameters.
-    using Middleware = std::function<Http::Response(Http::Request, const std::map<std::string, Uri::QueryValue>&)>;
+    /// NOTE: Provides an alias for any callable entity that generates a web response given a path and some parameters. The request is passed by reference, so a handler may move parts like the body out instead of copying them.
+    using Middleware = std::function<Http::Response(Http::Request&, const Uri::QueryParams&)>;
 
-    [[nodiscard]] auto compare_host_str(std::string_view incoming, std::string_view host_name, std::string_view host_port) noexcept -> bool;
+    /// NOTE: A `Middleware` that also takes the captures of a pattern route like `/users/:id`. The captures only live for the call.
+    using ParamMiddleware = std::function<Http::Response(Http::Request&, const Uri::QueryParams&, const RouteParams&)>;
 
     class Routes {
+    public:
+        /// NOTE: Entry point of a `StaticRouteTable`. On a miss, it gives the verbs allowed on the path, which is empty if the table lacks the path.
+        using StaticDispatch = auto (*)(std::string_view, Http::Request&, const Uri::QueryParams&) -> std::expected<Http::Response, Http::VerbSet>;
+
     private:
+        /// NOTE: One route's handlers indexed by verb. Unset slots make the route answer 405, and the HEAD slot stays unset as HEAD requests reach the GET handler.
+        using VerbHandlers = std::array<ParamMiddleware, Http::scoped_enum_len<Http::Verb>()>;
+
         Middleware m_fallback;
-        std::map<std::string, Middleware> m_handlers;
-        std::string_view m_host_name;
-        std::string_view m_host_port;
+        StaticDispatch m_static_dispatch; // may be null
+        RadixRouter m_router; // route patterns to `m_handlers` slots
+        std::vector<VerbHandlers> m_handlers;
+        std::vector<std::shared_ptr<StaticMount>> m_mounts; // longest URL prefix first
+        std::vector<FilterBox> m_filters; // outermost first
 
-        /// NOTE: checks if the request has a valid "Host" (if HTTP/1.1)
-        [[nodiscard]] auto check_host_header(const Http::Request& req) const -> bool;
+        /// NOTE: Binds `handler_box` to each verb of `verbs` on the pattern, failing without changes if any of them is already bound.
+        [[nodiscard]] auto bind_handler(Http::VerbSet verbs, const std::string& route_pattern, const ParamMiddleware& handler_box) -> bool;
 
-    public:
-        explicit Routes(std::string_view server_host_name, std::string_view server_host_port);
+        [[nodiscard]] static auto allowed_verbs_of(const VerbHandlers& verb_handlers) noexcept -> Http::VerbSet;
 
-        [[maybe_unused]] auto set_handler(const std::string& route_path, Middleware handler_box) noexcept -> bool;
+        /// NOTE: The terminal of the filter chain: finds and runs the request's handler, see `dispatch_handler`.
+        [[nodiscard]] auto route_request(Http::Request& req) const -> Http::Response;
 
-        template <typename Req> requires (std::is_same_v<std::remove_cvref_t<Req>, Http::Request>)
-        [[nodiscard]] auto dispatch_handler(Req&& req) const noexcept -> Http::Response {
-            auto req_uri = Uri::parse_simple_uri(req.uri);
+        [[nodiscard]] static auto route_request_thunk(const void* routes_p, Http::Request& req) -> Http::Response;
 
-            // 1. Validate request syntax & semantics to prevent false-positive responses.
-            if (!check_host_header(req) || !req_uri) {
-                // Protocol syntax errors: `Host` header is missing or URI is malformed. 
-                Http::Response res;
-                App::EmptyReply uri_syntax_error {Http::Status::http_bad_request};
+    public:
+        /// NOTE: One site's routes. The `Host` of each request is matched beforehand, see `VirtualHosts`.
+        Routes();
 
-                App::ResponseUtils::response_put_all(res, uri_syntax_error);
+        /// NOTE: Binds a handler to one verb of a route, so it never sees other verbs. The route answers 405 to verbs without handlers and OPTIONS by itself, both with an `Allow` list. HEAD cannot be bound, as it is served by the GET handler.
+        [[maybe_unused]] auto set_handler(Http::Verb verb, const std::string& route_pattern, Middleware handler_box) -> bool;
 
-                return res;
-            }
+        /// NOTE: `route_pattern` may contain `:name` segment captures and a final `*name` capture, see `RadixRouter`.
+        [[maybe_unused]] auto set_handler(Http::Verb verb, const std::string& route_pattern, ParamMiddleware handler_box) -> bool;
 
-            const auto& uri_obj = req_uri.value();
+        /// NOTE: Binds the handler to all of `any_route_verbs`, leaving verb checks to the handler.
+        [[maybe_unused]] auto set_handler(const std::string& route_path, Middleware handler_box) -> bool;
 
-            // 2. Try finding the matching route handler by URI path.
-            if (auto handler_it = std::find_if(m_handlers.begin(), m_handlers.end(), [&uri_obj](const auto& route_handler_item) -> bool {
-                return route_handler_item.first == uri_obj.path();
-            }); handler_it != m_handlers.end()) {
-                return handler_it->second(std::forward<Req>(req), uri_obj.params());
-            }
+        [[maybe_unused]] auto set_handler(const std::string& route_pattern, ParamMiddleware handler_box) -> bool;
 
-            // 3. Call the default error handler on an unset middleware route. It gives a simple 404 response for now.
-            return m_fallback(req, {});
+        /// NOTE: Binds a GET handler whose responses are reused through a `ResponseMicrocache` with the given policy.
+        [[maybe_unused]] auto set_handler(const std::string& route_path, Middleware handler_box, MicrocachePolicy cache_policy) -> bool;
+
+        /// NOTE: Checks the build-time routes of `Table` before any dynamic handler. Only one static table may be used, so a later call replaces the earlier one.
+        template <typename Table>
+        void use_static_table() noexcept {
+            m_static_dispatch = &Table::dispatch;
         }
+
+        /// NOTE: Serves the files under `root_dir` for URI paths below `url_prefix`. Exact handlers still win over mounts, and nested mounts resolve by the longest prefix. Fails if `root_dir` is not a directory or the prefix is taken.
+        [[maybe_unused]] auto mount_directory(const std::string& url_prefix, const std::filesystem::path& root_dir) -> bool;
+
+        /// NOTE: Runs the filters in the order they were added, the first one outermost, around routing. Filters wrap every request, even malformed ones.
+        void add_filter(FilterBox filter);
+
+        /// NOTE: Handlers and filters may edit `req`, e.g a handler may move its body out, so callers must only rely on its other fields afterwards.
+        [[nodiscard]] auto dispatch_handler(Http::Request& req) const noexcept -> Http::Response;
     };
 }
 
@@ -0,0 +1,106 @@
+#ifndef DERKHTTPD_MYAPP_SMALL_FUNCTION_HPP
+#define DERKHTTPD_MYAPP_SMALL_FUNCTION_HPP
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace DerkHttpd::App {
+    constexpr std::size_t small_function_capacity = 48;
+
+    template <typename Signature, std::size_t Capacity = small_function_capacity>
+    class SmallFunction;
+
+    /**
+     * @brief Move-only callable that always stores its target inline, so wrapping one never allocates. Targets larger than `Capacity`, over-aligned or with a throwing move are rejected at compile time instead of spilling to the heap. Calls go through one function pointer, like `std::function`.
+     */
+    template <typename R, typename ... Args, std::size_t Capacity>
+    class SmallFunction<R(Args...), Capacity> {
+    private:
+        struct Ops {
+            R (*invoke)(const void* target, Args... args);
+            void (*relocate)(void* dest, void* src) noexcept; // move-constructs at `dest`, then destroys `src`
+            void (*destroy)(void* target) noexcept;
+        };
+
+        template <typename Fn>
+        static constexpr Ops ops_for {
+            .invoke = [](const void* target, Args... args) -> R {
+                return std::invoke(*static_cast<const Fn*>(target), std::forward<Args>(args)...);
+            },
+            .relocate = [](void* dest, void* src) noexcept {
+                ::new (dest) Fn {std::move(*static_cast<Fn*>(src))};
+                static_cast<Fn*>(src)->~Fn();
+            },
+            .destroy = [](void* target) noexcept {
+                static_cast<Fn*>(target)->~Fn();
+            },
+        };
+
+        alignas(std::max_align_t) std::byte m_storage[Capacity];
+        const Ops* m_ops; // null when empty
+
+        void reset() noexcept {
+            if (m_ops) {
+                m_ops->destroy(m_storage);
+                m_ops = nullptr;
+            }
+        }
+
+    public:
+        SmallFunction() noexcept
+        : m_storage {}, m_ops {nullptr} {}
+
+        template <typename F> requires (!std::is_same_v<std::remove_cvref_t<F>, SmallFunction> && std::is_invocable_r_v<R, const std::decay_t<F>&, Args...>)
+        SmallFunction(F&& target) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F>)
+        : m_storage {}, m_ops {&ops_for<std::decay_t<F>>} {
+            using Fn = std::decay_t<F>;
+
+            static_assert(sizeof(Fn) <= Capacity, "SmallFunction target is too large for its inline buffer");
+            static_assert(alignof(Fn) <= alignof(std::max_align_t), "SmallFunction target is over-aligned");
+            static_assert(std::is_nothrow_move_constructible_v<Fn>, "SmallFunction target must be nothrow movable");
+
+            ::new (static_cast<void*>(m_storage)) Fn {std::forward<F>(target)};
+        }
+
+        SmallFunction(const SmallFunction&) = delete;
+        SmallFunction& operator=(const SmallFunction&) = delete;
+
+        SmallFunction(SmallFunction&& other) noexcept
+        : m_storage {}, m_ops {std::exchange(other.m_ops, nullptr)} {
+            if (m_ops) {
+                m_ops->relocate(m_storage, other.m_storage);
+            }
+        }
+
+        SmallFunction& operator=(SmallFunction&& other) noexcept {
+            if (this != &other) {
+                reset();
+
+                if (other.m_ops) {
+                    other.m_ops->relocate(m_storage, other.m_storage);
+                    m_ops = std::exchange(other.m_ops, nullptr);
+                }
+            }
+
+            return *this;
+        }
+
+        ~SmallFunction() {
+            reset();
+        }
+
+        [[nodiscard]] explicit operator bool() const noexcept {
+            return m_ops != nullptr;
+        }
+
+        /// NOTE: Calling an empty `SmallFunction` is undefined, so check it first where that can happen.
+        auto operator()(Args ... args) const -> R {
+            return m_ops->invoke(m_storage, std::forward<Args>(args)...);
+        }
+    };
+}
+
+#endif
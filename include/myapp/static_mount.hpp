@@ -0,0 +1,57 @@
+#ifndef DERKHTTPD_MYAPP_STATIC_MOUNT_HPP
+#define DERKHTTPD_MYAPP_STATIC_MOUNT_HPP
+
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "myhttp/msgs.hpp"
+#include "myapp/contents.hpp"
+
+namespace DerkHttpd::App {
+    /**
+     * @brief Serves files under a root directory for every URI path below a URL prefix, e.g `/static/app.js` -> `./www/app.js`. Each file's `Content-Type`, `Content-Length`, `Last-Modified`, `ETag` and `Accept-Ranges` headers are formatted once per file version and copied into later responses.
+     */
+    class StaticMount {
+    private:
+        struct HeaderBlock {
+            FileIdentity identity;
+            Http::HeaderMap headers;
+        };
+
+        std::string m_url_prefix;
+        std::filesystem::path m_root_dir; // canonical
+        mutable std::mutex m_blocks_mtx;
+        mutable std::unordered_map<std::string, HeaderBlock> m_blocks;
+
+        /// NOTE: Copies the header block matching `identity` into `headers`, rebuilding it if the file changed since it was made. The copy lands on `headers`' own memory resource, e.g the exchange's arena.
+        void put_headers(Http::HeaderMap& headers, const std::filesystem::path& file_path, const FileIdentity& identity, std::string_view mime) const;
+
+    public:
+        static constexpr std::string_view index_file_name = "index.html";
+
+        /// NOTE: `canonical_root` must already be an absolute, canonical directory path, see `Routes::mount_directory`.
+        StaticMount(std::string url_prefix, std::filesystem::path canonical_root) noexcept;
+
+        StaticMount(const StaticMount&) = delete;
+        StaticMount& operator=(const StaticMount&) = delete;
+        StaticMount(StaticMount&&) = delete;
+        StaticMount& operator=(StaticMount&&) = delete;
+
+        [[nodiscard]] auto get_url_prefix() const noexcept -> std::string_view;
+
+        /// NOTE: Checks if the URI path is the prefix itself or lies below it at a segment boundary, so `/static` never matches `/staticfoo`.
+        [[nodiscard]] auto matches(std::string_view uri_path) const noexcept -> bool;
+
+        /// NOTE: Maps a matching URI path to a regular file under the root, following directory paths to their `index.html`. Rejects `..` segments, and any path whose symlinks resolve outside of the root.
+        [[nodiscard]] auto resolve(std::string_view uri_path) const -> std::optional<std::filesystem::path>;
+
+        /// NOTE: Only GET is served (HEAD is mapped to GET before dispatch). OPTIONS gets a 204 and other methods a 405, both listing the allowed methods.
+        [[nodiscard]] auto serve(const Http::Request& req, std::string_view uri_path) const -> Http::Response;
+    };
+}
+
+#endif
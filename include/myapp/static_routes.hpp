@@ -0,0 +1,216 @@
+#ifndef DERKHTTPD_MYAPP_STATIC_ROUTES_HPP
+#define DERKHTTPD_MYAPP_STATIC_ROUTES_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "myhttp/enums.hpp"
+#include "myhttp/msgs.hpp"
+#include "myuri/uri.hpp"
+
+namespace DerkHttpd::App {
+    /// NOTE: Wraps a string literal so route paths can be template arguments, e.g `StaticRoute<"/lorem", serve_lorem>`.
+    template <std::size_t N>
+    struct RouteLiteral {
+        std::array<char, N> text;
+
+        consteval RouteLiteral(const char (&literal)[N]) noexcept
+        : text {} {
+            std::copy_n(literal, N, text.begin());
+        }
+
+        [[nodiscard]] constexpr auto view() const noexcept -> std::string_view {
+            return {text.data(), N - 1};
+        }
+    };
+
+    template <typename Fn>
+    concept StaticHandler = std::is_nothrow_copy_constructible_v<Fn> && std::is_invocable_r_v<Http::Response, const Fn&, Http::Request&, const Uri::QueryParams&>;
+
+    /// NOTE: Verbs a route takes when it names none. HEAD is always served by the GET handler.
+    constexpr Http::VerbSet any_route_verbs {Http::Verb::http_get, Http::Verb::http_post, Http::Verb::http_put, Http::Verb::http_delete};
+
+    /// NOTE: One exact path bound to a handler known at compile time: a function pointer or a captureless lambda. The handler only sees the listed verbs, or any of `any_route_verbs` if none are listed.
+    template <RouteLiteral Path, auto Handler, Http::Verb ... Verbs> requires (StaticHandler<decltype(Handler)>)
+    struct StaticRoute {
+        static constexpr std::string_view path = Path.view();
+        static constexpr auto handler = Handler;
+        static constexpr Http::VerbSet verbs = (sizeof...(Verbs) > 0) ? Http::VerbSet {Verbs...} : any_route_verbs;
+
+        static_assert(path.starts_with('/'), "static route paths must be absolute");
+        static_assert(((Verbs != Http::Verb::http_head) && ...), "HEAD is served by the GET handler");
+    };
+
+    /// NOTE: FNV-1a, seeded so `StaticRouteTable` can search for a seed without bucket collisions.
+    [[nodiscard]] constexpr auto route_hash(std::uint64_t seed, std::string_view path) noexcept -> std::uint64_t {
+        std::uint64_t hash = 14695981039346656037ULL ^ seed;
+
+        for (const auto c : path) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+    /**
+     * @brief Exact-path routing table fixed at build time. The compiler searches for a hash seed that sends every distinct path to its own bucket, so a lookup is one hash, one bucket load and one string compare. Each path then picks its route by verb from a small array, and the matched handler is called directly through an unrolled `if` chain over the routes, which lets the compiler inline it instead of going through a `std::function`.
+     */
+    template <typename... Routes>
+    class StaticRouteTable {
+    public:
+        static constexpr std::size_t route_count = sizeof...(Routes);
+
+    private:
+        static_assert(route_count > 0, "a static route table needs at least one route");
+
+        static constexpr std::size_t bucket_count = std::bit_ceil(route_count * 2);
+        static constexpr std::size_t empty_bucket = route_count;
+        static constexpr std::size_t verb_count = Http::scoped_enum_len<Http::Verb>();
+        static constexpr std::uint64_t max_seed_tries = 1 << 16;
+
+        static constexpr std::array<std::string_view, route_count> m_paths {Routes::path...};
+        static constexpr std::array<Http::VerbSet, route_count> m_verbs {Routes::verbs...};
+
+        /// NOTE: Routes sharing a path are reached through the entry of the first one.
+        struct PathEntry {
+            Http::VerbSet verbs;
+            std::array<std::size_t, verb_count> route_of_verb;
+        };
+
+        struct HashPlan {
+            std::uint64_t seed;
+            std::array<std::size_t, bucket_count> buckets; // indexes of each path's first route, `empty_bucket` if unused
+            bool found;
+        };
+
+        [[nodiscard]] static consteval auto first_route_of(std::size_t route_idx) noexcept -> std::size_t {
+            for (std::size_t other_idx = 0; other_idx < route_idx; ++other_idx) {
+                if (m_paths[other_idx] == m_paths[route_idx]) {
+                    return other_idx;
+                }
+            }
+
+            return route_idx;
+        }
+
+        [[nodiscard]] static consteval auto has_disjoint_verbs() noexcept -> bool {
+            for (std::size_t i = 0; i < route_count; ++i) {
+                for (std::size_t j = i + 1; j < route_count; ++j) {
+                    if (m_paths[i] == m_paths[j] && m_verbs[i].overlaps(m_verbs[j])) {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        [[nodiscard]] static consteval auto plan_entries() noexcept -> std::array<PathEntry, route_count> {
+            std::array<PathEntry, route_count> entries {};
+
+            for (std::size_t route_idx = 0; route_idx < route_count; ++route_idx) {
+                auto& entry = entries[first_route_of(route_idx)];
+
+                for (std::size_t verb_idx = 0; verb_idx < verb_count; ++verb_idx) {
+                    if (const auto verb = static_cast<Http::Verb>(verb_idx); m_verbs[route_idx].contains(verb)) {
+                        entry.verbs.add(verb);
+                        entry.route_of_verb[verb_idx] = route_idx;
+                    }
+                }
+            }
+
+            return entries;
+        }
+
+        [[nodiscard]] static consteval auto plan_buckets() noexcept -> HashPlan {
+            HashPlan plan {.seed = 0, .buckets = {}, .found = false};
+
+            for (; plan.seed < max_seed_tries && !plan.found; ++plan.seed) {
+                plan.buckets.fill(empty_bucket);
+                plan.found = true;
+
+                for (std::size_t route_idx = 0; route_idx < route_count && plan.found; ++route_idx) {
+                    if (first_route_of(route_idx) != route_idx) {
+                        continue;
+                    }
+
+                    auto& bucket = plan.buckets[route_hash(plan.seed, m_paths[route_idx]) & (bucket_count - 1)];
+
+                    plan.found = bucket == empty_bucket;
+                    bucket = route_idx;
+                }
+            }
+
+            // Undo the last increment so `seed` is the one that worked.
+            --plan.seed;
+
+            return plan;
+        }
+
+        static_assert(has_disjoint_verbs(), "static routes sharing a path must not share verbs");
+
+        static constexpr std::array<PathEntry, route_count> m_entries = plan_entries();
+        static constexpr HashPlan m_plan = plan_buckets();
+
+        static_assert(m_plan.found, "no collision-free hash seed found for the static routes");
+
+        /// NOTE: Unrolls to one direct call per route, which the optimizer can lower to a jump table. The handler's response is returned in place, never default-made and assigned over.
+        template <std::size_t RouteIdx = 0>
+        [[nodiscard]] static auto invoke_route(std::size_t route_idx, Http::Request& req, const Uri::QueryParams& params) -> Http::Response {
+            if constexpr (RouteIdx + 1 < route_count) {
+                if (route_idx != RouteIdx) {
+                    return invoke_route<RouteIdx + 1>(route_idx, req, params);
+                }
+            }
+
+            return std::invoke(std::tuple_element_t<RouteIdx, std::tuple<Routes...>>::handler, req, params);
+        }
+
+        [[nodiscard]] static constexpr auto lookup(std::string_view path) noexcept -> const PathEntry* {
+            const auto route_idx = m_plan.buckets[route_hash(m_plan.seed, path) & (bucket_count - 1)];
+
+            if (route_idx == empty_bucket || m_paths[route_idx] != path) {
+                return nullptr;
+            }
+
+            return &m_entries[route_idx];
+        }
+
+    public:
+        /// NOTE: Gives the verbs routed for `path`, which is empty if the table has no such exact path.
+        [[nodiscard]] static constexpr auto find(std::string_view path) noexcept -> Http::VerbSet {
+            if (const auto entry_p = lookup(path); entry_p) {
+                return entry_p->verbs;
+            }
+
+            return {};
+        }
+
+        /// NOTE: Matches the signature of `Routes::StaticDispatch`, see `Routes::use_static_table`. The error gives the verbs allowed on `path`, which is empty when the table has no such path.
+        [[nodiscard]] static auto dispatch(std::string_view path, Http::Request& req, const Uri::QueryParams& params) -> std::expected<Http::Response, Http::VerbSet> {
+            const auto entry_p = lookup(path);
+
+            if (!entry_p) {
+                return std::unexpected {Http::VerbSet {}};
+            }
+
+            if (!entry_p->verbs.contains(req.http_verb)) {
+                return std::unexpected {entry_p->verbs};
+            }
+
+            return invoke_route(entry_p->route_of_verb[static_cast<std::size_t>(req.http_verb)], req, params);
+        }
+    };
+}
+
+#endif
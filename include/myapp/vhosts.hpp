@@ -0,0 +1,80 @@
+#ifndef DERKHTTPD_MYAPP_VHOSTS_HPP
+#define DERKHTTPD_MYAPP_VHOSTS_HPP
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "myhttp/msgs.hpp"
+#include "myapp/routes.hpp"
+
+namespace DerkHttpd::App {
+    /// NOTE: DNS names are at most 253 chars, which leaves room for a bracketed IPv6 literal too.
+    constexpr std::size_t max_host_length = 256;
+
+    using HostBuffer = std::array<char, max_host_length>;
+
+    /// NOTE: Normalizes a `Host` value into `out`: drops the port and one trailing dot, then lowercases it, e.g `WWW.Example.com.:8080` -> `www.example.com`. Gives nothing for an empty, oversized or malformed host.
+    [[nodiscard]] auto normalize_host(std::string_view raw_host, HostBuffer& out) noexcept -> std::optional<std::string_view>;
+
+    /**
+     * @brief Picks the site that serves a request by its `Host`: an exact name first, then the closest wildcard like `*.example.com`, and last the default site if one is set. Both tables are hashed, so picking costs one probe per host label at worst. Requests that match nothing get a 400, as do HTTP/1.1 requests without a `Host`.
+     */
+    class VirtualHosts {
+    private:
+        struct HostHash {
+            using is_transparent = void;
+
+            [[nodiscard]] auto operator()(std::string_view host) const noexcept -> std::size_t {
+                return std::hash<std::string_view> {}(host);
+            }
+        };
+
+        using SiteTable = std::unordered_map<std::string, Routes*, HostHash, std::equal_to<>>;
+
+        /// NOTE: The site picked for a connection's last `Host`, keyed by the value as sent. Clients almost never change it, so later requests skip normalizing and the table lookups.
+        struct HostBinding {
+            std::string raw_host;
+            const Routes* site;
+        };
+
+        std::vector<std::unique_ptr<Routes>> m_sites; // heap-pinned, so the tables' pointers stay valid
+        SiteTable m_exact_sites;
+        SiteTable m_wildcard_sites; // keyed by the suffix after `*.`
+        Routes* m_default_site; // may be null
+        mutable std::vector<HostBinding> m_bindings; // indexed by client fd
+
+        [[nodiscard]] auto find_site(std::string_view host) const noexcept -> const Routes*;
+
+        /// NOTE: Gives the site of a raw `Host` value, or null if it is malformed or matches no site. Only the task serving `fd` touches its binding, as `Net::Handles` never runs two exchanges of one connection at once.
+        [[nodiscard]] auto bind_site(int fd, std::string_view raw_host) const -> const Routes*;
+
+    public:
+        static constexpr std::size_t default_binding_slots = 1024;
+
+        /// NOTE: Connections whose fd is at least `binding_slots` still work, but repeat the host lookup on every request.
+        explicit VirtualHosts(std::size_t binding_slots = default_binding_slots);
+
+        VirtualHosts(const VirtualHosts&) = delete;
+        VirtualHosts& operator=(const VirtualHosts&) = delete;
+        VirtualHosts(VirtualHosts&&) = delete;
+        VirtualHosts& operator=(VirtualHosts&&) = delete;
+
+        /// NOTE: Gives the routes of `host_pattern`, making them on first use: an exact name like `example.com` or a wildcard like `*.example.com`, which matches subdomains at any depth but not `example.com` itself. Gives null for a malformed pattern.
+        [[nodiscard]] auto add_host(std::string_view host_pattern) -> Routes*;
+
+        /// NOTE: Lets an added host also serve requests whose `Host` matches no other site, including HTTP/1.0 requests without one. Fails if the pattern was never added.
+        [[maybe_unused]] auto set_default_host(std::string_view host_pattern) -> bool;
+
+        /// NOTE: Routes `req` through the site of its `Host`, see `Routes::dispatch_handler`.
+        [[nodiscard]] auto dispatch_handler(int fd, Http::Request& req) const -> Http::Response;
+    };
+}
+
+#endif
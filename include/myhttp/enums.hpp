@@ -1,7 +1,9 @@
 #ifndef DERK_HTTPD_MYHTTP_ENUMS_HPP
 #define DERK_HTTPD_MYHTTP_ENUMS_HPP
 
+#include <concepts>
 #include <cstdint>
+#include <string>
 #include <string_view>
 #include <type_traits>
 
@@ -12,11 +14,14 @@ namespace DerkHttpd::Http {
         http_post,
         http_put,
         http_delete,
+        http_options,
         last,
     };
 
     enum class Status : uint32_t {
         http_ok,
+        http_no_content,
+        http_partial_content,
         http_not_modified,
         http_permanent_redirect,
         http_bad_request,
@@ -26,9 +31,11 @@ namespace DerkHttpd::Http {
         http_length_required,
         http_precondition_failed,
         http_content_too_large,
+        http_range_not_satisfiable,
         http_request_header_fields_too_large,
         http_server_error,
         http_not_implemented,
+        http_service_unavailable,
         last,
     };
 
@@ -39,6 +46,15 @@ namespace DerkHttpd::Http {
         last,
     };
 
+    /// NOTE: Lists the supported `Content-Encoding` codings in ascending order of server preference.
+    enum class ContentCoding : uint8_t {
+        identity,
+        deflate,
+        gzip,
+        zstd,
+        last,
+    };
+
     [[nodiscard]] auto verb_enum_to_name(Verb v) noexcept -> std::string_view;
 
     [[nodiscard]] auto status_enum_to_name(Status s) noexcept -> std::string_view;
@@ -47,10 +63,51 @@ namespace DerkHttpd::Http {
 
     [[nodiscard]] auto schema_enum_to_name(Schema schema) noexcept -> std::string_view;
 
+    [[nodiscard]] auto coding_enum_to_name(ContentCoding coding) noexcept -> std::string_view;
+
     template <typename E> requires requires {{E::last};} && std::is_enum_v<E>
     [[nodiscard]] consteval auto scoped_enum_len() noexcept -> std::size_t {
         return static_cast<std::size_t>(E::last);
     }
+
+    static_assert(scoped_enum_len<Verb>() <= 8, "VerbSet must fit every Verb in its bits");
+
+    /// NOTE: Small set of verbs as bits, e.g the methods a route allows.
+    class VerbSet {
+    private:
+        std::uint8_t m_bits;
+
+        [[nodiscard]] static constexpr auto bit_of(Verb v) noexcept -> std::uint8_t {
+            return static_cast<std::uint8_t>(1U << static_cast<unsigned>(v));
+        }
+
+    public:
+        constexpr VerbSet() noexcept
+        : m_bits {0} {}
+
+        template <std::same_as<Verb> ... Verbs>
+        constexpr explicit VerbSet(Verbs ... verbs) noexcept
+        : m_bits {static_cast<std::uint8_t>((0U | ... | bit_of(verbs)))} {}
+
+        constexpr void add(Verb v) noexcept {
+            m_bits |= bit_of(v);
+        }
+
+        [[nodiscard]] constexpr auto contains(Verb v) const noexcept -> bool {
+            return (m_bits & bit_of(v)) != 0;
+        }
+
+        [[nodiscard]] constexpr auto empty() const noexcept -> bool {
+            return m_bits == 0;
+        }
+
+        [[nodiscard]] constexpr auto overlaps(VerbSet other) const noexcept -> bool {
+            return (m_bits & other.m_bits) != 0;
+        }
+    };
+
+    /// NOTE: Lists the set's verbs in enum order for an `Allow` header, e.g `GET, HEAD, OPTIONS`.
+    [[nodiscard]] auto verb_set_to_allow_value(VerbSet verbs) -> std::string;
 }
 
 #endif
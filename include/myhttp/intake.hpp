@@ -3,22 +3,36 @@
 
 #include <expected>
 #include <format>
+#include <functional>
+#include <memory_resource>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "mynet/io_funcs.hpp"
+#include "mynet/memory_budget.hpp"
 #include "myhttp/msgs.hpp"
 
 namespace DerkHttpd::Http {
+    /// NOTE: Per-connection limits on what one request may make the server hold. Bodies also reserve their size from `Net::MemoryBudget` before being read.
     struct IntakeConfig {
-        int max_body_size = 2048;
+        int max_body_size = 2048; // across all chunks of a chunked body
+        int max_header_size = 480; // per header line, which must also fit the read buffer
+        int max_header_block_size = 8192; // across all header lines
         // bool report_errors = true;
     };
 
+    /// NOTE: Why a request was refused. Syntax errors leave the stream unusable, so only refusals over a limit carry a status to answer with before closing.
+    struct IntakeError {
+        std::string message;
+        std::optional<Status> reply_status;
+    };
+
     enum class TokenTag : uint16_t {
         spaces, // SP, TAB, CR, LF
         identifier,
-        verb, // words matching GET, HEAD, POST, PUT, DELETE
+        verb, // words matching GET, HEAD, POST, PUT, DELETE, OPTIONS
         path, // raw URIs
         schema, // raw text of form `'HTTP' '/' <digit> '.' <digit>`
         colon, // ':'
@@ -49,25 +63,43 @@ namespace DerkHttpd::Http {
             httpin_state_done,
         };
 
+        /// NOTE: `rel_uri` views `m_buffer` like `RawHeader`, so it must be stored before the next line is read.
         struct RawReqLine {
-            std::string rel_uri;
+            std::string_view rel_uri;
             Verb verb;
             Schema schema;
         };
 
+        /// NOTE: Views into `m_buffer`, so a header must be stored before the next line is read.
         struct RawHeader {
-            std::string key;
-            std::string value;
+            std::string_view key;
+            std::string_view value;
+        };
+
+        /// NOTE: Lets the lexeme tables be probed by views into `m_buffer` without building a key string.
+        struct LexemeHash {
+            using is_transparent = void;
+
+            [[nodiscard]] auto operator()(std::string_view lexeme) const noexcept -> std::size_t {
+                return std::hash<std::string_view> {}(lexeme);
+            }
         };
 
         Net::ByteBuffer<> m_buffer;
-        std::unordered_map<std::string, Verb, std::hash<std::string>> m_verbs;
-        std::unordered_map<std::string, Schema, std::hash<std::string>> m_schemas;
-        Request m_temp;
+        std::unordered_map<std::string, Verb, LexemeHash, std::equal_to<>> m_verbs;
+        std::unordered_map<std::string, Schema, LexemeHash, std::equal_to<>> m_schemas;
+        std::optional<Request> m_temp; // rebuilt per request on the caller's memory resource
+        Net::MemoryLease m_body_lease; // covers the last request's body until `release_body_budget()`
         State m_state;
+        Status m_reject_status; // the reply to a `httpin_state_constraint_error`
+        int m_header_block_n;
         int m_max_header_size;
+        int m_max_header_block_size;
         int m_max_body_size;
 
+        /// NOTE: Reserves room for `n` more body bytes. On failure, the request is to be refused with a 413 past `max_body_size`, or with a 503 when the process is out of memory budget.
+        [[nodiscard]] auto reserve_body(int n) noexcept -> bool;
+
         [[nodiscard]] auto parse_request_line(std::string_view sv) -> std::expected<RawReqLine, std::string>;
         [[nodiscard]] auto parse_request_header(std::string_view sv) -> std::expected<RawHeader, std::string>;
 
@@ -80,7 +112,11 @@ namespace DerkHttpd::Http {
     public:
         explicit HttpIntake(IntakeConfig config) noexcept;
 
-        [[nodiscard]] auto operator()(int fd) -> std::expected<Request, std::string>;
+        /// NOTE: The request's headers and URI are allocated from `arena`, which must outlive the returned request.
+        [[nodiscard]] auto operator()(int fd, std::pmr::memory_resource* arena = std::pmr::get_default_resource()) -> std::expected<Request, IntakeError>;
+
+        /// NOTE: Gives back the memory budget of the last request's body, once its response is queued or the connection closes.
+        void release_body_budget() noexcept;
     };
 }
 
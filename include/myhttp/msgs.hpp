@@ -1,9 +1,16 @@
 #ifndef DERK_HTTPD_MYHTTP_MSGS_HPP
 #define DERK_HTTPD_MYHTTP_MSGS_HPP
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <map>
 #include <variant>
@@ -14,6 +21,82 @@
 
 namespace DerkHttpd::Http {
     using Blob = std::vector<char>;
+
+    /**
+     * @brief An immutable view of payload bytes whose owner is refcounted, e.g a cached file or a precompressed variant. Copies and slices share that one buffer, so any number of responses (and the writes still sending them) can serve it at once. Bytes with static storage duration need no owner.
+     */
+    class SharedBytes {
+    private:
+        std::shared_ptr<const void> m_owner;
+        std::string_view m_bytes;
+
+        SharedBytes(std::shared_ptr<const void> owner, std::string_view bytes) noexcept
+        : m_owner {std::move(owner)}, m_bytes {bytes} {}
+
+    public:
+        SharedBytes() noexcept
+        : m_owner {}, m_bytes {} {}
+
+        /// NOTE: Moves `blob` into the shared buffer, so its bytes are never copied.
+        explicit SharedBytes(Blob&& blob)
+        : SharedBytes {} {
+            auto owned_blob = std::make_shared<const Blob>(std::move(blob));
+
+            m_bytes = std::string_view {owned_blob->data(), owned_blob->size()};
+            m_owner = std::move(owned_blob);
+        }
+
+        explicit SharedBytes(std::string&& text)
+        : SharedBytes {} {
+            auto owned_text = std::make_shared<const std::string>(std::move(text));
+
+            m_bytes = std::string_view {*owned_text};
+            m_owner = std::move(owned_text);
+        }
+
+        /// NOTE: `bytes` must outlive every response, e.g a string literal or an embedded asset.
+        [[nodiscard]] static auto from_static(std::string_view bytes) noexcept -> SharedBytes {
+            return SharedBytes {nullptr, bytes};
+        }
+
+        /// NOTE: Views `length` bytes from `offset` while sharing the same owner. Both are clamped to this view.
+        [[nodiscard]] auto slice(std::size_t offset, std::size_t length) const noexcept -> SharedBytes {
+            return SharedBytes {m_owner, m_bytes.substr(std::min(offset, m_bytes.size()), length)};
+        }
+
+        [[nodiscard]] auto view() const noexcept -> std::string_view {
+            return m_bytes;
+        }
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t {
+            return m_bytes.size();
+        }
+
+        [[nodiscard]] auto empty() const noexcept -> bool {
+            return m_bytes.empty();
+        }
+
+        /// NOTE: Keeps the bytes alive for as long as the returned pointer, e.g while a queued write still refers to them.
+        [[nodiscard]] auto owner() const noexcept -> const std::shared_ptr<const void>& {
+            return m_owner;
+        }
+    };
+
+    /// NOTE: A payload gathered from several shared pieces, e.g `multipart/byteranges` parts sliced from one cached file between their part headers. The outtake sends adjacent pieces by one `writev`.
+    using SharedChain = std::vector<SharedBytes>;
+
+    /// NOTE: Refers to a byte span of an on-disk file that the outtake sends straight from the page cache, so file payloads are never staged in user space.
+    struct FileRegion {
+        std::filesystem::path path;
+        std::uintmax_t offset;
+        std::uintmax_t length;
+    };
+
+    /// NOTE: Refers to payload bytes with static storage duration, e.g an embedded asset, which the outtake sends without copying. The non-empty `coded_variants` are precompressed forms of `bytes`, indexed by `ContentCoding`.
+    struct StaticBytes {
+        std::string_view bytes;
+        std::array<std::string_view, scoped_enum_len<ContentCoding>()> coded_variants;
+    };
 }
 
 namespace DerkHttpd::App {
@@ -25,6 +108,11 @@ namespace DerkHttpd::App {
         virtual auto next() -> std::optional<Http::Blob> = 0;
 
         virtual void clear() = 0;
+
+        /// NOTE: Checks if `next()` can return without blocking, e.g when the chunk's read was offloaded and has completed. In-memory sources are always ready.
+        [[nodiscard]] virtual auto is_ready() const -> bool {
+            return true;
+        }
     };
 
     /// NOTE: see `ChunkIterBase` for TODOs.
@@ -32,22 +120,43 @@ namespace DerkHttpd::App {
 }
 
 namespace DerkHttpd::Http {
-    struct Request {
-        Blob body;
-        std::map<std::string, std::string> headers;
-        std::string uri;
-        Verb http_verb;
-        Schema http_schema;
-    };
+    /// NOTE: Header names and values come from the memory resource of the message they belong to, e.g an exchange's arena. The transparent comparator lets `find` and `contains` take literals without building a key string.
+    using HeaderMap = std::pmr::map<std::pmr::string, std::pmr::string, std::less<>>;
 
     struct Response {
         // For avoiding circular dependency: stores any specific `App::ResourceKind`.
-        std::variant<Blob, App::ChunkIterPtr> body;
-        std::map<std::string, std::string> headers;
+        std::variant<Blob, App::ChunkIterPtr, FileRegion, StaticBytes, SharedBytes, SharedChain> body;
+        HeaderMap headers;
         std::variant<std::chrono::seconds, std::filesystem::file_time_type> modify_timestamp; // seconds since Epoch of modify time / file modification `std::chrono::time_point`
+        std::filesystem::path origin; // backing file of a file resource's payload, but empty for generated payloads
         Status http_status;
         Schema http_schema;
     };
+
+    struct Request {
+        Blob body;
+        HeaderMap headers;
+        std::pmr::string uri;
+        Verb http_verb;
+        Schema http_schema;
+
+        /// NOTE: Gives the memory resource backing this request's headers and URI, which is the exchange's arena when the intake was given one.
+        [[nodiscard]] auto resource() const noexcept -> std::pmr::memory_resource* {
+            return headers.get_allocator().resource();
+        }
+
+        /// NOTE: Makes an empty response whose headers share this request's memory resource. Handlers should start from it, since assigning across resources copies every header.
+        [[nodiscard]] auto make_response() const -> Response {
+            return Response {
+                .body = {},
+                .headers = HeaderMap {resource()},
+                .modify_timestamp = {},
+                .origin = {},
+                .http_status = {},
+                .http_schema = {},
+            };
+        }
+    };
 }
 
 #endif
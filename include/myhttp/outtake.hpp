@@ -1,39 +1,39 @@
 #ifndef DERK_HTTPD_MYHTTP_OUTTAKE_HPP
 #define DERK_HTTPD_MYHTTP_OUTTAKE_HPP
 
-#include "mynet/io_funcs.hpp"
+#include "mynet/outbound.hpp"
 #include "myhttp/msgs.hpp"
 
 namespace DerkHttpd::Http {
+    /**
+     * @brief Serializes responses into a connection's `Net::OutboundQueue`: the status line and headers become one buffered segment, while bodies are queued as buffered bytes, static or shared spans, file spans or a chunk producer. The queue's owner decides when the bytes actually get sent.
+     */
     class HttpOuttake {
     private:
-        enum class SerializeState : uint8_t {
-            srz_name,
-            srz_delim,
-            srz_value,
-            srz_crlf,
-            srz_err,
-        };
+        Net::OutBytes m_head_bytes;
 
-        Net::ByteBuffer<> m_reply_bytes;
-        std::size_t m_load_count;
+        void serialize(std::string_view sv);
 
-        void reset() noexcept;
+        void serialize_status_line(Schema schema, Status status);
 
-        auto serialize(std::string_view sv) noexcept -> bool;
+        void serialize_batched_headers(const HeaderMap& headers);
 
-        [[nodiscard]] auto write_status_line(int fd, Schema schema, Status status) -> Net::IOResult<ssize_t>;
+        [[nodiscard]] auto queue_body(Net::OutboundQueue& outbound, Blob&& blob) -> bool;
 
-        [[nodiscard]] auto write_batched_headers(int fd, const std::map<std::string, std::string>& headers) -> Net::IOResult<ssize_t>;
+        [[nodiscard]] auto queue_body(Net::OutboundQueue& outbound, App::ChunkIterPtr chunking_it) -> bool;
 
-        [[nodiscard]] auto write_body(int fd, const Blob& blob) -> Net::IOResult<ssize_t>;
+        [[nodiscard]] auto queue_body(Net::OutboundQueue& outbound, const FileRegion& region) -> bool;
 
-        [[nodiscard]] auto write_body(int fd, App::ChunkIterPtr chunking_it) -> Net::IOResult<ssize_t>;
+        [[nodiscard]] auto queue_body(Net::OutboundQueue& outbound, const StaticBytes& static_bytes) -> bool;
+
+        [[nodiscard]] auto queue_body(Net::OutboundQueue& outbound, SharedBytes&& shared_bytes) -> bool;
+
+        [[nodiscard]] auto queue_body(Net::OutboundQueue& outbound, SharedChain&& shared_chain) -> bool;
 
     public:
         HttpOuttake() noexcept;
 
-        [[nodiscard]] auto operator()(int fd, const Response& res) -> bool;
+        [[nodiscard]] auto operator()(Response&& res, Net::OutboundQueue& outbound) -> bool;
     };
 }
 
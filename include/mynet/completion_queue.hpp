@@ -0,0 +1,58 @@
+#ifndef DERK_HTTPD_MYNET_COMPLETION_QUEUE_HPP
+#define DERK_HTTPD_MYNET_COMPLETION_QUEUE_HPP
+
+#include <atomic>
+#include <concepts>
+
+namespace DerkHttpd::Net {
+    /// NOTE: A node that carries its own link, so pushing never allocates.
+    template <typename Node>
+    concept IntrusiveNode = requires (Node& node) {
+        {node.next} -> std::same_as<Node*&>;
+    };
+
+    /**
+     * @brief Lock-free multi-producer, single-consumer queue of caller-owned nodes. Producers push with one CAS. The consumer takes the whole batch with one exchange, so no node is ever popped while another thread can still see it, and ABA cannot happen. A node must not be pushed again until the consumer has taken it.
+     */
+    template <IntrusiveNode Node>
+    class CompletionQueue {
+    private:
+        std::atomic<Node*> m_head;
+
+    public:
+        CompletionQueue() noexcept
+        : m_head {nullptr} {}
+
+        CompletionQueue(const CompletionQueue&) = delete;
+        CompletionQueue& operator=(const CompletionQueue&) = delete;
+        CompletionQueue(CompletionQueue&&) = delete;
+        CompletionQueue& operator=(CompletionQueue&&) = delete;
+
+        /// NOTE: Safe to call from any thread. The release ordering publishes everything written to `node` before the push.
+        void push(Node& node) noexcept {
+            auto old_head = m_head.load(std::memory_order_relaxed);
+
+            do {
+                node.next = old_head;
+            } while (!m_head.compare_exchange_weak(old_head, &node, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        /// NOTE: Consumer only. Detaches every pushed node and links them in push order, giving null when none are queued.
+        [[nodiscard]] auto take_all() noexcept -> Node* {
+            Node* newest_p = m_head.exchange(nullptr, std::memory_order_acquire);
+            Node* oldest_p = nullptr;
+
+            while (newest_p) {
+                auto next_p = newest_p->next;
+
+                newest_p->next = oldest_p;
+                oldest_p = newest_p;
+                newest_p = next_p;
+            }
+
+            return oldest_p;
+        }
+    };
+}
+
+#endif
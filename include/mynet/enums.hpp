@@ -7,6 +7,7 @@ namespace DerkHttpd::Net {
     enum class PollEvent : short {
         idle = 0x0,
         received = POLLIN,
+        sendable = POLLOUT,
         hangup = POLLHUP,
     };
 }
@@ -5,32 +5,191 @@
 #include <sys/socket.h>
 #include <poll.h>
 
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
+#include <utility>
 #include <expected>
-#include <algorithm>
 #include <string>
-#include <set>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <future>
 
+#include "mynet/completion_queue.hpp"
 #include "mynet/enums.hpp"
+#include "mynet/memory_budget.hpp"
+#include "mynet/outbound.hpp"
+#include "mynet/wake_signal.hpp"
 
 namespace DerkHttpd::Net {
+    /// NOTE: Names one connection across fd reuse: the fd plus its slot's generation when the client was accepted.
+    struct ConnectionId {
+        int fd;
+        std::uint32_t generation;
+    };
+
     struct IOTaskResult {
-        int pollfd_idx;
+        ConnectionId conn;
         bool ok;
     };
 
+    /**
+     * @brief Reports one task's result to whoever launched it, from whichever thread finishes the exchange. A task may report at once, or move this along with work it hands to another pool, e.g a handler executor, so its own thread is freed early. Only the first report counts, and dropping an unreported completer reports a failure, so the connection is always reaped.
+     */
+    class TaskCompleter {
+    public:
+        using ReportFn = void (*)(void* sink_p, IOTaskResult result) noexcept;
+
+    private:
+        ReportFn m_report_fn;
+        void* m_sink_p;
+        ConnectionId m_conn;
+
+    public:
+        TaskCompleter(ReportFn report_fn, void* sink_p, ConnectionId conn) noexcept;
+        ~TaskCompleter();
+
+        TaskCompleter(const TaskCompleter&) = delete;
+        TaskCompleter& operator=(const TaskCompleter&) = delete;
+        TaskCompleter(TaskCompleter&& other) noexcept;
+        TaskCompleter& operator=(TaskCompleter&& other) noexcept;
+
+        /// NOTE: Safe to call from any thread. The reactor may reuse the connection's queue and session right after, so the caller must be done with them.
+        void operator()(IOTaskResult result) noexcept;
+    };
+
+    /// NOTE: Keeps the per-connection state of the layers above, e.g parsers and buffers. `Handles` binds a state to each client on accept and gives it back on close, both on the reactor thread.
+    template <typename Pool>
+    concept SessionPool = requires (Pool& pool, int fd) {
+        typename Pool::Session;
+        pool.checkout(fd);
+        {pool.checkin(fd)} noexcept;
+        {pool.session_of(fd)} -> std::same_as<typename Pool::Session&>;
+    };
+
     class Handles {
     private:
+        /// NOTE: What a finished task reports back to the reactor through `m_completions`.
+        struct TaskCompletion {
+            IOTaskResult result;
+            TaskCompletion* next = nullptr;
+            Handles* owner = nullptr;
+        };
+
+        /// NOTE: One client's slot in the fd-indexed table. Its generation grows on every accept, so a result naming an older connection on the same fd is told apart from the current one.
+        struct Connection {
+            std::unique_ptr<OutboundQueue> outbound {}; // heap-pinned so in-flight tasks keep valid references, and recycled for the next client on this fd
+            std::unique_ptr<TaskCompletion> completion {}; // heap-pinned like `outbound`, and only pushed by the one task in flight
+            std::future<void> in_flight {}; // valid from a task's launch until the reactor reaps its completion, though a task that handed its completer on may report after this thread ends
+            std::size_t pfd_idx = 0; // position in `m_pfds`
+            std::uint32_t generation = 0;
+            bool is_open = false;
+        };
+
         static constexpr auto fallback_timeout = 15;
         static constexpr auto poll_error_n = -1;
 
-        std::vector<pollfd> m_pfds; // pollable BSD socket handles
+        std::vector<pollfd> m_pfds; // pollable BSD socket handles: the listener, the optional wake fd, then clients in no particular order
+        std::vector<Connection> m_conns; // indexed by client fd
+        CompletionQueue<TaskCompletion> m_completions; // pushed by tasks as they finish, drained by the reactor every sweep
+        WakeSignal m_completion_signal; // cuts a poll short once a task finishes, polled after the optional wake fd
+        std::size_t m_outbound_high_water_n;
+        std::shared_ptr<WakeSignal> m_wake_signal; // optional, polled right after the listener
+        bool m_shedding_reads; // whether the last sweep saw `MemoryBudget` exhausted
+        bool m_draining; // whether `begin_drain` closed the listener
+
+        /// NOTE: Re-arms a client for writability while output is queued and sendable, and for reads only while its queue stays below the high-water mark and the process-wide `MemoryBudget` has room.
+        [[nodiscard]] static auto deduce_client_events(const OutboundQueue& outbound) -> short;
+
+        [[nodiscard]] auto is_wake_fd(int fd) const noexcept -> bool;
+
+        [[nodiscard]] auto is_completion_fd(int fd) const noexcept -> bool;
+
+        [[nodiscard]] auto is_client_fd(int fd) const noexcept -> bool;
+
+        /// NOTE: Gives the fd of a `pollfd`, even while it is parked for an in-flight task. `poll` skips negative fds, so parking a client as its complement keeps a hangup from waking the loop until its task is done.
+        [[nodiscard]] static auto unparked_fd(const pollfd& pfd) noexcept -> int;
+
+        /// NOTE: Gives the connection named by `id`, or null if it has closed since, even if its fd now belongs to another client.
+        [[nodiscard]] auto find_connection(ConnectionId id) noexcept -> Connection*;
+
+        /// NOTE: Fills the slot of a newly accepted `fd` and appends its `pollfd`. Only a new highest fd or a first use of a slot allocates.
+        void open_connection(int fd);
+
+        /// NOTE: Closes `fd` and moves the last `pollfd` into its place, so removal never shifts the others.
+        void close_connection(int fd) noexcept;
+
+        /// NOTE: The `TaskCompleter` sink of every task: pushes its result to the owner's `m_completions` and signals the reactor. `completion_vp` is the connection's `TaskCompletion`.
+        static void report_completion(void* completion_vp, IOTaskResult result) noexcept;
+
+        /// NOTE: Parks the client and runs `task` off the reactor, passing it the completer for its result. A throwing task counts as failed, as its unreported completer reports so when dropped.
+        template <typename Task>
+        void launch_task(Connection& conn, ConnectionId conn_id, Task&& task) {
+            m_pfds[conn.pfd_idx].fd = ~conn_id.fd;
+
+            conn.in_flight = std::async(std::launch::async, [done = TaskCompleter {report_completion, conn.completion.get(), conn_id}, task = std::forward<Task>(task)]() mutable noexcept {
+                try {
+                    task(std::move(done));
+                } catch (...) {}
+            });
+        }
+
+        /// NOTE: While draining, closes every client that is neither in flight nor sending. The others stop reading and close once their queued output is sent. Walks backwards, as closing moves the last `pollfd` into the vacant spot.
+        template <SessionPool Sessions>
+        void close_drained_clients(Sessions& sessions) noexcept {
+            for (auto pfd_idx = m_pfds.size(); pfd_idx-- > 0;) {
+                const auto client_fd = m_pfds[pfd_idx].fd;
+
+                if (!is_client_fd(client_fd)) {
+                    continue;
+                }
+
+                if (auto& outbound = *m_conns[client_fd].outbound; outbound.has_pending()) {
+                    outbound.close_on_drain();
+                    m_pfds[pfd_idx].events = deduce_client_events(outbound);
+                } else {
+                    sessions.checkin(client_fd);
+                    close_connection(client_fd);
+                }
+            }
+        }
+
+        /// NOTE: Re-arms or closes each client whose task has finished, one by one, while the others keep running.
+        template <SessionPool Sessions>
+        void reap_completions(Sessions& sessions) noexcept {
+            for (auto completion_p = m_completions.take_all(); completion_p;) {
+                // 1. Read the link first, as the slot may launch a new task with this node soon after.
+                const auto [task_conn_id, task_ok] = completion_p->result;
+                completion_p = completion_p->next;
+
+                // 2. A client is never closed while its task is in flight, so the completion's generation must still match its slot. One that does not names a connection closed behind its task's back, and is dropped rather than re-arming whoever owns the fd now. The task's thread is done or about to end once it reported, so this barely waits.
+                const auto conn_p = find_connection(task_conn_id);
+
+                if (!conn_p) {
+                    continue;
+                }
+
+                auto& conn = *conn_p;
+
+                conn.in_flight.get();
+                m_pfds[conn.pfd_idx].fd = task_conn_id.fd;
+
+                if (const auto& outbound = *conn.outbound; !task_ok || (outbound.is_closing() && !outbound.has_pending())) {
+                    sessions.checkin(task_conn_id.fd);
+                    close_connection(task_conn_id.fd);
+                } else {
+                    m_pfds[conn.pfd_idx].events = deduce_client_events(outbound);
+                }
+            }
+        }
 
     public:
-        /// NOTE: `pollable_fd` will be appended 1st to the fd pool.
-        explicit Handles(pollfd pollable_fd);
+        static constexpr std::size_t default_outbound_high_water_n = 65536;
+
+        /// NOTE: `pollable_fd` will be appended 1st to the fd pool. A `wake_signal` wakes clients whose queued streams wait on off-loop work, see `FlushStatus::stalled`.
+        explicit Handles(pollfd pollable_fd, std::size_t outbound_high_water_n = default_outbound_high_water_n, std::shared_ptr<WakeSignal> wake_signal = {});
         ~Handles();
 
         Handles(const Handles&) = delete;
@@ -38,64 +197,81 @@ namespace DerkHttpd::Net {
         Handles(Handles&&) = delete;
         Handles& operator=(Handles&&) = delete;
 
-        template <typename Fn, typename Routing, std::same_as<PollEvent> FirstEv, std::same_as<PollEvent> ... Evs> requires (std::is_invocable_r_v<IOTaskResult, Fn, int, int, const Routing&>)
-        [[nodiscard]] auto dispatch_active_fds(Fn& callable, const Routing& routes, FirstEv first_event_tag, Evs ... event_tags) noexcept -> std::expected<int, std::string> {
+        /// NOTE: Closes the listener, so no client is accepted past this call. Later sweeps still finish in-flight exchanges and send queued output, then close each client. Requests read from here on are answered with `Connection: close`. An idle keep-alive client is closed at the next sweep, unless that sweep finds its next request already readable.
+        void begin_drain() noexcept;
+
+        /// NOTE: Whether a drain has closed every client.
+        [[nodiscard]] auto is_drained() const noexcept -> bool;
+
+        /// NOTE: `callable` serves one client event and reports its result through the `TaskCompleter` it is given, possibly from another thread after it returns.
+        template <typename Fn, typename Routing, SessionPool Sessions, std::same_as<PollEvent> FirstEv, std::same_as<PollEvent> ... Evs> requires (std::is_invocable_v<Fn, ConnectionId, OutboundQueue&, typename Sessions::Session&, const Routing&, TaskCompleter>)
+        [[nodiscard]] auto dispatch_active_fds(Fn& callable, const Routing& routes, Sessions& sessions, FirstEv first_event_tag, Evs ... event_tags) noexcept -> std::expected<int, std::string> {
             const auto poll_n = poll(m_pfds.data(), m_pfds.size(), fallback_timeout);
 
             if (poll_n == poll_error_n) {
                 return std::unexpected {"Handles::dispatch_active_fds: failed to poll any fd."};
             }
 
-            std::vector<std::future<IOTaskResult>> task_statuses;
-            auto pfd_n = static_cast<int>(m_pfds.size());
+            const auto pfd_n = m_pfds.size();
+            auto woke_up = false;
 
-            for (int fd_index = 0; fd_index < pfd_n; ++fd_index) {
-                const auto& pfd = m_pfds[fd_index];
+            for (std::size_t pfd_idx = 0; pfd_idx < pfd_n; ++pfd_idx) {
+                const auto pfd = m_pfds[pfd_idx];
 
                 if ( (pfd.revents & (static_cast<short>(first_event_tag) | ... | static_cast<short>(event_tags)) ) == 0) {
                     continue;
                 }
 
-                // 1. Handle listener event
-                if (fd_index == 0) {
+                // 1. Handle listener event. New clients are appended past `pfd_n`, so this sweep skips them.
+                if (pfd_idx == 0) {
                     if (auto incoming_fd = accept(pfd.fd, nullptr, nullptr); incoming_fd != -1) {
-                        m_pfds.emplace_back(pollfd {
-                            .fd = incoming_fd,
-                            .events = POLLIN,
-                            .revents = 0,
-                        });
-                        ++pfd_n;
+                        open_connection(incoming_fd);
+                        sessions.checkout(incoming_fd);
                     }
+                } else if (is_wake_fd(pfd.fd)) {
+                    // 2a. Stalled streams may have their input now, so re-arm every idle client after this sweep's completions.
+                    m_wake_signal->drain();
+                    woke_up = true;
+                } else if (is_completion_fd(pfd.fd)) {
+                    // 2b. Draining before the reap below means a task finishing after it still wakes the next poll.
+                    m_completion_signal.drain();
+                } else if (auto& conn = m_conns[pfd.fd]; (pfd.revents & POLLOUT) != 0) {
+                    // 3a. Resume a parked response once the client's socket drains. Reading waits until then, so the exchange order stays intact.
+                    launch_task(conn, ConnectionId {pfd.fd, conn.generation}, [&outbound = *conn.outbound, conn_id = ConnectionId {pfd.fd, conn.generation}](TaskCompleter done) {
+                        done({
+                            .conn = conn_id,
+                            .ok = outbound.flush(conn_id.fd) != FlushStatus::failed,
+                        });
+                    });
                 } else {
-                    // 2. Handle client socket event
-                    task_statuses.emplace_back(std::async(std::launch::async, callable, fd_index, pfd.fd, routes));
-                }
-            }
-
-            std::set<int> evicting_fds;
+                    // 3b. Handle client socket event. The session is looked up here, as accepts in this same sweep may resize the pool's table. While draining, the exchange is this client's last, so its response says `Connection: close`.
+                    if (m_draining) {
+                        conn.outbound->close_on_drain();
+                    }
 
-            for (auto& io_promise : task_statuses) {
-                if (auto [io_task_fd_idx, io_task_status] = io_promise.get(); io_task_status) {
-                    ; // The task here finished well, so just keep awaiting for any error or until the end.
-                } else {
-                    evicting_fds.emplace(m_pfds.at(io_task_fd_idx).fd);
+                    launch_task(conn, ConnectionId {pfd.fd, conn.generation}, [callable, conn_id = ConnectionId {pfd.fd, conn.generation}, &outbound = *conn.outbound, &session = sessions.session_of(pfd.fd), &routes](TaskCompleter done) mutable {
+                        std::invoke(callable, conn_id, outbound, session, routes, std::move(done));
+                    });
                 }
             }
 
-            auto evict_count = 0;
+            // 4. Re-arm or close only the clients whose tasks are done. Slower tasks stay in flight across sweeps, so they never hold up accepting or serving anyone else.
+            reap_completions(sessions);
 
-            std::ranges::partition(m_pfds, [&](const pollfd& item) -> bool {
-                if (evicting_fds.contains(item.fd)) {
-                    ++evict_count;
-                    return false;
-                }
+            // 5. Reads pause for every client while memory is exhausted, and resume for all of them once queued output has drained enough. Parked clients are skipped, as their completions re-arm them.
+            const auto shedding_reads = MemoryBudget::instance().is_exhausted();
 
-                return true;
-            });
+            if (woke_up || shedding_reads != std::exchange(m_shedding_reads, shedding_reads)) {
+                for (auto& client_pfd : m_pfds) {
+                    if (is_client_fd(client_pfd.fd)) {
+                        client_pfd.events = deduce_client_events(*m_conns[client_pfd.fd].outbound);
+                    }
+                }
+            }
 
-            for (; evict_count > 0; --evict_count) {
-                close(m_pfds.back().fd);
-                m_pfds.pop_back();
+            // 6. Clients served this sweep are parked already, so a drain only closes those without a request in progress.
+            if (m_draining) {
+                close_drained_clients(sessions);
             }
 
             return {poll_n};
@@ -1,6 +1,9 @@
 #ifndef DERK_HTTPD_MYNET_IO_FUNCS_HPP
 #define DERK_HTTPD_MYNET_IO_FUNCS_HPP
 
+#include <sys/types.h>
+#include <sys/uio.h>
+
 #include <expected>
 #include <array>
 #include <string>
@@ -16,7 +19,11 @@ namespace DerkHttpd::Net {
 
     [[nodiscard]] auto socket_read_line(int fd, ByteBuffer<>& dest) -> IOResult<ssize_t>;
 
-    [[nodiscard]] auto socket_write_n(int fd, ssize_t n, const ByteBuffer<>& src) noexcept -> IOResult<ssize_t>;
+    /// NOTE: Gathers up to `iov_n` buffers into one `writev` call on a non-blocking socket, so a response head and its in-memory body leave in a single system call. It may write only part of them, and a result of `0` means the socket would block.
+    [[nodiscard]] auto socket_writev_some(int fd, const iovec* iov, int iov_n) noexcept -> IOResult<ssize_t>;
+
+    /// NOTE: Sends up to `n` bytes of `file_fd` from `offset` onwards by `sendfile`, leaving the file's own position untouched. Same partial-progress rules as `socket_writev_some`.
+    [[nodiscard]] auto socket_send_file_some(int fd, int file_fd, off_t offset, std::size_t n) noexcept -> IOResult<ssize_t>;
 }
 
 #endif
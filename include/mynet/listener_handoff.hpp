@@ -0,0 +1,21 @@
+#ifndef DERK_HTTPD_MYNET_LISTENER_HANDOFF_HPP
+#define DERK_HTTPD_MYNET_LISTENER_HANDOFF_HPP
+
+#include <sys/types.h>
+
+#include <expected>
+#include <optional>
+#include <string>
+
+namespace DerkHttpd::Net {
+    /// NOTE: The environment variable that carries the listening socket's fd number into an upgraded server process.
+    constexpr const char* inherited_listener_env = "DERKHTTPD_LISTENER_FD";
+
+    /// NOTE: Gives the listener that an upgrading parent passed down, or nothing on a cold start or when the fd is not a listening socket. Clears the variable, so later processes only see what they are given.
+    [[nodiscard]] auto take_inherited_listener() noexcept -> std::optional<int>;
+
+    /// NOTE: Re-executes `argv[0]`, so a new binary installed at that path is started, with only the standard streams and `listener_fd` kept open. Gives the child's pid once its exec has succeeded, so the caller only starts draining when the new server is really running.
+    [[nodiscard]] auto spawn_upgraded_server(int listener_fd, char* const argv[]) -> std::expected<pid_t, std::string>;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef DERK_HTTPD_MYNET_MEMORY_BUDGET_HPP
+#define DERK_HTTPD_MYNET_MEMORY_BUDGET_HPP
+
+#include <atomic>
+#include <cstddef>
+
+namespace DerkHttpd::Net {
+    /**
+     * @brief Process-wide count of the bytes held on behalf of clients: request bodies, buffered output, pooled connection state and cached files. Optional holdings like a new request body or cache entry must reserve room first, and are refused once the limit is reached. Bytes that are already held, e.g a produced response chunk, are charged anyway, and the reactor stops reading requests until the count drops below the limit again.
+     */
+    class MemoryBudget {
+    private:
+        std::atomic<std::size_t> m_used_n;
+        std::atomic<std::size_t> m_limit_n;
+
+        MemoryBudget() noexcept;
+
+    public:
+        static constexpr std::size_t default_limit_n = 256 * 1024 * 1024;
+
+        [[nodiscard]] static auto instance() noexcept -> MemoryBudget&;
+
+        MemoryBudget(const MemoryBudget&) = delete;
+        MemoryBudget& operator=(const MemoryBudget&) = delete;
+        MemoryBudget(MemoryBudget&&) = delete;
+        MemoryBudget& operator=(MemoryBudget&&) = delete;
+
+        /// NOTE: Lowering the limit below what is held already only refuses new reservations until enough is released.
+        void set_limit(std::size_t limit_n) noexcept;
+
+        /// NOTE: Takes `n` bytes only if at least `headroom_n` bytes stay free afterwards, so a discretionary holder like a cache cannot starve requests.
+        [[nodiscard]] auto try_reserve(std::size_t n, std::size_t headroom_n = 0) noexcept -> bool;
+
+        /// NOTE: Counts bytes that are held already, even past the limit.
+        void charge(std::size_t n) noexcept;
+
+        void release(std::size_t n) noexcept;
+
+        [[nodiscard]] auto is_exhausted() const noexcept -> bool;
+
+        [[nodiscard]] auto get_used() const noexcept -> std::size_t;
+
+        [[nodiscard]] auto get_limit() const noexcept -> std::size_t;
+    };
+
+    /// NOTE: Owns a reservation from `MemoryBudget` and releases it on destruction or `reset()`.
+    class MemoryLease {
+    private:
+        MemoryBudget* m_budget;
+        std::size_t m_n;
+
+    public:
+        MemoryLease() noexcept;
+        MemoryLease(MemoryBudget& budget, std::size_t n) noexcept;
+        ~MemoryLease();
+
+        MemoryLease(const MemoryLease&) = delete;
+        MemoryLease& operator=(const MemoryLease&) = delete;
+        MemoryLease(MemoryLease&& other) noexcept;
+        MemoryLease& operator=(MemoryLease&& other) noexcept;
+
+        /// NOTE: Reserves `n` more bytes from `budget`, which must be the one this lease already holds bytes of, if any.
+        [[nodiscard]] auto try_grow(MemoryBudget& budget, std::size_t n) noexcept -> bool;
+
+        void reset() noexcept;
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t;
+    };
+}
+
+#endif
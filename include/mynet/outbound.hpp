@@ -0,0 +1,115 @@
+#ifndef DERK_HTTPD_MYNET_OUTBOUND_HPP
+#define DERK_HTTPD_MYNET_OUTBOUND_HPP
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <variant>
+#include <vector>
+
+#include "mynet/io_funcs.hpp"
+
+namespace DerkHttpd::Net {
+    using OutBytes = std::vector<char>;
+
+    /// NOTE: Generates the next piece of a streamed payload on demand, e.g a framed HTTP chunk. An empty result means the stream has ended.
+    using OutProducer = std::function<IOResult<OutBytes>()>;
+
+    /// NOTE: Tells a flush whether a producer can give its next piece without blocking, e.g once its file read has completed.
+    using OutReadyProbe = std::function<bool()>;
+
+    struct OutStream {
+        OutProducer producer;
+        OutReadyProbe ready_probe; // always ready when empty
+    };
+
+    /// NOTE: An owned, open file descriptor and the span of it that is still unsent.
+    struct OutFileSpan {
+        int file_fd;
+        off_t offset;
+        std::size_t length;
+    };
+
+    /// NOTE: A span of bytes with static storage duration, e.g an embedded asset. The queue never owns or copies them.
+    struct OutStaticSpan {
+        const char* data;
+        std::size_t length;
+    };
+
+    /// NOTE: A span of bytes kept alive by a refcounted `owner`, e.g a cached file shared by many connections. The queue holds a reference instead of a copy until the span is sent.
+    struct OutSharedSpan {
+        std::shared_ptr<const void> owner;
+        const char* data;
+        std::size_t length;
+    };
+
+    enum class FlushStatus : uint8_t {
+        drained, // everything queued reached the kernel
+        pending, // the socket's send buffer is full, so wait for `POLLOUT`
+        stalled, // the front producer's input is not ready, so wait for its completion signal
+        failed, // the connection is unusable
+    };
+
+    /**
+     * @brief Per-connection queue of unsent response data. Flushes never block: whatever the kernel does not take stays parked here, including a streamed payload's producer (and thus its chunk iterator position), until the socket is writable again or the producer's input is ready.
+     */
+    class OutboundQueue {
+    private:
+        using Segment = std::variant<OutBytes, OutStaticSpan, OutSharedSpan, OutFileSpan, OutStream>;
+
+        std::deque<Segment> m_segments;
+        std::size_t m_front_sent_n; // sent bytes of the front in-memory (`OutBytes`, `OutStaticSpan` or `OutSharedSpan`) segment
+        std::size_t m_buffered_n; // unsent bytes held in memory across `OutBytes` segments, also charged to `MemoryBudget`
+        std::size_t m_high_water_n;
+        bool m_close_on_drain;
+
+        static void release(Segment& segment) noexcept;
+
+        /// NOTE: Sends the in-memory segments at the front of the queue by one `writev`, giving how many bytes went out.
+        [[nodiscard]] auto flush_gathered(int fd) -> IOResult<ssize_t>;
+
+    public:
+        explicit OutboundQueue(std::size_t high_water_n) noexcept;
+        ~OutboundQueue();
+
+        OutboundQueue(const OutboundQueue&) = delete;
+        OutboundQueue& operator=(const OutboundQueue&) = delete;
+        OutboundQueue(OutboundQueue&&) = delete;
+        OutboundQueue& operator=(OutboundQueue&&) = delete;
+
+        void push_bytes(OutBytes bytes);
+
+        /// NOTE: `data` must outlive the queue, as only the pointer is kept.
+        void push_static(const char* data, std::size_t length);
+
+        /// NOTE: Shares ownership of `data` through `owner` until it is sent. Its bytes are not counted towards the high-water mark, as other connections may hold the same ones.
+        void push_shared(std::shared_ptr<const void> owner, const char* data, std::size_t length);
+
+        /// NOTE: Takes ownership of `file_fd`, closing it once its span is sent or the queue is destroyed.
+        void push_file(int file_fd, off_t offset, std::size_t length);
+
+        void push_producer(OutProducer producer, OutReadyProbe ready_probe = {});
+
+        [[nodiscard]] auto flush(int fd) -> FlushStatus;
+
+        [[nodiscard]] auto has_pending() const noexcept -> bool;
+
+        /// NOTE: Checks if the front segment is a producer still waiting on its input, in which case `POLLOUT` is pointless.
+        [[nodiscard]] auto awaits_input() const -> bool;
+
+        /// NOTE: The reactor stops reading requests from a client above this mark, so a slow reader cannot make the server buffer unbounded responses.
+        [[nodiscard]] auto above_high_water() const noexcept -> bool;
+
+        void close_on_drain() noexcept;
+
+        [[nodiscard]] auto is_closing() const noexcept -> bool;
+
+        /// NOTE: Drops everything queued, closing any owned file fds, so the queue can serve the next client on a reused fd.
+        void reset() noexcept;
+    };
+}
+
+#endif
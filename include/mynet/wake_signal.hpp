@@ -0,0 +1,34 @@
+#ifndef DERK_HTTPD_MYNET_WAKE_SIGNAL_HPP
+#define DERK_HTTPD_MYNET_WAKE_SIGNAL_HPP
+
+namespace DerkHttpd::Net {
+    /**
+     * @brief A pollable fd that other threads can make readable, so the reactor wakes up for work finished off the event loop, e.g a completed file read. Uses an `eventfd` on Linux and a self-pipe elsewhere.
+     */
+    class WakeSignal {
+    private:
+        int m_read_fd;
+        int m_write_fd;
+
+    public:
+        WakeSignal() noexcept;
+        ~WakeSignal();
+
+        WakeSignal(const WakeSignal&) = delete;
+        WakeSignal& operator=(const WakeSignal&) = delete;
+        WakeSignal(WakeSignal&&) = delete;
+        WakeSignal& operator=(WakeSignal&&) = delete;
+
+        [[nodiscard]] auto is_valid() const noexcept -> bool;
+
+        /// NOTE: The fd to poll for `POLLIN`.
+        [[nodiscard]] auto get_fd() const noexcept -> int;
+
+        /// NOTE: Safe to call from any thread. Repeated notifications before a `drain()` coalesce into one wake-up.
+        void notify() noexcept;
+
+        void drain() noexcept;
+    };
+}
+
+#endif
@@ -2,17 +2,27 @@
 #define DERKHTTPD_MYURI_PARSE_HPP
 
 #include <cstdint>
+#include <memory_resource>
 #include <string_view>
-#include <string>
 #include <expected>
+#include <variant>
 
 #include "myuri/uri.hpp"
 
 namespace DerkHttpd::Uri {
+    enum class UriError : uint8_t {
+        unknown_token,
+        bad_escape, // `'%'` not followed by two hex digits
+        bad_query_item, // not `name=value`
+        bad_int, // integer value out of `int` range
+        too_many_params, // more than `max_query_params` query items
+        too_long,
+    };
+
     enum class TokenTag : uint8_t {
         unknown,
         path, // alphanumeric string with slashes e.g `/foo/bar`
-        wordy, // `(ALPHA | DIGIT | SPECIALS)+` where `SPECIALS = '/' | ':'`
+        wordy, // `(ALPHA | DIGIT | UNRESERVED)+` where `UNRESERVED = '-' | '.' | '_' | '~'`
         query_mark, // `'?'`
         query_assign, // `'='`
         query_delim, // `'&'`
@@ -34,7 +44,7 @@ namespace DerkHttpd::Uri {
         : Token (begin_, length_, tag_, '\0') {}
 
         constexpr Token(int begin_, char unescaped_) noexcept
-        : Token (begin_, 1, TokenTag::item_encoded_char, unescaped_) {}
+        : Token (begin_, 3, TokenTag::item_encoded_char, unescaped_) {}
 
         template <std::same_as<TokenTag> FirstTag, typename ... MoreTags>
         [[nodiscard]] constexpr auto match_tag_to(this auto&& self, FirstTag first, MoreTags ... more) noexcept -> bool {
@@ -63,8 +73,21 @@ namespace DerkHttpd::Uri {
             return (c >= '0' && c <= '9');
         }
 
-        [[nodiscard]] static constexpr auto match_hex(char c) noexcept -> bool {
-            return (c >= 'A' && c <= 'F') || (c >= '0' && c <= '9');
+        [[nodiscard]] static constexpr auto match_unreserved(char c) noexcept -> bool {
+            return c == '-' || c == '.' || c == '~';
+        }
+
+        /// NOTE: Gives the value of a hex digit of either case, or -1 for a non-hex char.
+        [[nodiscard]] static constexpr auto hex_value(char c) noexcept -> int {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            } else if (c >= 'A' && c <= 'F') {
+                return c - 'A' + 10;
+            } else if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+
+            return -1;
         }
 
         [[nodiscard]] auto at_eos() const noexcept -> bool;
@@ -79,49 +102,51 @@ namespace DerkHttpd::Uri {
         [[nodiscard]] auto operator()(std::string_view src_sv) noexcept -> Token;
     };
 
+    /**
+     * @brief Recursive descent parser of relative URIs. The result copies the source once, and every path and query item is stored as an offset into that copy. Escaped chars are decoded by shifting the following text down within the copy, so URIs without escapes are never rewritten. Errors are returned as `UriError` codes instead of thrown.
+     */
     class Parser {
     private:
-        Uri m_result;
-        Token m_current;
-
-        /// For unknown token errors.
-        void report_error(const Token& culprit);
+        using SlotValue = std::variant<TextSpan, int>;
 
-        /// For more-elaborate parse errors.
-        void report_error(const Token& culprit, const std::string& msg);
+        Token m_current;
+        std::uint32_t m_write_pos; // end of the decoded text in the result's buffer
 
         [[nodiscard]] auto advance(std::string_view uri_src, Lexer& lexer) noexcept -> Token;
 
         void consume_any(std::string_view uri_src, Lexer& lexer) noexcept;
 
         template <TokenTag First, TokenTag ... More>
-        [[nodiscard]] constexpr auto consume_of(std::string_view uri_src, Lexer& lexer) {
-            if (m_current.match_tag_to(First, More...)) {
-                m_current = advance(uri_src, lexer);
-            } else {
-                report_error(m_current);
+        [[nodiscard]] constexpr auto consume_of(std::string_view uri_src, Lexer& lexer, UriError mismatch_err) noexcept -> std::expected<void, UriError> {
+            if (!m_current.match_tag_to(First, More...)) {
+                return std::unexpected {mismatch_err};
             }
+
+            m_current = advance(uri_src, lexer);
+
+            return {};
         }
 
         [[nodiscard]] auto at_eos() const noexcept -> bool;
 
-        void clear_result();
+        /// NOTE: Copies the current token's decoded text to the write position, which only moves bytes after an earlier escape shrank the text.
+        void emit_current(std::string_view uri_src, Uri& result) noexcept;
 
-        /// NOTE: This helper method throws, but the exception will be caught by the parent `operator()(...)`. Thus, an `std::expected` is not needed here.
-        [[nodiscard]] auto parse_relative_uri(std::string_view uri_src, Lexer& lexer) -> Uri;
+        /// NOTE: Emits a run of textual, integer and escaped tokens as one decoded span.
+        [[nodiscard]] auto parse_text_run(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> TextSpan;
 
-        [[nodiscard]] auto parse_path(std::string_view uri_src, Lexer& lexer) -> std::string;
-        [[nodiscard]] auto parse_query(std::string_view uri_src, Lexer& lexer) -> std::map<std::string, QueryValue>;
-        [[nodiscard]] auto parse_query_item(std::string_view uri_src, Lexer& lexer) -> QueryPair;
-        [[nodiscard]] auto parse_query_value(std::string_view uri_src, Lexer& lexer) -> QueryValue;
+        [[nodiscard]] auto parse_relative_uri(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> std::expected<void, UriError>;
+        [[nodiscard]] auto parse_query(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> std::expected<void, UriError>;
+        [[nodiscard]] auto parse_query_item(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> std::expected<QuerySlot, UriError>;
+        [[nodiscard]] auto parse_query_value(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> std::expected<SlotValue, UriError>;
 
     public:
-        Parser();
+        Parser() noexcept;
 
-        [[nodiscard]] auto operator()(std::string_view uri_src, Lexer& lexer) -> std::expected<Uri, std::string>;
+        [[nodiscard]] auto operator()(std::string_view uri_src, Lexer& lexer, std::pmr::memory_resource* resource) -> std::expected<Uri, UriError>;
     };
 
-    [[nodiscard]] auto parse_simple_uri(std::string_view uri) -> std::expected<Uri, std::string>;
+    [[nodiscard]] auto parse_simple_uri(std::string_view uri, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) -> std::expected<Uri, UriError>;
 }
 
 #endif
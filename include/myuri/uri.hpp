@@ -1,57 +1,111 @@
 #ifndef DERKHTTPD_MYURI_URI_HPP
 #define DERKHTTPD_MYURI_URI_HPP
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
 #include <optional>
+#include <span>
 #include <string>
-#include <map>
+#include <string_view>
 #include <variant>
 
 namespace DerkHttpd::Uri {
-    using QueryValue = std::variant<std::string, int>;
+    constexpr std::size_t max_query_params = 16;
+
+    /// NOTE: Text values view the owning `Uri`'s buffer, so they must not outlive it.
+    using QueryValue = std::variant<std::string_view, int>;
 
     struct QueryPair {
-        std::string name;
+        std::string_view name;
         QueryValue value;
     };
 
-    class Uri {
+    /// NOTE: Locates decoded text inside a `Uri`'s buffer by offset, so copying or moving the `Uri` never leaves dangling views behind.
+    struct TextSpan {
+        std::uint32_t begin;
+        std::uint32_t length;
+
+        [[nodiscard]] constexpr auto view_of(std::string_view text) const noexcept -> std::string_view {
+            return text.substr(begin, length);
+        }
+    };
+
+    struct QuerySlot {
+        TextSpan name;
+        std::variant<TextSpan, int> value;
+    };
+
+    /// NOTE: Non-owning view of a `Uri`'s query items in their request order. Lookups scan linearly, which beats hashing or tree walks for the few items a query usually has.
+    class QueryParams {
     private:
-        std::string m_path;
-        std::map<std::string, QueryValue> m_query;
+        std::string_view m_text;
+        std::span<const QuerySlot> m_slots;
 
     public:
-        Uri();
+        constexpr QueryParams() noexcept
+        : m_text {}, m_slots {} {}
 
-        Uri(std::string rel_path, std::map<std::string, QueryValue> query_items) noexcept;
+        constexpr QueryParams(std::string_view text, std::span<const QuerySlot> slots) noexcept
+        : m_text {text}, m_slots {slots} {}
 
-        [[nodiscard]] auto path() const noexcept -> const std::string&;
+        [[nodiscard]] constexpr auto size() const noexcept -> std::size_t {
+            return m_slots.size();
+        }
 
-        [[nodiscard]] auto param(const std::string& name) const noexcept -> std::optional<const QueryValue*>;
+        [[nodiscard]] constexpr auto empty() const noexcept -> bool {
+            return m_slots.empty();
+        }
 
-        [[nodiscard]] auto params() const noexcept -> const std::map<std::string, QueryValue>&;
+        [[nodiscard]] constexpr auto operator[](std::size_t index) const noexcept -> QueryPair {
+            const auto& [slot_name, slot_value] = m_slots[index];
 
-        friend constexpr auto operator==(const Uri& lhs, const Uri& rhs) noexcept -> bool {
-            if (lhs.m_path != rhs.m_path) {
-                return false;
+            if (const auto text_span_p = std::get_if<TextSpan>(&slot_value); text_span_p) {
+                return {.name = slot_name.view_of(m_text), .value = text_span_p->view_of(m_text)};
             }
 
-            if (lhs.m_query.size() != rhs.m_query.size()) {
-                return false;
-            }
+            return {.name = slot_name.view_of(m_text), .value = std::get<int>(slot_value)};
+        }
 
-            for (const auto& [q_key, q_value] : lhs.m_query) {
-                if (rhs.m_query.contains(q_key)) {
-                    if (rhs.m_query.at(q_key) == q_value) {
-                        continue;
-                    }
+        /// NOTE: Gives the first item named `name`, as repeated names keep their first value.
+        [[nodiscard]] constexpr auto get(std::string_view name) const noexcept -> std::optional<QueryValue> {
+            for (std::size_t slot_idx = 0; slot_idx < size(); ++slot_idx) {
+                if (auto [item_name, item_value] = (*this)[slot_idx]; item_name == name) {
+                    return item_value;
                 }
-
-                return false;
             }
 
-            return true;
+            return {};
         }
     };
+
+    class Parser;
+
+    class Uri {
+    private:
+        friend class Parser;
+
+        std::pmr::string m_text; // copy of the source URI, percent-decoded in place when it has escapes
+        TextSpan m_path;
+        std::array<QuerySlot, max_query_params> m_query;
+        std::size_t m_query_n;
+
+    public:
+        Uri();
+
+        /// NOTE: Only copies the source text into `resource`, leaving the path and query empty until `Parser` fills them.
+        explicit Uri(std::string_view source_text, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        [[nodiscard]] auto path() const noexcept -> std::string_view;
+
+        [[nodiscard]] auto param(std::string_view name) const noexcept -> std::optional<QueryValue>;
+
+        [[nodiscard]] auto params() const noexcept -> QueryParams;
+
+        /// NOTE: Query items compare as a set by name, like the old map-based query did.
+        friend auto operator==(const Uri& lhs, const Uri& rhs) noexcept -> bool;
+    };
 }
 
 #endif
@@ -8,29 +8,106 @@
 
 #include "mynet/make_srvsock.hpp"
 #include "mynet/handles.hpp"
+#include "mynet/listener_handoff.hpp"
+#include "mynet/memory_budget.hpp"
+#include "myapp/connection_pool.hpp"
+#include "myapp/embedded_assets.hpp"
+#include "myapp/file_io_pool.hpp"
+#include "myapp/handler_executor.hpp"
 #include "myapp/response_helpers.hpp"
 #include "myapp/msg_task.hpp"
 
 
 std::atomic_flag is_running = ATOMIC_FLAG_INIT;
+std::atomic_flag drain_requested = ATOMIC_FLAG_INIT;
+std::atomic_flag upgrade_requested = ATOMIC_FLAG_INIT;
 
 void handle_sigint([[maybe_unused]] int sig_id) {
     is_running.clear();
     is_running.notify_all();
 }
 
+/// NOTE: SIGTERM stops accepting, then lets in-flight and keep-alive exchanges finish before exiting, see `run_server`.
+void handle_sigterm([[maybe_unused]] int sig_id) {
+    drain_requested.test_and_set();
+}
+
+/// NOTE: SIGUSR2 starts the binary at `argv[0]` on this process's listener, then drains this process like SIGTERM.
+void handle_sigusr2([[maybe_unused]] int sig_id) {
+    upgrade_requested.test_and_set();
+}
+
 
 constexpr std::string_view server_hostname {"localhost"};
+constexpr std::string_view subdomain_hostname {"*.localhost"};
+constexpr std::size_t pooled_connection_n = 64;
+constexpr std::size_t server_memory_limit = 128 * 1024 * 1024;
+constexpr std::chrono::seconds drain_deadline_s {10};
+
+
+[[nodiscard]] auto serve_home(DerkHttpd::Http::Request& req, [[maybe_unused]] const DerkHttpd::Uri::QueryParams& query_params) -> DerkHttpd::Http::Response {
+    using namespace DerkHttpd;
+
+    Http::Response res = req.make_response();
+
+    if (auto file_opt = App::TextualFile::create("./www/index.html", "text/html", 512); file_opt) {
+        App::ResponseUtils::response_put_all(res, file_opt.value(), Http::Status::http_ok);
+
+        return res;
+    }
+
+    auto internal_err = App::EmptyReply {Http::Status::http_server_error};
+    App::ResponseUtils::response_put_all(res, internal_err);
+
+    return res;
+}
+
+[[nodiscard]] auto echo_home(DerkHttpd::Http::Request& req, [[maybe_unused]] const DerkHttpd::Uri::QueryParams& query_params) -> DerkHttpd::Http::Response {
+    using namespace DerkHttpd;
+
+    Http::Response res = req.make_response();
+    App::StringReply cat_msg {std::move(req.body), "text/plain"};
+    App::ResponseUtils::response_put_all(res, std::move(cat_msg), Http::Status::http_ok);
+
+    return res;
+}
+
+[[nodiscard]] auto serve_lorem(DerkHttpd::Http::Request& req, [[maybe_unused]] const DerkHttpd::Uri::QueryParams& query_params) -> DerkHttpd::Http::Response {
+    using namespace DerkHttpd;
+
+    Http::Response res = req.make_response();
+
+    if (auto lorem_copypasta = App::TextualFile::create("./www/lorem.txt", "text/plain", 512); lorem_copypasta) {
+        App::ResponseUtils::response_put_chunked(res, lorem_copypasta.value());
+        return res;
+    }
+
+    App::EmptyReply server_err {Http::Status::http_server_error};
+    App::ResponseUtils::response_put_all(res, server_err);
+
+    return res;
+}
 
 
-[[nodiscard]] auto run_server(std::string_view port_sv, int backlog, const DerkHttpd::App::Routes& app_router) -> bool {
+[[nodiscard]] auto run_server(std::string_view port_sv, int backlog, const DerkHttpd::App::VirtualHosts& app_hosts, DerkHttpd::App::HandlerExecutor& handler_executor, char* const argv[]) -> bool {
     using namespace DerkHttpd;
 
     constexpr auto recv_backoff_ms = 20;
 
     Net::CreateServerSocket listener_generator {port_sv, backlog, Net::PollEvent::hangup, Net::PollEvent::received};
 
+    // An upgraded process takes over its parent's listener, so connections queued during the restart are still accepted.
     auto listener_pollfd = ([&listener_generator]() -> pollfd {
+        if (const auto inherited_fd = Net::take_inherited_listener(); inherited_fd) {
+            std::println(std::cout, "Startup LOG: took over inherited listener fd {}.", *inherited_fd);
+
+            return {
+                .fd = *inherited_fd,
+                .events = static_cast<short>(static_cast<short>(Net::PollEvent::hangup) | static_cast<short>(Net::PollEvent::received)),
+                .revents = 0,
+            };
+        }
+
         while (true) {
             if (auto host_opt = listener_generator(); host_opt.has_value()) {
                 if (auto temp_pollfd = *host_opt; temp_pollfd.fd != -1) {
@@ -49,20 +126,64 @@ constexpr std::string_view server_hostname {"localhost"};
         return false;
     }
 
-    App::MsgExchangeTask<Net::IOTaskResult> io_worker_fn;
-    Net::Handles fd_pool {listener_pollfd};
+    // Offloaded file reads wake the event loop through this signal when they complete.
+    auto io_wake_signal = std::make_shared<Net::WakeSignal>();
+    App::FileIOPool::instance().set_completion_signal(io_wake_signal);
+
+    // Bursts past this limit get 503s and paused reads instead of an OOM kill. Set it before the pool, whose states count towards it.
+    Net::MemoryBudget::instance().set_limit(server_memory_limit);
+
+    // Per-connection parsers, buffers and arenas are made once here, then recycled as clients come and go.
+    App::ConnectionPool connection_pool {pooled_connection_n, Http::IntakeConfig {
+        .max_body_size = 1024,
+        .max_header_size = 480,
+        .max_header_block_size = 8192,
+    }};
+
+    // The poll loop's I/O tasks only read and parse requests. Handlers run on the work-stealing executor, whose jobs send the responses and report back to the loop.
+    App::MsgExchangeTask<Net::IOTaskResult> io_worker_fn {handler_executor};
+    Net::Handles fd_pool {listener_pollfd, Net::Handles::default_outbound_high_water_n, io_wake_signal};
+
+    std::optional<std::chrono::steady_clock::time_point> drain_deadline;
 
     while (is_running.test()) {
-        if (auto sweep_res = fd_pool.dispatch_active_fds(io_worker_fn, app_router, Net::PollEvent::hangup, Net::PollEvent::received); !sweep_res.has_value()) {
+        // 1. Start the new binary first and drain only once it runs, so a failed upgrade leaves this process serving.
+        if (upgrade_requested.test() && !drain_deadline) {
+            upgrade_requested.clear();
+
+            if (auto spawn_res = Net::spawn_upgraded_server(listener_pollfd.fd, argv); spawn_res.has_value()) {
+                std::println(std::cout, "Event Loop LOG: handed the listener to upgraded process {}.", spawn_res.value());
+                drain_requested.test_and_set();
+            } else {
+                std::println(std::cerr, "Event Loop ERR:\n{}", spawn_res.error());
+            }
+        }
+
+        // 2. A drain stops accepting at once, but lets open exchanges finish until the deadline.
+        if (drain_requested.test() && !drain_deadline) {
+            fd_pool.begin_drain();
+            drain_deadline = std::chrono::steady_clock::now() + drain_deadline_s;
+            std::println(std::cout, "Event Loop LOG: draining for up to {}.", drain_deadline_s);
+        }
+
+        if (auto sweep_res = fd_pool.dispatch_active_fds(io_worker_fn, app_hosts, connection_pool, Net::PollEvent::hangup, Net::PollEvent::received, Net::PollEvent::sendable); !sweep_res.has_value()) {
             std::println(std::cerr, "Event Loop ERR:\n{}", sweep_res.error());
             break;
         } else if (const auto event_count = sweep_res.value(); event_count == 0) {
             // Sleep for inactive I/O periods, saving CPU cycles for other processes.
             std::this_thread::sleep_for(std::chrono::milliseconds {recv_backoff_ms});
         }
+
+        // 3. Past the deadline, clients still open are cut off. In-flight tasks have their sockets shut down first, so one blocked on a slow client returns instead of stalling the exit.
+        if (drain_deadline && (fd_pool.is_drained() || std::chrono::steady_clock::now() >= *drain_deadline)) {
+            std::println(std::cout, "Event Loop LOG: drain {}.", fd_pool.is_drained() ? "finished" : "hit its deadline");
+            break;
+        }
     }
 
-    std::println(std::cout, "Event Loop LOG: Shutdown!");
+    const auto [worker_n, queued_n, run_n, steal_n] = handler_executor.get_stats();
+
+    std::println(std::cout, "Event Loop LOG: Shutdown! Handler executor ran {} jobs on {} workers with {} steals, {} left queued.", run_n, worker_n, steal_n, queued_n);
 
     return true;
 }
@@ -79,6 +200,10 @@ int main(int argc, char* argv[]) {
     is_running.test_and_set();
 
     signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigterm);
+    signal(SIGUSR2, handle_sigusr2);
+    // A write to a client that hung up, or to one cut off at shutdown, must fail with EPIPE rather than kill the server.
+    signal(SIGPIPE, SIG_IGN);
 
     std::string_view port_arg {argv[1]};
     auto checked_backlog = ([](char* argv[]) noexcept -> std::optional<int> {
@@ -97,75 +222,111 @@ int main(int argc, char* argv[]) {
     }
 
     const auto backlog_value = checked_backlog.value();
-    App::Routes my_routes {server_hostname, port_arg};
 
-    my_routes.set_handler("/", [](Http::Request req, [[maybe_unused]] const std::map<std::string, Uri::QueryValue>& query_params) {
-        Http::Response res;
+    // Declared before the hosts, so it outlives the `/stats` route that reads its counters.
+    App::HandlerExecutor handler_executor {App::HandlerExecutor::default_worker_n()};
+    App::VirtualHosts my_hosts;
+    auto site_routes_p = my_hosts.add_host(server_hostname);
+    auto subdomain_routes_p = my_hosts.add_host(subdomain_hostname);
 
-        if (const auto method = req.http_verb; method == Http::Verb::http_get) {
-            if (auto file_opt = App::TextualFile::create("./www/index.html", "text/html", 512); file_opt) {
-                App::ResponseUtils::response_put_all(res, file_opt.value(), Http::Status::http_ok);
-
-                return res;
-            }
-        } else if (method == Http::Verb::http_post) {
-            App::StringReply cat_msg {std::move(req.body), "text/plain"};
-            App::ResponseUtils::response_put_all(res, cat_msg, Http::Status::http_ok);
+    if (!site_routes_p || !subdomain_routes_p) {
+        std::println(std::cerr, "Setup ERR: invalid virtual host name!");
+        return 1;
+    }
 
-            return res;
-        } else {
-            auto invalid_method_err = App::EmptyReply{Http::Status::http_method_not_allowed};
-            App::ResponseUtils::response_put_all(res, invalid_method_err);
+    // Requests for other hosts, or HTTP/1.0 ones without a `Host`, get the main site.
+    my_hosts.set_default_host(server_hostname);
 
-            return res;
-        }
+    auto& my_routes = *site_routes_p;
 
-        auto internal_err = App::EmptyReply {Http::Status::http_server_error};
-        App::ResponseUtils::response_put_all(res, internal_err);
+    // Every response, even a 404 or 405, tells browsers not to guess its content type.
+    my_routes.add_filter([](Http::Request& req, App::FilterNext next) -> Http::Response {
+        auto res = next(req);
+        res.headers.insert_or_assign("X-Content-Type-Options", "nosniff");
 
         return res;
     });
 
-    my_routes.set_handler("/index.js", [](Http::Request req, [[maybe_unused]] const std::map<std::string, Uri::QueryValue>& query_params) {
-        Http::Response res;
+    // The fixed pages are dispatched by a build-time table, ahead of the dynamic handlers below.
+    my_routes.use_static_table<App::StaticRouteTable<
+        App::StaticRoute<"/", serve_home, Http::Verb::http_get>,
+        App::StaticRoute<"/", echo_home, Http::Verb::http_post>,
+        App::StaticRoute<"/lorem", serve_lorem, Http::Verb::http_get>
+    >>();
 
-        if (req.http_verb == Http::Verb::http_get) {
-            if (auto file_opt = App::TextualFile::create("./www/index.js", "text/javascript", 512); file_opt) {
-                App::ResponseUtils::response_put_all(res, file_opt.value(), Http::Status::http_ok);
+    // The clock text only changes once a second, so concurrent requests share one handler run via the route's microcache.
+    my_routes.set_handler("/now", [](Http::Request& req, [[maybe_unused]] const Uri::QueryParams& query_params) {
+        Http::Response res = req.make_response();
 
-                return res;
-            }
-        } else {
-            auto invalid_method_err = App::EmptyReply {Http::Status::http_method_not_allowed};
-            App::ResponseUtils::response_put_all(res, invalid_method_err);
-        }
+        App::StringReply clock_msg {App::get_date_string(), "text/plain"};
+        App::ResponseUtils::response_put_all(res, std::move(clock_msg), Http::Status::http_ok);
+
+        return res;
+    }, App::MicrocachePolicy {.ttl = std::chrono::seconds {1}});
 
-        auto internal_err = App::EmptyReply {Http::Status::http_server_error};
-        App::ResponseUtils::response_put_all(res, internal_err);
+    // Pattern routes capture path segments, e.g `/greet/derk` gives `name` = `derk`.
+    my_routes.set_handler(Http::Verb::http_get, "/greet/:name", [](Http::Request& req, [[maybe_unused]] const Uri::QueryParams& query_params, const App::RouteParams& route_params) {
+        Http::Response res = req.make_response();
+
+        std::string greeting {"Hello, "};
+        greeting.append(route_params.get("name").value_or("stranger"));
+        greeting.append("!\n");
+
+        App::StringReply greeting_msg {std::move(greeting), "text/plain"};
+        App::ResponseUtils::response_put_all(res, std::move(greeting_msg), Http::Status::http_ok);
 
         return res;
     });
 
-    my_routes.set_handler("/lorem", [](Http::Request req, [[maybe_unused]] const std::map<std::string, Uri::QueryValue>& query_params) {
-        Http::Response res;
+    // Live executor and memory counters, for tuning the split between I/O tasks and handler workers.
+    my_routes.set_handler(Http::Verb::http_get, "/stats", [&handler_executor](Http::Request& req, [[maybe_unused]] const Uri::QueryParams& query_params) {
+        Http::Response res = req.make_response();
 
-        if (req.http_verb == Http::Verb::http_get) {
-            if (auto lorem_copypasta = App::TextualFile::create("./www/lorem.txt", "text/plain", 512); lorem_copypasta) {
-                App::ResponseUtils::response_put_chunked(res, lorem_copypasta.value());
-                return res;
-            }
-        } else {
-            App::EmptyReply bad_verb_err {Http::Status::http_method_not_allowed};
-            App::ResponseUtils::response_put_all(res, bad_verb_err);
-        }
+        const auto [worker_n, queued_n, run_n, steal_n] = handler_executor.get_stats();
+        const auto& memory_budget = Net::MemoryBudget::instance();
+
+        App::StringReply stats_msg {std::format(
+            "handler_workers {}\nhandler_queued {}\nhandler_runs {}\nhandler_steals {}\nmemory_used {}\nmemory_limit {}\n",
+            worker_n, queued_n, run_n, steal_n, memory_budget.get_used(), memory_budget.get_limit()
+        ), "text/plain"};
+        App::ResponseUtils::response_put_all(res, std::move(stats_msg), Http::Status::http_ok);
+
+        return res;
+    });
+
+    // Assets packed by `DERKHTTPD_EMBED_ASSETS` are served from the binary, ahead of the mounted directory.
+    for (const auto& embedded_asset : App::embedded_asset_index()) {
+        my_routes.set_handler(Http::Verb::http_get, std::string {embedded_asset.path}, [asset_path = embedded_asset.path](Http::Request& req, [[maybe_unused]] const Uri::QueryParams& query_params) {
+            Http::Response res = req.make_response();
+
+            auto embedded_file = App::EmbeddedFile::create(asset_path, 512).value();
+            App::ResponseUtils::response_put_all(res, embedded_file, Http::Status::http_ok);
+
+            return res;
+        });
+    }
+
+    // Every other asset under ./www, e.g `/index.js`, is served as-is by the static mount.
+    if (!my_routes.mount_directory("/", "./www")) {
+        std::println(std::cerr, "Setup ERR: could not mount ./www as static assets!");
+        return 1;
+    }
+
+    // Any subdomain, e.g `api.localhost`, is a separate site with its own routes.
+    subdomain_routes_p->set_handler(Http::Verb::http_get, "/", [](Http::Request& req, [[maybe_unused]] const Uri::QueryParams& query_params) {
+        Http::Response res = req.make_response();
+
+        std::string greeting {"Hello from "};
+        greeting.append(req.headers.at("Host"));
+        greeting.append("!\n");
 
-        App::EmptyReply server_err {Http::Status::http_server_error};
-        App::ResponseUtils::response_put_all(res, server_err);
+        App::StringReply greeting_msg {std::move(greeting), "text/plain"};
+        App::ResponseUtils::response_put_all(res, std::move(greeting_msg), Http::Status::http_ok);
 
         return res;
     });
 
-    const auto serviced_ok = run_server(port_arg, backlog_value, my_routes);
+    const auto serviced_ok = run_server(port_arg, backlog_value, my_hosts, handler_executor, argv);
 
     return serviced_ok ? 0 : 1;
 }
@@ -0,0 +1,74 @@
+#include <utility>
+
+#include "mynet/memory_budget.hpp"
+#include "myapp/connection_pool.hpp"
+
+namespace DerkHttpd::App {
+    ConnectionState::ConnectionState(Http::IntakeConfig intake_config)
+    : arena_bytes {}, arena {arena_bytes.data(), arena_bytes.size()}, intake {intake_config}, outtake {} {
+        Net::MemoryBudget::instance().charge(sizeof(ConnectionState));
+    }
+
+    ConnectionState::~ConnectionState() {
+        Net::MemoryBudget::instance().release(sizeof(ConnectionState));
+    }
+
+    void ConnectionState::rewind_arena() noexcept {
+        arena.release();
+    }
+
+    void ConnectionState::reset() noexcept {
+        intake.release_body_budget();
+        rewind_arena();
+    }
+
+    ConnectionPool::ConnectionPool(std::size_t idle_n, Http::IntakeConfig intake_config)
+    : m_intake_config {intake_config}, m_idle {}, m_active {}, m_total_n {idle_n} {
+        m_idle.reserve(idle_n);
+
+        for (std::size_t state_idx = 0; state_idx < idle_n; ++state_idx) {
+            m_idle.emplace_back(std::make_unique<ConnectionState>(m_intake_config));
+        }
+
+        // Client fds usually sit a little above the pool's size, past the standard streams and the listener.
+        m_active.resize(idle_n * 2);
+    }
+
+    void ConnectionPool::checkout(int fd) {
+        const auto slot_idx = static_cast<std::size_t>(fd);
+
+        if (slot_idx >= m_active.size()) {
+            m_active.resize(slot_idx + 1);
+        }
+
+        if (m_active[slot_idx]) {
+            return;
+        }
+
+        if (m_idle.empty()) {
+            ++m_total_n;
+            m_idle.reserve(m_total_n);
+            m_active[slot_idx] = std::make_unique<ConnectionState>(m_intake_config);
+
+            return;
+        }
+
+        m_active[slot_idx] = std::move(m_idle.back());
+        m_idle.pop_back();
+    }
+
+    void ConnectionPool::checkin(int fd) noexcept {
+        const auto slot_idx = static_cast<std::size_t>(fd);
+
+        if (slot_idx >= m_active.size() || !m_active[slot_idx]) {
+            return;
+        }
+
+        m_active[slot_idx]->reset();
+        m_idle.push_back(std::move(m_active[slot_idx]));
+    }
+
+    auto ConnectionPool::session_of(int fd) noexcept -> ConnectionState& {
+        return *m_active[static_cast<std::size_t>(fd)];
+    }
+}
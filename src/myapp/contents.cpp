@@ -1,41 +1,216 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <system_error>
 #include <utility>
 #include <string>
-#include <sstream>
 
 #include "myapp/contents.hpp"
+#include "myapp/file_cache.hpp"
+#include "myapp/file_io_pool.hpp"
 
 namespace DerkHttpd::App {
-    TextIterator::TextIterator(std::ifstream fs_p, std::size_t chunk_len) noexcept
-    : m_ifstream_p {std::move(fs_p)}, m_chunk_len {chunk_len} {}
+    auto stat_file_identity(const std::filesystem::path& path) noexcept -> std::optional<FileIdentity> {
+        struct stat file_stat {};
 
-    [[nodiscard]] auto TextIterator::next() -> std::optional<Http::Blob> {
-        if (m_ifstream_p.eof() || m_chunk_len == 0) {
-            return Http::Blob {};
+        if (stat(path.c_str(), &file_stat) == -1 || !S_ISREG(file_stat.st_mode)) {
+            return {};
+        }
+
+        std::error_code time_err;
+        const auto modify_time = std::filesystem::last_write_time(path, time_err);
+
+        if (time_err) {
+            return {};
         }
 
-        Http::Blob temp;
+        return FileIdentity {
+            .inode = static_cast<std::uintmax_t>(file_stat.st_ino),
+            .size = static_cast<std::uintmax_t>(file_stat.st_size),
+            .modify_time = modify_time,
+        };
+    }
+
+    auto read_file_region(const Http::FileRegion& region) -> std::optional<Http::Blob> {
+        const FileHandle file {open(region.path.c_str(), O_RDONLY | O_CLOEXEC)};
+
+        if (!file.is_open()) {
+            return {};
+        }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(file.get(), static_cast<off_t>(region.offset), static_cast<off_t>(region.length), POSIX_FADV_SEQUENTIAL);
+#endif
+
+        return read_file_at(file.get(), region.offset, static_cast<std::size_t>(region.length));
+    }
+
+    auto read_file_at(int fd, std::uintmax_t offset, std::size_t length) -> std::optional<Http::Blob> {
+        Http::Blob data;
+        data.resize(length);
+
+        std::size_t done_n = 0;
 
-        for (std::size_t chunk_count = 0; chunk_count < m_chunk_len; ++chunk_count) {
-            if (auto ascii_b = m_ifstream_p.get(); ascii_b != -1) {
-                temp.push_back(static_cast<char>(ascii_b));
+        while (done_n < data.size()) {
+            const auto temp_n = pread(fd, data.data() + done_n, data.size() - done_n, static_cast<off_t>(offset + done_n));
+
+            if (temp_n > 0) {
+                done_n += static_cast<std::size_t>(temp_n);
+            } else if (temp_n == -1 && errno == EINTR) {
+                continue;
             } else {
-                break;
+                return {};
             }
         }
 
+        return data;
+    }
+
+    FileHandle::FileHandle(int fd) noexcept
+    : m_fd {fd} {}
+
+    FileHandle::~FileHandle() {
+        if (m_fd != -1) {
+            close(m_fd);
+        }
+    }
+
+    FileHandle::FileHandle(FileHandle&& other) noexcept
+    : m_fd {std::exchange(other.m_fd, -1)} {}
+
+    auto FileHandle::operator=(FileHandle&& other) noexcept -> FileHandle& {
+        if (this != &other) {
+            if (m_fd != -1) {
+                close(m_fd);
+            }
+
+            m_fd = std::exchange(other.m_fd, -1);
+        }
+
+        return *this;
+    }
+
+
+    auto fstat_file_identity(int fd) noexcept -> std::optional<FileIdentity> {
+        struct stat file_stat {};
+
+        if (fstat(fd, &file_stat) == -1 || !S_ISREG(file_stat.st_mode)) {
+            return {};
+        }
+
+#ifdef __APPLE__
+        const auto& modify_ts = file_stat.st_mtimespec;
+#else
+        const auto& modify_ts = file_stat.st_mtim;
+#endif
+
+        // NOTE: Matches what `std::filesystem::last_write_time` gives, so ETags agree with `stat_file_identity`.
+        const auto modify_sys_time = std::chrono::sys_time<std::chrono::nanoseconds> {std::chrono::seconds {modify_ts.tv_sec} + std::chrono::nanoseconds {modify_ts.tv_nsec}};
+
+        return FileIdentity {
+            .inode = static_cast<std::uintmax_t>(file_stat.st_ino),
+            .size = static_cast<std::uintmax_t>(file_stat.st_size),
+            .modify_time = std::chrono::time_point_cast<std::filesystem::file_time_type::duration>(std::chrono::file_clock::from_sys(modify_sys_time)),
+        };
+    }
+
+
+    FileBlockIterator::FileBlockIterator(FileHandle file, std::uintmax_t offset, std::uintmax_t length, std::size_t block_len)
+    : m_file {std::make_shared<const FileHandle>(std::move(file))}, m_pending_block {}, m_next_offset {offset}, m_unrequested_n {length}, m_block_len {block_len}, m_wakes_reactor {FileIOPool::instance().has_completion_signal()} {
+        if (!m_file->is_open() || m_block_len == 0) {
+            m_unrequested_n = 0;
+            return;
+        }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+        // NOTE: Chunked transfers read front to back, so the kernel may read ahead more aggressively.
+        posix_fadvise(m_file->get(), static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_SEQUENTIAL);
+#endif
+
+        request_next_block();
+    }
+
+    void FileBlockIterator::request_next_block() {
+        if (m_unrequested_n == 0) {
+            return;
+        }
+
+        const auto block_n = static_cast<std::size_t>(std::min<std::uintmax_t>(m_block_len, m_unrequested_n));
+
+        m_pending_block = FileIOPool::instance().read_async(m_file, m_next_offset, block_n);
+        m_next_offset += block_n;
+        m_unrequested_n -= block_n;
+
+#ifdef POSIX_FADV_WILLNEED
+        // Hint the block after this one too, so it is likely cached by the time it is requested.
+        if (m_unrequested_n > 0) {
+            posix_fadvise(m_file->get(), static_cast<off_t>(m_next_offset), static_cast<off_t>(std::min<std::uintmax_t>(m_block_len, m_unrequested_n)), POSIX_FADV_WILLNEED);
+        }
+#endif
+    }
+
+    auto FileBlockIterator::next() -> std::optional<Http::Blob> {
+        if (!m_pending_block.valid()) {
+            return Http::Blob {};
+        }
+
+        // A failed block means a read error or a file truncated mid-transfer: the promised bytes can't be sent, so the transfer must fail.
+        auto block = m_pending_block.get();
+
+        if (!block) {
+            m_unrequested_n = 0;
+            return {};
+        }
+
+        request_next_block();
+
+        return block;
+    }
+
+    void FileBlockIterator::clear() {
+        m_pending_block = {};
+        m_unrequested_n = 0;
+    }
+
+    auto FileBlockIterator::is_ready() const -> bool {
+        if (!m_wakes_reactor || !m_pending_block.valid()) {
+            return true;
+        }
+
+        return m_pending_block.wait_for(std::chrono::seconds::zero()) == std::future_status::ready;
+    }
+
+
+    CachedFileIterator::CachedFileIterator(std::shared_ptr<const CachedFile> file, std::size_t chunk_len) noexcept
+    : m_file {std::move(file)}, m_pos {0}, m_chunk_len {chunk_len} {}
+
+    auto CachedFileIterator::next() -> std::optional<Http::Blob> {
+        const auto file_bytes = m_file->bytes.view();
+
+        if (m_pos >= file_bytes.size() || m_chunk_len == 0) {
+            return Http::Blob {};
+        }
+
+        const auto slice_n = std::min(m_chunk_len, file_bytes.size() - m_pos);
+        Http::Blob temp (file_bytes.begin() + m_pos, file_bytes.begin() + m_pos + slice_n);
+
+        m_pos += slice_n;
+
         return temp;
     }
 
-    void TextIterator::clear() {
-        m_ifstream_p = {};
+    void CachedFileIterator::clear() {
+        m_pos = m_file->bytes.size();
         m_chunk_len = 0;
     }
 
 
     TextualFile::TextualFile(std::filesystem::path path, std::string_view mime, std::size_t chunk_n)
-    : m_data {path}, m_path {path}, m_mime {mime}, m_chunk_len {chunk_n} {}
-    
-    [[nodiscard]] static auto dud() noexcept -> std::optional<TextualFile>;
+    : m_path {path}, m_mime {mime}, m_chunk_len {chunk_n} {}
 
     auto TextualFile::create(std::filesystem::path relative_path, std::string_view mime_identifier, std::size_t chunk_n) noexcept -> std::optional<TextualFile> {
         if (!relative_path.is_relative() && !relative_path.has_filename()) {
@@ -45,23 +220,44 @@ namespace DerkHttpd::App {
         return TextualFile {relative_path, mime_identifier, chunk_n};
     }
 
-    /// NOTE: This method is destructive, moving the container `std::ifstream` into a deferred chunk generator for the response data.
     auto TextualFile::as_chunk_iter() noexcept -> ChunkIterPtr {
-        return std::make_shared<TextIterator>(std::move(m_data), m_chunk_len);
+        if (auto cached_file = FileCache::instance().fetch(m_path, m_mime); cached_file) {
+            return std::make_shared<CachedFileIterator>(std::move(cached_file), m_chunk_len);
+        }
+
+        FileHandle file {open(m_path.c_str(), O_RDONLY | O_CLOEXEC)};
+
+        if (!file.is_open()) {
+            return nullptr;
+        }
+
+        const auto file_identity = fstat_file_identity(file.get());
+
+        if (!file_identity) {
+            return nullptr;
+        }
+
+        return std::make_shared<FileBlockIterator>(std::move(file), 0, file_identity->size, m_chunk_len);
     }
 
     auto TextualFile::as_full_blob() noexcept -> Http::Blob {
-        std::ostringstream sout;
-        std::string line;
+        if (const auto cached_file = FileCache::instance().fetch(m_path, m_mime); cached_file) {
+            const auto file_bytes = cached_file->bytes.view();
 
-        while (std::getline(m_data, line, '\n')) {
-            sout << line << '\n';
+            return Http::Blob (file_bytes.begin(), file_bytes.end());
         }
 
-        Http::Blob blob;
-        blob.append_range(sout.str());
+        if (const auto file_identity = stat_file_identity(m_path); file_identity) {
+            if (auto file_bytes = read_file_region(Http::FileRegion {
+                .path = m_path,
+                .offset = 0,
+                .length = file_identity->size,
+            }); file_bytes) {
+                return std::move(file_bytes.value());
+            }
+        }
 
-        return blob;
+        return {};
     }
 
     /// NOTE: Gets a file's modification time as seconds since the Epoch start.
@@ -69,20 +265,87 @@ namespace DerkHttpd::App {
         return std::filesystem::last_write_time(m_path);
     }
 
+    auto TextualFile::get_path() const noexcept -> const std::filesystem::path& {
+        return m_path;
+    }
+
+
+    BinaryFile::BinaryFile(FileHandle file, std::filesystem::path path, FileIdentity identity, std::string_view mime, std::size_t block_n) noexcept
+    : m_file {std::move(file)}, m_path {std::move(path)}, m_identity {identity}, m_mime {mime}, m_block_len {block_n} {}
+
+    auto BinaryFile::create(std::filesystem::path path, std::string_view mime_identifier, std::size_t block_n) noexcept -> std::optional<BinaryFile> {
+        FileHandle file {open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+
+        if (!file.is_open()) {
+            return {};
+        }
+
+        const auto file_identity = fstat_file_identity(file.get());
+
+        if (!file_identity) {
+            return {};
+        }
+
+        return BinaryFile {std::move(file), std::move(path), file_identity.value(), mime_identifier, block_n};
+    }
+
+    auto BinaryFile::as_chunk_iter() noexcept -> ChunkIterPtr {
+        return std::make_shared<FileBlockIterator>(std::move(m_file), 0, m_identity.size, m_block_len);
+    }
+
+    auto BinaryFile::as_full_blob() && noexcept -> Http::Blob {
+        // NOTE: The whole file goes into a single pre-sized buffer.
+        const auto file = std::move(m_file);
+
+        if (auto file_bytes = read_file_at(file.get(), 0, static_cast<std::size_t>(m_identity.size)); file_bytes) {
+            return std::move(file_bytes.value());
+        }
+
+        return {};
+    }
+
+    auto BinaryFile::get_identity() const noexcept -> const FileIdentity& {
+        return m_identity;
+    }
+
+    auto BinaryFile::get_path() const noexcept -> const std::filesystem::path& {
+        return m_path;
+    }
+
+
+    StringReply::StringReply(std::string_view s, std::string_view mime)
+    : m_data {std::in_place_type<Http::Blob>, s.begin(), s.end()}, m_mime {mime} {}
 
-    StringReply::StringReply(std::string s, std::string_view mime) noexcept
-    : m_data (std::move(s)), m_mime {mime} {}
+    StringReply::StringReply(const char* s, std::string_view mime)
+    : StringReply {std::string_view {s}, mime} {}
 
-    StringReply::StringReply(Http::Blob&& b, std::string_view mime)
-    : m_data {}, m_mime {mime} {
-        m_data.append(b.begin(), b.end());
+    StringReply::StringReply(std::string&& s, std::string_view mime) noexcept
+    : m_data {std::in_place_type<std::string>, std::move(s)}, m_mime {mime} {}
+
+    StringReply::StringReply(Http::Blob&& b, std::string_view mime) noexcept
+    : m_data {std::in_place_type<Http::Blob>, std::move(b)}, m_mime {mime} {}
+
+    auto StringReply::as_full_blob() const& -> Http::Blob {
+        return std::visit([](const auto& data) -> Http::Blob {
+            return Http::Blob (data.begin(), data.end());
+        }, m_data);
     }
 
-    auto StringReply::as_full_blob() noexcept -> Http::Blob {
-        Http::Blob blob;
+    auto StringReply::as_full_blob() && -> Http::Blob {
+        if (auto blob_p = std::get_if<Http::Blob>(&m_data); blob_p) {
+            return std::move(*blob_p);
+        }
+
+        const auto& text = std::get<std::string>(m_data);
 
-        blob.append_range(m_data);
+        return Http::Blob (text.begin(), text.end());
+    }
+
+    auto StringReply::as_body() && -> std::variant<Http::Blob, Http::SharedBytes> {
+        if (auto text_p = std::get_if<std::string>(&m_data); text_p) {
+            return Http::SharedBytes {std::move(*text_p)};
+        }
 
-        return blob;
+        return std::move(std::get<Http::Blob>(m_data));
     }
 }
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <memory>
+
+#include "myapp/embedded_assets.hpp"
+
+namespace DerkHttpd::App {
+    auto find_embedded_asset(std::string_view uri_path) noexcept -> const EmbeddedAsset* {
+        const auto asset_index = embedded_asset_index();
+
+        if (const auto asset_it = std::ranges::lower_bound(asset_index, uri_path, {}, &EmbeddedAsset::path); asset_it != asset_index.end() && asset_it->path == uri_path) {
+            return &*asset_it;
+        }
+
+        return nullptr;
+    }
+
+
+    EmbeddedChunkIterator::EmbeddedChunkIterator(std::string_view bytes, std::size_t chunk_len) noexcept
+    : m_rest {bytes}, m_chunk_len {chunk_len} {}
+
+    auto EmbeddedChunkIterator::next() -> std::optional<Http::Blob> {
+        if (m_rest.empty() || m_chunk_len == 0) {
+            return Http::Blob {};
+        }
+
+        const auto slice = m_rest.substr(0, m_chunk_len);
+
+        m_rest.remove_prefix(slice.length());
+
+        return Http::Blob (slice.begin(), slice.end());
+    }
+
+    void EmbeddedChunkIterator::clear() {
+        m_rest = {};
+        m_chunk_len = 0;
+    }
+
+
+    EmbeddedFile::EmbeddedFile(const EmbeddedAsset* asset, std::size_t chunk_n) noexcept
+    : m_asset {asset}, m_chunk_len {chunk_n} {}
+
+    auto EmbeddedFile::create(std::string_view uri_path, std::size_t chunk_n) noexcept -> std::optional<EmbeddedFile> {
+        if (const auto asset_p = find_embedded_asset(uri_path); asset_p) {
+            return EmbeddedFile {asset_p, chunk_n};
+        }
+
+        return {};
+    }
+
+    auto EmbeddedFile::as_chunk_iter() noexcept -> ChunkIterPtr {
+        return std::make_shared<EmbeddedChunkIterator>(m_asset->identity, m_chunk_len);
+    }
+
+    auto EmbeddedFile::as_full_blob() noexcept -> Http::Blob {
+        return Http::Blob (m_asset->identity.begin(), m_asset->identity.end());
+    }
+
+    auto EmbeddedFile::get_asset() const noexcept -> const EmbeddedAsset& {
+        return *m_asset;
+    }
+}
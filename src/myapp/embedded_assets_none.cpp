@@ -0,0 +1,8 @@
+#include "myapp/embedded_assets.hpp"
+
+namespace DerkHttpd::App {
+    // NOTE: Stands in for the generated bundle when `DERKHTTPD_EMBED_ASSETS` is off.
+    auto embedded_asset_index() noexcept -> std::span<const EmbeddedAsset> {
+        return {};
+    }
+}
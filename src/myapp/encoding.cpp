@@ -0,0 +1,433 @@
+#include <zlib.h>
+
+#ifdef DERKHTTPD_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+#include "mynet/memory_budget.hpp"
+#include "myapp/encoding.hpp"
+
+namespace DerkHttpd::App {
+    constexpr auto zlib_window_bits = 15;
+    constexpr auto zlib_gzip_wrapper_bits = 16;
+    constexpr auto zlib_mem_level = 8;
+    constexpr auto encode_scratch_size = 4096;
+    constexpr auto variant_entry_budget_divisor = 4;
+    constexpr auto variant_memory_headroom_divisor = 4; // the share of `Net::MemoryBudget` that new variants must leave free
+
+    class StreamEncoder {
+    private:
+        z_stream m_zs;
+#ifdef DERKHTTPD_HAS_ZSTD
+        ZSTD_CCtx* m_zstd_ctx;
+#endif
+        Http::ContentCoding m_coding;
+        bool m_ready;
+
+        [[nodiscard]] auto feed_zlib(std::string_view input, bool finish, Http::Blob& out) -> bool {
+            std::array<char, encode_scratch_size> scratch;
+
+            m_zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+            m_zs.avail_in = static_cast<uInt>(input.size());
+
+            const auto flush_mode = finish ? Z_FINISH : Z_NO_FLUSH;
+            auto zlib_rc = Z_OK;
+
+            // NOTE: Same drain loop as zlib's zpipe example: keep deflating while the scratch space gets filled up.
+            do {
+                m_zs.next_out = reinterpret_cast<Bytef*>(scratch.data());
+                m_zs.avail_out = static_cast<uInt>(scratch.size());
+
+                if (zlib_rc = deflate(&m_zs, flush_mode); zlib_rc == Z_STREAM_ERROR) {
+                    return false;
+                }
+
+                out.append_range(std::string_view {scratch.data(), scratch.size() - m_zs.avail_out});
+            } while (m_zs.avail_out == 0);
+
+            return !finish || zlib_rc == Z_STREAM_END;
+        }
+
+#ifdef DERKHTTPD_HAS_ZSTD
+        [[nodiscard]] auto feed_zstd(std::string_view input, bool finish, Http::Blob& out) -> bool {
+            std::array<char, encode_scratch_size> scratch;
+            ZSTD_inBuffer zstd_in {input.data(), input.size(), 0};
+            const auto end_mode = finish ? ZSTD_e_end : ZSTD_e_continue;
+            auto stream_done = false;
+
+            while (!stream_done) {
+                ZSTD_outBuffer zstd_out {scratch.data(), scratch.size(), 0};
+                const auto pending_n = ZSTD_compressStream2(m_zstd_ctx, &zstd_out, &zstd_in, end_mode);
+
+                if (ZSTD_isError(pending_n)) {
+                    return false;
+                }
+
+                out.append_range(std::string_view {scratch.data(), zstd_out.pos});
+
+                stream_done = finish ? (pending_n == 0) : (zstd_in.pos == zstd_in.size);
+            }
+
+            return true;
+        }
+#endif
+
+    public:
+        StreamEncoder(Http::ContentCoding coding, int level) noexcept
+        : m_zs {},
+#ifdef DERKHTTPD_HAS_ZSTD
+        m_zstd_ctx {nullptr},
+#endif
+        m_coding {coding}, m_ready {false} {
+            switch (coding) {
+                case Http::ContentCoding::gzip:
+                    m_ready = deflateInit2(&m_zs, level, Z_DEFLATED, zlib_window_bits + zlib_gzip_wrapper_bits, zlib_mem_level, Z_DEFAULT_STRATEGY) == Z_OK;
+                    break;
+                case Http::ContentCoding::deflate:
+                    // NOTE: HTTP's "deflate" coding is really the zlib format (RFC 1950), not raw DEFLATE.
+                    m_ready = deflateInit2(&m_zs, level, Z_DEFLATED, zlib_window_bits, zlib_mem_level, Z_DEFAULT_STRATEGY) == Z_OK;
+                    break;
+#ifdef DERKHTTPD_HAS_ZSTD
+                case Http::ContentCoding::zstd:
+                    if (m_zstd_ctx = ZSTD_createCCtx(); m_zstd_ctx != nullptr) {
+                        m_ready = !ZSTD_isError(ZSTD_CCtx_setParameter(m_zstd_ctx, ZSTD_c_compressionLevel, level));
+                    }
+                    break;
+#endif
+                default:
+                    break;
+            }
+        }
+
+        ~StreamEncoder() {
+            if (m_coding == Http::ContentCoding::gzip || m_coding == Http::ContentCoding::deflate) {
+                if (m_ready) {
+                    deflateEnd(&m_zs);
+                }
+            }
+#ifdef DERKHTTPD_HAS_ZSTD
+            if (m_zstd_ctx != nullptr) {
+                ZSTD_freeCCtx(m_zstd_ctx);
+            }
+#endif
+        }
+
+        StreamEncoder(const StreamEncoder&) = delete;
+        StreamEncoder& operator=(const StreamEncoder&) = delete;
+        StreamEncoder(StreamEncoder&&) = delete;
+        StreamEncoder& operator=(StreamEncoder&&) = delete;
+
+        [[nodiscard]] auto is_ready() const noexcept -> bool {
+            return m_ready;
+        }
+
+        /// NOTE: Appends any compressed output for `input` into `out`. Passing `finish = true` flushes the coding's trailer, after which this encoder is spent. Growing `out` may throw `std::bad_alloc`.
+        [[nodiscard]] auto feed(std::string_view input, bool finish, Http::Blob& out) -> bool {
+            if (!m_ready) {
+                return false;
+            }
+
+#ifdef DERKHTTPD_HAS_ZSTD
+            if (m_coding == Http::ContentCoding::zstd) {
+                return feed_zstd(input, finish, out);
+            }
+#endif
+
+            return feed_zlib(input, finish, out);
+        }
+    };
+
+
+    auto negotiate_content_coding(std::string_view accept_encoding) noexcept -> std::optional<Http::ContentCoding> {
+        constexpr auto q_scale = 1000;
+        constexpr std::string_view spacing_chars = " \t";
+
+        std::array<int, Http::scoped_enum_len<Http::ContentCoding>()> coding_weights {};
+        auto wildcard_weight = -1;
+
+        std::ranges::fill(coding_weights, -1);
+
+        // 1. Record each listed coding's weight as `q * 1000`, e.g `gzip;q=0.5` -> 500.
+        while (!accept_encoding.empty()) {
+            const auto comma_pos = accept_encoding.find(',');
+            auto item_sv = accept_encoding.substr(0, comma_pos);
+            accept_encoding = (comma_pos == std::string_view::npos) ? std::string_view {} : accept_encoding.substr(comma_pos + 1);
+
+            const auto semi_pos = item_sv.find(';');
+            auto name_sv = item_sv.substr(0, semi_pos);
+            auto weight = q_scale;
+
+            if (const auto name_begin = name_sv.find_first_not_of(spacing_chars); name_begin == std::string_view::npos) {
+                continue;
+            } else {
+                name_sv = name_sv.substr(name_begin, name_sv.find_last_not_of(spacing_chars) - name_begin + 1);
+            }
+
+            if (semi_pos != std::string_view::npos) {
+                if (const auto q_pos = item_sv.find("q=", semi_pos); q_pos != std::string_view::npos) {
+                    auto q_sv = item_sv.substr(q_pos + 2);
+                    auto q_whole = 0;
+                    auto q_millis = 0;
+                    auto q_digit_scale = 100;
+
+                    if (!q_sv.empty() && (q_sv[0] == '0' || q_sv[0] == '1')) {
+                        q_whole = q_sv[0] - '0';
+                    }
+
+                    if (q_sv.length() > 1 && q_sv[1] == '.') {
+                        for (const auto q_digit : q_sv.substr(2, 3)) {
+                            if (q_digit < '0' || q_digit > '9') {
+                                break;
+                            }
+
+                            q_millis += (q_digit - '0') * q_digit_scale;
+                            q_digit_scale /= 10;
+                        }
+                    }
+
+                    weight = std::min(q_scale, q_whole * q_scale + q_millis);
+                }
+            }
+
+            if (name_sv == "*") {
+                wildcard_weight = weight;
+                continue;
+            }
+
+            for (std::size_t coding_idx = 0; coding_idx < coding_weights.size(); ++coding_idx) {
+                if (name_sv == Http::coding_enum_to_name(static_cast<Http::ContentCoding>(coding_idx))) {
+                    coding_weights[coding_idx] = weight;
+                }
+            }
+        }
+
+        // 2. As per RFC 9110 (section 12.5.3), `identity` is acceptable unless excluded by its own entry or by `*` with q=0. When unlisted, it ranks below every acceptable coding.
+        constexpr auto implicit_identity_weight = 1;
+        const auto listed_identity_weight = coding_weights[static_cast<std::size_t>(Http::ContentCoding::identity)];
+        const auto identity_weight = (listed_identity_weight >= 0) ? listed_identity_weight : ((wildcard_weight >= 0) ? std::min(wildcard_weight, implicit_identity_weight) : implicit_identity_weight);
+
+        std::optional<Http::ContentCoding> best_coding;
+        auto best_weight = 0;
+
+        if (identity_weight > 0) {
+            best_coding = Http::ContentCoding::identity;
+            best_weight = identity_weight;
+        }
+
+        // 3. Pick the heaviest acceptable coding, preferring codings over `identity` and later enumerators on ties.
+        for (std::size_t coding_idx = 1; coding_idx < coding_weights.size(); ++coding_idx) {
+            const auto coding = static_cast<Http::ContentCoding>(coding_idx);
+
+#ifndef DERKHTTPD_HAS_ZSTD
+            if (coding == Http::ContentCoding::zstd) {
+                continue;
+            }
+#endif
+
+            const auto weight = (coding_weights[coding_idx] >= 0) ? coding_weights[coding_idx] : wildcard_weight;
+
+            if (weight > 0 && weight >= best_weight) {
+                best_coding = coding;
+                best_weight = weight;
+            }
+        }
+
+        return best_coding;
+    }
+
+    auto is_compressible_mime(std::string_view mime) noexcept -> bool {
+        if (mime.starts_with("text/")) {
+            return true;
+        }
+
+        constexpr std::array<std::string_view, 5> textual_app_mimes {
+            "application/javascript",
+            "application/json",
+            "application/xml",
+            "application/xhtml+xml",
+            "image/svg+xml",
+        };
+
+        return std::ranges::any_of(textual_app_mimes, [mime](std::string_view textual_mime) noexcept -> bool {
+            return mime.starts_with(textual_mime);
+        });
+    }
+
+    auto encode_blob(std::string_view bytes, Http::ContentCoding coding, int level) -> std::optional<Http::Blob> {
+        StreamEncoder encoder {coding, level};
+        Http::Blob encoded;
+
+        encoded.reserve(bytes.size() / 2);
+
+        if (!encoder.feed(bytes, true, encoded)) {
+            return {};
+        }
+
+        return encoded;
+    }
+
+    auto encode_blob(const Http::Blob& blob, Http::ContentCoding coding, int level) -> std::optional<Http::Blob> {
+        return encode_blob(std::string_view {blob.data(), blob.size()}, coding, level);
+    }
+
+
+    EncodingChunkIter::EncodingChunkIter(ChunkIterPtr source, Http::ContentCoding coding, int level)
+    : m_source {std::move(source)}, m_encoder {std::make_unique<StreamEncoder>(coding, level)}, m_done {false} {}
+
+    EncodingChunkIter::~EncodingChunkIter() = default;
+
+    auto EncodingChunkIter::next() -> std::optional<Http::Blob> {
+        if (m_done) {
+            return Http::Blob {};
+        }
+
+        Http::Blob encoded;
+
+        // NOTE: The codec may buffer a whole input chunk without output, but an empty chunk would end the transfer early. So keep feeding until some bytes come out or the source ends.
+        while (encoded.empty()) {
+            auto raw_chunk = m_source->next();
+
+            if (!raw_chunk) {
+                return {};
+            }
+
+            const auto source_ended = raw_chunk->empty();
+
+            if (!m_encoder->feed({raw_chunk->data(), raw_chunk->size()}, source_ended, encoded)) {
+                return {};
+            }
+
+            if (source_ended) {
+                m_done = true;
+                break;
+            }
+        }
+
+        return encoded;
+    }
+
+    void EncodingChunkIter::clear() {
+        m_source->clear();
+        m_done = true;
+    }
+
+    auto EncodingChunkIter::is_ready() const -> bool {
+        return m_done || m_source->is_ready();
+    }
+
+
+    EncodedVariantCache::EncodedVariantCache() noexcept
+    : m_entries_mtx {}, m_entries {}, m_lru_origins {}, m_byte_budget {default_byte_budget}, m_used_bytes {0} {}
+
+    auto EncodedVariantCache::instance() noexcept -> EncodedVariantCache& {
+        static EncodedVariantCache shared_cache;
+
+        return shared_cache;
+    }
+
+    void EncodedVariantCache::drop_entry(std::map<std::filesystem::path, Entry>::iterator entry_it) noexcept {
+        const auto& [entry_time, entry_variants, entry_lru_it, entry_byte_n] = entry_it->second;
+
+        m_used_bytes -= entry_byte_n;
+        Net::MemoryBudget::instance().release(entry_byte_n);
+        m_lru_origins.erase(entry_lru_it);
+        m_entries.erase(entry_it);
+    }
+
+    void EncodedVariantCache::set_byte_budget(std::size_t byte_budget) {
+        std::lock_guard entries_lock {m_entries_mtx};
+
+        m_byte_budget = byte_budget;
+
+        while (m_used_bytes > m_byte_budget && !m_lru_origins.empty()) {
+            drop_entry(m_entries.find(m_lru_origins.back()));
+        }
+    }
+
+    auto EncodedVariantCache::fetch(const std::filesystem::path& origin, std::filesystem::file_time_type modify_time, Http::ContentCoding coding, int level, const std::function<std::optional<Http::Blob>()>& load_identity) -> std::optional<Http::SharedBytes> {
+        const auto coding_idx = static_cast<std::size_t>(coding);
+
+        // 1. Serve a hit, refreshing its file's recency. The variant limit is taken under the same lock, as `set_byte_budget` may change the budget meanwhile.
+        std::size_t variant_byte_limit = 0;
+
+        {
+            std::lock_guard entries_lock {m_entries_mtx};
+
+            variant_byte_limit = m_byte_budget / variant_entry_budget_divisor;
+
+            if (auto entry_it = m_entries.find(origin); entry_it != m_entries.end() && entry_it->second.modify_time == modify_time) {
+                if (const auto& variant = entry_it->second.variants[coding_idx]; variant) {
+                    m_lru_origins.splice(m_lru_origins.begin(), m_lru_origins, entry_it->second.lru_it);
+
+                    return variant;
+                }
+            }
+        }
+
+        // 2. Read and compress outside of the lock, since a concurrent miss for the same file only costs a duplicate encode.
+        auto identity = load_identity();
+
+        if (!identity) {
+            return {};
+        }
+
+        auto encoded = encode_blob(identity.value(), coding, level);
+
+        if (!encoded) {
+            return {};
+        }
+
+        Http::SharedBytes encoded_bytes {std::move(encoded.value())};
+        const auto variant_n = encoded_bytes.size();
+        auto& memory_budget = Net::MemoryBudget::instance();
+
+        // 3. Storing is optional, so it backs off while requests need the process' memory. The variant still serves this response either way.
+        if (variant_n > variant_byte_limit || !memory_budget.try_reserve(variant_n, memory_budget.get_limit() / variant_memory_headroom_divisor)) {
+            return encoded_bytes;
+        }
+
+        std::lock_guard entries_lock {m_entries_mtx};
+        auto entry_it = m_entries.find(origin);
+
+        // 4. A changed file makes all of its older variants stale.
+        if (entry_it != m_entries.end() && entry_it->second.modify_time != modify_time) {
+            drop_entry(entry_it);
+            entry_it = m_entries.end();
+        }
+
+        if (entry_it == m_entries.end()) {
+            m_lru_origins.push_front(origin);
+            entry_it = m_entries.emplace(origin, Entry {
+                .modify_time = modify_time,
+                .variants = {},
+                .lru_it = m_lru_origins.begin(),
+                .byte_n = 0,
+            }).first;
+        } else {
+            m_lru_origins.splice(m_lru_origins.begin(), m_lru_origins, entry_it->second.lru_it);
+        }
+
+        auto& entry = entry_it->second;
+
+        // 5. Keep the variant that a concurrent miss stored first, then evict down to the budget.
+        if (const auto& stored_variant = entry.variants[coding_idx]; stored_variant) {
+            memory_budget.release(variant_n);
+
+            return stored_variant;
+        }
+
+        entry.variants[coding_idx] = encoded_bytes;
+        entry.byte_n += variant_n;
+        m_used_bytes += variant_n;
+
+        while (m_used_bytes > m_byte_budget && m_lru_origins.size() > 1) {
+            drop_entry(m_entries.find(m_lru_origins.back()));
+        }
+
+        return encoded_bytes;
+    }
+}
@@ -0,0 +1,85 @@
+#include <chrono>
+#include <format>
+
+#include "myapp/etags.hpp"
+
+namespace DerkHttpd::App {
+    constexpr std::string_view weak_etag_prefix = "W/";
+    constexpr std::string_view etag_spacing_chars = " \t";
+
+    /// NOTE: Strips the weakness prefix and quotes, and with `strip_coding` any content-coding suffix too, leaving the opaque tag.
+    [[nodiscard]] static auto opaque_tag(std::string_view etag, bool strip_coding) noexcept -> std::string_view {
+        if (etag.starts_with(weak_etag_prefix)) {
+            etag.remove_prefix(weak_etag_prefix.length());
+        }
+
+        if (etag.length() < 2 || !etag.starts_with('"') || !etag.ends_with('"')) {
+            return {};
+        }
+
+        etag = etag.substr(1, etag.length() - 2);
+
+        if (!strip_coding) {
+            return etag;
+        }
+
+        for (std::size_t coding_idx = 1; coding_idx < Http::scoped_enum_len<Http::ContentCoding>(); ++coding_idx) {
+            const auto coding_name = Http::coding_enum_to_name(static_cast<Http::ContentCoding>(coding_idx));
+
+            if (etag.length() > coding_name.length() + 1 && etag.ends_with(coding_name) && etag[etag.length() - coding_name.length() - 1] == '-') {
+                return etag.substr(0, etag.length() - coding_name.length() - 1);
+            }
+        }
+
+        return etag;
+    }
+
+    auto make_entity_tag(const FileIdentity& identity) -> std::string {
+        const auto modify_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(identity.modify_time.time_since_epoch()).count();
+
+        return std::format("\"{:x}-{:x}-{:x}\"", identity.inode, identity.size, static_cast<unsigned long long>(modify_ns));
+    }
+
+    auto make_coded_entity_tag(std::string_view etag, Http::ContentCoding coding) -> std::string {
+        if (coding == Http::ContentCoding::identity || !etag.ends_with('"')) {
+            return std::string {etag};
+        }
+
+        return std::format("{}-{}\"", etag.substr(0, etag.length() - 1), Http::coding_enum_to_name(coding));
+    }
+
+    auto match_entity_tag(std::string_view candidates, std::string_view etag, bool strong) noexcept -> bool {
+        // A coded variant has different bytes, so only the weak comparison may treat it as the same resource. Otherwise a range of identity bytes could resume a gzip download.
+        const auto etag_opaque = opaque_tag(etag, !strong);
+
+        if (etag_opaque.empty() || (strong && etag.starts_with(weak_etag_prefix))) {
+            return false;
+        }
+
+        while (!candidates.empty()) {
+            const auto comma_pos = candidates.find(',');
+            auto candidate_sv = candidates.substr(0, comma_pos);
+            candidates = (comma_pos == std::string_view::npos) ? std::string_view {} : candidates.substr(comma_pos + 1);
+
+            if (const auto tag_begin = candidate_sv.find_first_not_of(etag_spacing_chars); tag_begin == std::string_view::npos) {
+                continue;
+            } else {
+                candidate_sv = candidate_sv.substr(tag_begin, candidate_sv.find_last_not_of(etag_spacing_chars) - tag_begin + 1);
+            }
+
+            if (candidate_sv == "*") {
+                return true;
+            }
+
+            if (strong && candidate_sv.starts_with(weak_etag_prefix)) {
+                continue;
+            }
+
+            if (opaque_tag(candidate_sv, !strong) == etag_opaque) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,255 @@
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include <poll.h>
+#include <unistd.h>
+
+#include <array>
+#include <utility>
+
+#include "mynet/memory_budget.hpp"
+#include "myapp/etags.hpp"
+#include "myapp/file_cache.hpp"
+
+namespace DerkHttpd::App {
+    constexpr auto watcher_poll_timeout_ms = 250;
+    constexpr auto cache_entry_budget_divisor = 4;
+    constexpr auto cache_memory_headroom_divisor = 4; // the share of `Net::MemoryBudget` that new entries must leave free
+
+#ifdef __linux__
+    constexpr auto file_change_events = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+#endif
+
+    FileCache::FileCache()
+    : m_slots_mtx {}, m_slots {}, m_watched_keys {}, m_lru_keys {}, m_byte_budget {default_byte_budget}, m_used_bytes {0}, m_notify_fd {-1}, m_watcher {} {
+#ifdef __linux__
+        if (m_notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC); m_notify_fd != -1) {
+            m_watcher = std::jthread {[this](std::stop_token stop_tk) {
+                watch_changes(stop_tk);
+            }};
+        }
+#endif
+    }
+
+    FileCache::~FileCache() {
+        if (m_watcher.joinable()) {
+            m_watcher.request_stop();
+            m_watcher.join();
+        }
+
+        if (m_notify_fd != -1) {
+            close(m_notify_fd);
+        }
+    }
+
+    void FileCache::drop_slot(std::unordered_map<std::string, Slot>::iterator slot_it) {
+        auto& [slot_file, slot_lru_it, slot_watch_desc] = slot_it->second;
+
+#ifdef __linux__
+        if (slot_watch_desc != -1) {
+            inotify_rm_watch(m_notify_fd, slot_watch_desc);
+            m_watched_keys.erase(slot_watch_desc);
+        }
+#endif
+
+        m_used_bytes -= slot_file->bytes.size();
+        Net::MemoryBudget::instance().release(slot_file->bytes.size());
+        m_lru_keys.erase(slot_lru_it);
+        m_slots.erase(slot_it);
+    }
+
+    void FileCache::release_load_watch(int watch_desc, const std::string& slot_key) {
+#ifdef __linux__
+        if (watch_desc == -1) {
+            return;
+        }
+
+        if (auto slot_it = m_slots.find(slot_key); slot_it != m_slots.end() && slot_it->second.watch_desc == watch_desc) {
+            return;
+        }
+
+        if (auto watched_it = m_watched_keys.find(watch_desc); watched_it != m_watched_keys.end()) {
+            inotify_rm_watch(m_notify_fd, watch_desc);
+            m_watched_keys.erase(watched_it);
+        }
+#else
+        static_cast<void>(watch_desc);
+        static_cast<void>(slot_key);
+#endif
+    }
+
+    void FileCache::watch_changes(std::stop_token stop_tk) {
+#ifdef __linux__
+        alignas(inotify_event) std::array<char, 4096> event_buffer;
+
+        while (!stop_tk.stop_requested()) {
+            pollfd notify_pfd {
+                .fd = m_notify_fd,
+                .events = POLLIN,
+                .revents = 0,
+            };
+
+            if (poll(&notify_pfd, 1, watcher_poll_timeout_ms) <= 0) {
+                continue;
+            }
+
+            const auto read_n = read(m_notify_fd, event_buffer.data(), event_buffer.size());
+
+            if (read_n <= 0) {
+                continue;
+            }
+
+            std::lock_guard slots_lock {m_slots_mtx};
+
+            for (ssize_t event_pos = 0; event_pos < read_n;) {
+                const auto event_p = reinterpret_cast<const inotify_event*>(event_buffer.data() + event_pos);
+
+                // Any change to a watched file makes its snapshot stale, so drop it and let the next hit reload it. A load still reading the file sees the bumped count and stores nothing.
+                if (auto watched_it = m_watched_keys.find(event_p->wd); watched_it != m_watched_keys.end()) {
+                    ++watched_it->second.change_n;
+
+                    if (auto slot_it = m_slots.find(watched_it->second.key); slot_it != m_slots.end()) {
+                        drop_slot(slot_it);
+                    }
+                }
+
+                event_pos += static_cast<ssize_t>(sizeof(inotify_event) + event_p->len);
+            }
+        }
+#else
+        static_cast<void>(stop_tk);
+#endif
+    }
+
+    auto FileCache::instance() -> FileCache& {
+        static FileCache shared_cache;
+
+        return shared_cache;
+    }
+
+    void FileCache::set_byte_budget(std::size_t byte_budget) {
+        std::lock_guard slots_lock {m_slots_mtx};
+
+        m_byte_budget = byte_budget;
+
+        while (m_used_bytes > m_byte_budget && !m_lru_keys.empty()) {
+            drop_slot(m_slots.find(m_lru_keys.back()));
+        }
+    }
+
+    auto FileCache::fetch(const std::filesystem::path& path, std::string_view mime) -> CachedFilePtr {
+        auto slot_key = path.lexically_normal().string();
+
+        // 1. Serve a hit, refreshing its recency. The entry limit is taken under the same lock, as `set_byte_budget` may change the budget meanwhile.
+        std::size_t entry_byte_limit = 0;
+
+        {
+            std::lock_guard slots_lock {m_slots_mtx};
+
+            entry_byte_limit = m_byte_budget / cache_entry_budget_divisor;
+
+            if (auto slot_it = m_slots.find(slot_key); slot_it != m_slots.end()) {
+#ifndef __linux__
+                // Without inotify, a changed modify time is the only sign of staleness.
+                if (std::error_code time_err; std::filesystem::last_write_time(path, time_err) != slot_it->second.file->identity.modify_time || time_err) {
+                    drop_slot(slot_it);
+                } else
+#endif
+                {
+                    m_lru_keys.splice(m_lru_keys.begin(), m_lru_keys, slot_it->second.lru_it);
+
+                    return slot_it->second.file;
+                }
+            }
+        }
+
+        // 2. Check that the file is worth caching before any watch is set up. Caching is optional, so it backs off while requests need the process' memory: without room, the file is just sent from disk.
+        const auto file_identity = stat_file_identity(path);
+        auto& memory_budget = Net::MemoryBudget::instance();
+
+        if (!file_identity || file_identity->size > entry_byte_limit || !memory_budget.try_reserve(file_identity->size, memory_budget.get_limit() / cache_memory_headroom_divisor)) {
+            return nullptr;
+        }
+
+        // 3. Register the watch before reading, so a write racing with the load is counted. A write before the watch existed shows up in the second stat below.
+        auto watch_desc = -1;
+        [[maybe_unused]] std::uint64_t load_change_n = 0;
+
+#ifdef __linux__
+        if (m_notify_fd != -1) {
+            if (watch_desc = inotify_add_watch(m_notify_fd, path.c_str(), file_change_events); watch_desc != -1) {
+                std::lock_guard slots_lock {m_slots_mtx};
+                auto& watched_key = m_watched_keys[watch_desc];
+
+                watched_key.key = slot_key;
+                load_change_n = watched_key.change_n;
+            }
+        }
+#endif
+
+        auto file_bytes = read_file_region(Http::FileRegion {
+            .path = path,
+            .offset = 0,
+            .length = file_identity->size,
+        });
+
+        const auto is_unchanged = file_bytes && stat_file_identity(path) == file_identity;
+
+        std::lock_guard slots_lock {m_slots_mtx};
+
+#ifdef __linux__
+        const auto watched_it = m_watched_keys.find(watch_desc);
+        const auto is_unwatched_or_quiet = watch_desc == -1 || (watched_it != m_watched_keys.end() && watched_it->second.change_n == load_change_n);
+#else
+        const auto is_unwatched_or_quiet = true;
+#endif
+
+        // 4. Store nothing when the file changed during the load, as the bytes may mix two versions. It is sent from disk instead.
+        if (!is_unchanged || !is_unwatched_or_quiet) {
+            memory_budget.release(file_identity->size);
+            release_load_watch(watch_desc, slot_key);
+
+            return nullptr;
+        }
+
+        auto cached_file = std::make_shared<const CachedFile>(CachedFile {
+            .bytes = Http::SharedBytes {std::move(file_bytes.value())},
+            .identity = file_identity.value(),
+            .etag = make_entity_tag(file_identity.value()),
+            .mime = mime,
+        });
+
+        // 5. Replace any entry that a concurrent miss stored first, then evict down to the budget. The old entry shares this load's watch while the file kept its inode. After a replace by rename its watch is another inode's, so it is removed too, or that inode's later events would drop the fresh slot.
+        if (auto slot_it = m_slots.find(slot_key); slot_it != m_slots.end() && slot_it->second.watch_desc != watch_desc) {
+            drop_slot(slot_it);
+        } else if (slot_it != m_slots.end()) {
+            m_used_bytes -= slot_it->second.file->bytes.size();
+            memory_budget.release(slot_it->second.file->bytes.size());
+            m_lru_keys.erase(slot_it->second.lru_it);
+            m_slots.erase(slot_it);
+        }
+
+        m_lru_keys.push_front(slot_key);
+        m_used_bytes += cached_file->bytes.size();
+
+        m_slots.emplace(std::move(slot_key), Slot {
+            .file = cached_file,
+            .lru_it = m_lru_keys.begin(),
+            .watch_desc = watch_desc,
+        });
+
+        while (m_used_bytes > m_byte_budget && m_lru_keys.size() > 1) {
+            drop_slot(m_slots.find(m_lru_keys.back()));
+        }
+
+        return cached_file;
+    }
+
+    void FileCache::invalidate(const std::filesystem::path& path) {
+        std::lock_guard slots_lock {m_slots_mtx};
+
+        if (auto slot_it = m_slots.find(path.lexically_normal().string()); slot_it != m_slots.end()) {
+            drop_slot(slot_it);
+        }
+    }
+}
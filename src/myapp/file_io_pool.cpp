@@ -0,0 +1,87 @@
+#include <utility>
+
+#include "myapp/file_io_pool.hpp"
+
+namespace DerkHttpd::App {
+    FileIOPool::FileIOPool()
+    : m_jobs_mtx {}, m_jobs_cv {}, m_jobs {}, m_completion_signal {}, m_workers {} {
+        for (std::size_t worker_idx = 0; worker_idx < default_worker_n; ++worker_idx) {
+            m_workers.emplace_back([this](std::stop_token stop_tk) {
+                run_jobs(stop_tk);
+            });
+        }
+    }
+
+    FileIOPool::~FileIOPool() {
+        for (auto& worker : m_workers) {
+            worker.request_stop();
+        }
+
+        m_workers.clear();
+    }
+
+    void FileIOPool::run_jobs(std::stop_token stop_tk) {
+        while (true) {
+            Job job;
+            std::shared_ptr<Net::WakeSignal> completion_signal;
+
+            {
+                std::unique_lock jobs_lock {m_jobs_mtx};
+
+                if (!m_jobs_cv.wait(jobs_lock, stop_tk, [this]() noexcept -> bool {
+                    return !m_jobs.empty();
+                })) {
+                    return;
+                }
+
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+                completion_signal = m_completion_signal;
+            }
+
+            job();
+
+            if (completion_signal) {
+                completion_signal->notify();
+            }
+        }
+    }
+
+    auto FileIOPool::instance() -> FileIOPool& {
+        static FileIOPool shared_pool;
+
+        return shared_pool;
+    }
+
+    void FileIOPool::set_completion_signal(std::shared_ptr<Net::WakeSignal> completion_signal) {
+        std::lock_guard jobs_lock {m_jobs_mtx};
+
+        m_completion_signal = std::move(completion_signal);
+    }
+
+    auto FileIOPool::has_completion_signal() -> bool {
+        std::lock_guard jobs_lock {m_jobs_mtx};
+
+        return m_completion_signal != nullptr;
+    }
+
+    auto FileIOPool::read_async(std::shared_ptr<const FileHandle> file, std::uintmax_t offset, std::size_t length) -> std::future<std::optional<Http::Blob>> {
+        std::packaged_task<std::optional<Http::Blob>()> read_task {[file = std::move(file), offset, length]() -> std::optional<Http::Blob> {
+            return read_file_at(file->get(), offset, length);
+        }};
+
+        auto read_result = read_task.get_future();
+
+        {
+            std::lock_guard jobs_lock {m_jobs_mtx};
+
+            m_jobs.emplace_back([read_task = std::move(read_task)]() mutable {
+                read_task();
+            });
+        }
+
+        m_jobs_cv.notify_one();
+
+        return read_result;
+    }
+}
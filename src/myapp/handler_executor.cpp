@@ -0,0 +1,142 @@
+#include <algorithm>
+
+#include "myapp/handler_executor.hpp"
+
+namespace DerkHttpd::App {
+    constexpr std::size_t no_worker_idx = static_cast<std::size_t>(-1);
+
+    // Which pool and worker the current thread belongs to, so a job submitted from a handler stays on its worker's deque.
+    thread_local const HandlerExecutor* current_executor = nullptr;
+    thread_local std::size_t current_worker_idx = no_worker_idx;
+
+    void HandlerExecutor::push_job(Job job) {
+        const auto queue_idx = (current_executor == this)
+            ? current_worker_idx
+            : m_next_queue_idx.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+        // Counting under the deque's lock, before the job is visible, keeps a worker that pops it at once from taking the count below zero.
+        {
+            auto& queue = *m_queues[queue_idx];
+            std::lock_guard jobs_lock {queue.jobs_mtx};
+
+            m_queued_n.fetch_add(1, std::memory_order_release);
+            queue.jobs.emplace_back(std::move(job));
+        }
+
+        // Passing through the idle lock orders this push before a worker's check of the predicate, so the wake-up cannot be lost.
+        {
+            std::lock_guard idle_lock {m_idle_mtx};
+        }
+
+        m_idle_cv.notify_one();
+    }
+
+    auto HandlerExecutor::pop_own(std::size_t worker_idx) -> std::optional<Job> {
+        auto& queue = *m_queues[worker_idx];
+        std::lock_guard jobs_lock {queue.jobs_mtx};
+
+        if (queue.jobs.empty()) {
+            return {};
+        }
+
+        auto job = std::move(queue.jobs.back());
+
+        queue.jobs.pop_back();
+        m_queued_n.fetch_sub(1, std::memory_order_relaxed);
+
+        return job;
+    }
+
+    auto HandlerExecutor::steal(std::size_t thief_idx) -> std::optional<Job> {
+        const auto queue_n = m_queues.size();
+
+        for (std::size_t victim_offset = 1; victim_offset < queue_n; ++victim_offset) {
+            auto& victim = *m_queues[(thief_idx + victim_offset) % queue_n];
+            std::unique_lock jobs_lock {victim.jobs_mtx, std::try_to_lock};
+
+            // A busy deque is skipped rather than waited on, as another victim may be free.
+            if (!jobs_lock.owns_lock() || victim.jobs.empty()) {
+                continue;
+            }
+
+            auto job = std::move(victim.jobs.front());
+
+            victim.jobs.pop_front();
+            m_queued_n.fetch_sub(1, std::memory_order_relaxed);
+            m_queues[thief_idx]->steal_n.fetch_add(1, std::memory_order_relaxed);
+
+            return job;
+        }
+
+        return {};
+    }
+
+    void HandlerExecutor::run_jobs(std::stop_token stop_tk, std::size_t worker_idx) {
+        current_executor = this;
+        current_worker_idx = worker_idx;
+
+        while (!stop_tk.stop_requested()) {
+            // 1. Prefer local work, then steal, and only sleep once no deque has a job.
+            if (auto job = pop_own(worker_idx).or_else([this, worker_idx]() {
+                return steal(worker_idx);
+            }); job) {
+                (*job)();
+                m_queues[worker_idx]->run_n.fetch_add(1, std::memory_order_relaxed);
+
+                continue;
+            }
+
+            // 2. A skipped busy deque may still hold work, so only sleep when the count says every deque is empty.
+            std::unique_lock idle_lock {m_idle_mtx};
+
+            m_idle_cv.wait(idle_lock, stop_tk, [this]() noexcept -> bool {
+                return m_queued_n.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+    auto HandlerExecutor::default_worker_n() noexcept -> std::size_t {
+        return std::max(std::size_t {2}, static_cast<std::size_t>(std::thread::hardware_concurrency()));
+    }
+
+    HandlerExecutor::HandlerExecutor(std::size_t worker_n)
+    : m_queues {}, m_idle_mtx {}, m_idle_cv {}, m_queued_n {0}, m_next_queue_idx {0}, m_workers {} {
+        const auto checked_worker_n = std::max(worker_n, std::size_t {1});
+
+        m_queues.reserve(checked_worker_n);
+
+        for (std::size_t worker_idx = 0; worker_idx < checked_worker_n; ++worker_idx) {
+            m_queues.emplace_back(std::make_unique<WorkerQueue>());
+        }
+
+        for (std::size_t worker_idx = 0; worker_idx < checked_worker_n; ++worker_idx) {
+            m_workers.emplace_back([this, worker_idx](std::stop_token stop_tk) {
+                run_jobs(stop_tk, worker_idx);
+            });
+        }
+    }
+
+    HandlerExecutor::~HandlerExecutor() {
+        for (auto& worker : m_workers) {
+            worker.request_stop();
+        }
+
+        m_workers.clear();
+    }
+
+    auto HandlerExecutor::get_stats() const noexcept -> ExecutorStats {
+        ExecutorStats stats {
+            .worker_n = m_queues.size(),
+            .queued_n = m_queued_n.load(std::memory_order_relaxed),
+            .run_n = 0,
+            .steal_n = 0,
+        };
+
+        for (const auto& queue : m_queues) {
+            stats.run_n += queue->run_n.load(std::memory_order_relaxed);
+            stats.steal_n += queue->steal_n.load(std::memory_order_relaxed);
+        }
+
+        return stats;
+    }
+}
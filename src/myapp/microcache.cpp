@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "myhttp/enums.hpp"
+#include "myapp/microcache.hpp"
+
+namespace DerkHttpd::App {
+    /// NOTE: Finds `<directive>=<seconds>` in a `Cache-Control` value, e.g `max-age=30`.
+    [[nodiscard]] static auto find_cache_directive_seconds(std::string_view cache_control, std::string_view directive) noexcept -> std::optional<std::chrono::seconds> {
+        const auto directive_pos = cache_control.find(directive);
+
+        if (directive_pos == std::string_view::npos || cache_control.substr(directive_pos + directive.length()).empty() || cache_control[directive_pos + directive.length()] != '=') {
+            return {};
+        }
+
+        const auto value_sv = cache_control.substr(directive_pos + directive.length() + 1);
+        long long seconds_n = 0;
+
+        if (const auto [value_end, parse_err] = std::from_chars(value_sv.data(), value_sv.data() + value_sv.length(), seconds_n); parse_err != std::errc {}) {
+            return {};
+        }
+
+        return std::chrono::seconds {seconds_n};
+    }
+
+    /// NOTE: Header names are case-insensitive, but `Http::HeaderMap` compares them exactly. A shared cache must still key e.g `accept-language: fr` by its value, or one client's variant would be served to another.
+    [[nodiscard]] static auto find_header_value(const Http::HeaderMap& headers, std::string_view name) noexcept -> std::optional<std::string_view> {
+        if (auto header_it = headers.find(name); header_it != headers.end()) {
+            return header_it->second;
+        }
+
+        constexpr auto to_ascii_lower = [](char letter) noexcept -> char {
+            return (letter >= 'A' && letter <= 'Z') ? static_cast<char>(letter - 'A' + 'a') : letter;
+        };
+
+        for (const auto& [header_name, header_value] : headers) {
+            if (std::ranges::equal(header_name, name, {}, to_ascii_lower, to_ascii_lower)) {
+                return header_value;
+            }
+        }
+
+        return {};
+    }
+
+    ResponseMicrocache::ResponseMicrocache(MicrocachePolicy policy)
+    : m_policy {std::move(policy)}, m_entries_mtx {}, m_entries {}, m_fills {} {}
+
+    auto ResponseMicrocache::make_key(const Http::Request& req, const Uri::QueryParams& params) const -> std::string {
+        std::string key {Http::verb_enum_to_name(req.http_verb)};
+        const std::string_view uri_sv {req.uri};
+
+        key += ' ';
+        key += uri_sv.substr(0, uri_sv.find('?'));
+
+        // Sort the query items by name, so reordered query strings share an entry.
+        std::array<Uri::QueryPair, Uri::max_query_params> sorted_params {};
+        const auto params_n = params.size();
+
+        for (std::size_t param_idx = 0; param_idx < params_n; ++param_idx) {
+            sorted_params[param_idx] = params[param_idx];
+        }
+
+        std::stable_sort(sorted_params.begin(), sorted_params.begin() + params_n, [](const auto& lhs, const auto& rhs) noexcept -> bool {
+            return lhs.name < rhs.name;
+        });
+
+        key += '?';
+
+        for (const auto& [param_name, param_value] : std::span {sorted_params.data(), params_n}) {
+            key += param_name;
+            key += '=';
+            std::visit([&key](const auto& value) {
+                if constexpr (std::is_same_v<std::remove_cvref_t<decltype(value)>, int>) {
+                    key += std::to_string(value);
+                } else {
+                    key += value;
+                }
+            }, param_value);
+            key += '&';
+        }
+
+        for (const auto& vary_name : m_policy.vary_headers) {
+            key += '\n';
+            key += vary_name;
+            key += ':';
+
+            if (const auto header_value = find_header_value(req.headers, vary_name); header_value) {
+                key += header_value.value();
+            }
+        }
+
+        return key;
+    }
+
+    auto ResponseMicrocache::deduce_lifetime(const Http::Response& res) const -> std::optional<std::chrono::milliseconds> {
+        // Streamed payloads are consumed by sending them, and file regions may change under the cache.
+        if (res.http_status != Http::Status::http_ok || !(std::holds_alternative<Http::Blob>(res.body) || std::holds_alternative<Http::StaticBytes>(res.body) || std::holds_alternative<Http::SharedBytes>(res.body) || std::holds_alternative<Http::SharedChain>(res.body))) {
+            return {};
+        }
+
+        auto lifetime = m_policy.ttl;
+
+        if (auto cache_control_it = res.headers.find("Cache-Control"); cache_control_it != res.headers.end()) {
+            const std::string_view cache_control {cache_control_it->second};
+
+            if (cache_control.contains("no-store") || cache_control.contains("no-cache") || cache_control.contains("private")) {
+                return {};
+            }
+
+            // A shared cache prefers `s-maxage` over `max-age`, as per RFC 9111 (section 5.2.2.10).
+            if (const auto max_age = find_cache_directive_seconds(cache_control, "s-maxage").or_else([cache_control]() noexcept {
+                return find_cache_directive_seconds(cache_control, "max-age");
+            }); max_age) {
+                lifetime = std::min(lifetime, std::chrono::duration_cast<std::chrono::milliseconds>(max_age.value()));
+            }
+        }
+
+        if (lifetime <= std::chrono::milliseconds::zero()) {
+            return {};
+        }
+
+        return lifetime;
+    }
+
+    void ResponseMicrocache::store(std::string key, const Http::Response& res, std::chrono::milliseconds lifetime) {
+        const auto now = Clock::now();
+
+        if (m_entries.size() >= m_policy.max_entries) {
+            std::erase_if(m_entries, [now](const auto& entry_item) noexcept -> bool {
+                return entry_item.second.expires_at <= now;
+            });
+
+            // NOTE: Every slot is still fresh, so skip storing rather than evicting something equally useful.
+            if (m_entries.size() >= m_policy.max_entries) {
+                return;
+            }
+        }
+
+        m_entries.insert_or_assign(std::move(key), Entry {
+            .response = res,
+            .stored_at = now,
+            .expires_at = now + lifetime,
+        });
+    }
+
+    auto ResponseMicrocache::fetch_or_fill(Http::Request& req, const Uri::QueryParams& params, const Handler& handler) -> Http::Response {
+        // Only GET responses are reusable (HEAD is mapped to GET before dispatch), and a client may ask to skip caches.
+        if (req.http_verb != Http::Verb::http_get) {
+            return handler(req, params);
+        }
+
+        if (auto cache_control_it = req.headers.find("Cache-Control"); cache_control_it != req.headers.end() && (cache_control_it->second.contains("no-cache") || cache_control_it->second.contains("no-store"))) {
+            return handler(req, params);
+        }
+
+        auto key = make_key(req, params);
+        std::promise<std::optional<Http::Response>> fill_promise;
+
+        {
+            std::unique_lock entries_lock {m_entries_mtx};
+
+            // 1. Serve a fresh hit.
+            if (auto entry_it = m_entries.find(key); entry_it != m_entries.end()) {
+                if (const auto now = Clock::now(); now < entry_it->second.expires_at) {
+                    // Copy-assigning keeps the request's memory resource, whereas copy-constructing would fall back to the default heap.
+                    Http::Response res = req.make_response();
+
+                    res = entry_it->second.response;
+
+                    res.headers.insert_or_assign("Age", std::to_string(std::chrono::duration_cast<std::chrono::seconds>(now - entry_it->second.stored_at).count()));
+
+                    return res;
+                }
+
+                m_entries.erase(entry_it);
+            }
+
+            // 2. Wait on an identical in-flight run instead of starting another one.
+            if (auto fill_it = m_fills.find(key); fill_it != m_fills.end()) {
+                auto pending_fill = fill_it->second;
+
+                entries_lock.unlock();
+
+                if (const auto& shared_res = pending_fill.get(); shared_res) {
+                    Http::Response res = req.make_response();
+
+                    res = shared_res.value();
+
+                    return res;
+                }
+
+                return handler(req, params);
+            }
+
+            m_fills.emplace(key, fill_promise.get_future().share());
+        }
+
+        // 3. Lead the fill: run the handler once, then publish its response to the cache and any waiters. Both take header copies on the default heap, so none of them refers to this request's arena, but the payload is shared.
+        Http::Response res = req.make_response();
+
+        try {
+            res = handler(req, params);
+        } catch (...) {
+            {
+                std::lock_guard entries_lock {m_entries_mtx};
+                m_fills.erase(key);
+            }
+
+            fill_promise.set_value(std::nullopt);
+            throw;
+        }
+
+        if (!m_policy.vary_headers.empty()) {
+            std::string vary_value;
+
+            for (const auto& vary_name : m_policy.vary_headers) {
+                vary_value += (vary_value.empty()) ? vary_name : ", " + vary_name;
+            }
+
+            res.headers.insert_or_assign("Vary", std::move(vary_value));
+        }
+
+        const auto lifetime = deduce_lifetime(res);
+
+        // Hand the payload to a shared buffer first, so the entry, the waiters and this response all refer to one copy of it.
+        if (auto generated_blob_p = std::get_if<Http::Blob>(&res.body); lifetime && generated_blob_p) {
+            res.body = Http::SharedBytes {std::move(*generated_blob_p)};
+        }
+
+        {
+            std::lock_guard entries_lock {m_entries_mtx};
+
+            m_fills.erase(key);
+
+            if (lifetime) {
+                store(std::move(key), res, lifetime.value());
+            }
+        }
+
+        fill_promise.set_value((lifetime) ? std::optional<Http::Response> {res} : std::nullopt);
+
+        return res;
+    }
+}
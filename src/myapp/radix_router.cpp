@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "myapp/radix_router.hpp"
+
+namespace DerkHttpd::App {
+    /// NOTE: Captures may only start a segment, e.g `/users/:id` but never `/users:id`.
+    [[nodiscard]] static constexpr auto is_capture_start(std::string_view pattern, std::size_t pos) noexcept -> bool {
+        return (pattern[pos] == ':' || pattern[pos] == '*') && pos > 0 && pattern[pos - 1] == '/';
+    }
+
+    [[nodiscard]] static auto find_static_child(auto& children, char first_char) noexcept {
+        return std::ranges::lower_bound(children, first_char, {}, [](const auto& child_p) noexcept -> char {
+            return child_p->prefix.front();
+        });
+    }
+
+    enum class PatternPartKind : std::uint8_t {
+        static_text,
+        param,
+        wildcard,
+    };
+
+    struct PatternPart {
+        std::string_view text; // the static text, or the capture's name
+        PatternPartKind kind;
+    };
+
+    /// NOTE: Splits a pattern into static text and captures, checking its syntax before the tree is touched.
+    [[nodiscard]] static auto split_pattern(std::string_view pattern) -> std::optional<std::vector<PatternPart>> {
+        if (!pattern.starts_with('/')) {
+            return {};
+        }
+
+        std::vector<PatternPart> parts;
+        std::size_t capture_n = 0;
+        std::size_t pos = 0;
+
+        while (pos < pattern.length()) {
+            // 1. Take static text up to the next capture.
+            auto static_end = pos;
+
+            while (static_end < pattern.length() && !is_capture_start(pattern, static_end)) {
+                ++static_end;
+            }
+
+            if (static_end > pos) {
+                parts.push_back(PatternPart {
+                    .text = pattern.substr(pos, static_end - pos),
+                    .kind = PatternPartKind::static_text,
+                });
+                pos = static_end;
+                continue;
+            }
+
+            // 2. Take a capture, whose wildcard form must end the pattern.
+            const auto is_wildcard = pattern[pos] == '*';
+            const auto name_end = std::min(pattern.find('/', pos), pattern.length());
+            const auto capture_name = pattern.substr(pos + 1, name_end - pos - 1);
+
+            if (capture_name.empty() || (is_wildcard && name_end != pattern.length()) || ++capture_n > max_route_params) {
+                return {};
+            }
+
+            parts.push_back(PatternPart {
+                .text = capture_name,
+                .kind = (is_wildcard) ? PatternPartKind::wildcard : PatternPartKind::param,
+            });
+            pos = name_end;
+        }
+
+        return parts;
+    }
+
+    RadixRouter::RadixRouter()
+    : m_root {} {}
+
+    auto RadixRouter::insert_static(Node& parent, std::string_view text) -> Node& {
+        auto* node_p = &parent;
+
+        while (!text.empty()) {
+            auto& children = node_p->static_children;
+            auto child_it = find_static_child(children, text.front());
+
+            // 1. No sibling shares the first char: the rest becomes one new edge.
+            if (child_it == children.end() || (*child_it)->prefix.front() != text.front()) {
+                auto fresh_node = std::make_unique<Node>();
+
+                fresh_node->prefix = text;
+                node_p = children.insert(child_it, std::move(fresh_node))->get();
+
+                break;
+            }
+
+            // 2. Split the shared edge where the new text diverges, so siblings keep distinct first chars.
+            auto& child_p = *child_it;
+            const auto [prefix_end, text_end] = std::ranges::mismatch(child_p->prefix, text);
+            const auto common_n = static_cast<std::size_t>(prefix_end - child_p->prefix.begin());
+
+            if (common_n < child_p->prefix.length()) {
+                auto split_node = std::make_unique<Node>();
+
+                split_node->prefix = child_p->prefix.substr(0, common_n);
+                child_p->prefix.erase(0, common_n);
+                split_node->static_children.push_back(std::move(child_p));
+                child_p = std::move(split_node);
+            }
+
+            node_p = child_p.get();
+            text.remove_prefix(common_n);
+        }
+
+        return *node_p;
+    }
+
+    auto RadixRouter::find_static(const Node& parent, std::string_view text) noexcept -> const Node* {
+        const auto* node_p = &parent;
+
+        while (!text.empty()) {
+            const auto& children = node_p->static_children;
+            const auto child_it = find_static_child(children, text.front());
+
+            if (child_it == children.end() || !text.starts_with((*child_it)->prefix)) {
+                return nullptr;
+            }
+
+            node_p = child_it->get();
+            text.remove_prefix(node_p->prefix.length());
+        }
+
+        return node_p;
+    }
+
+    auto RadixRouter::match(const Node& node, std::string_view rest, RouteParams& params) noexcept -> const Node* {
+        if (rest.empty()) {
+            if (node.slot) {
+                return &node;
+            }
+        } else {
+            // 1. Static text has the highest priority.
+            if (auto child_it = find_static_child(node.static_children, rest.front()); child_it != node.static_children.end() && rest.starts_with((*child_it)->prefix)) {
+                if (const auto matched_p = match(**child_it, rest.substr((*child_it)->prefix.length()), params); matched_p) {
+                    return matched_p;
+                }
+            }
+
+            // 2. Then a capture of the next non-empty segment.
+            if (const auto segment_n = std::min(rest.find('/'), rest.length()); node.param_child && segment_n > 0) {
+                if (params.push(node.param_child->capture_name, rest.substr(0, segment_n))) {
+                    if (const auto matched_p = match(*node.param_child, rest.substr(segment_n), params); matched_p) {
+                        return matched_p;
+                    }
+
+                    params.pop();
+                }
+            }
+        }
+
+        // 3. Finally, a wildcard takes whatever is left, even nothing.
+        if (node.wildcard_child && params.push(node.wildcard_child->capture_name, rest)) {
+            return node.wildcard_child.get();
+        }
+
+        return nullptr;
+    }
+
+    auto RadixRouter::insert(std::string_view pattern, std::size_t slot) -> std::optional<std::size_t> {
+        const auto parts = split_pattern(pattern);
+
+        if (!parts) {
+            return {};
+        }
+
+        // 1. Check capture names along the existing branch first, so a clash leaves no half-built nodes behind. Once the pattern leaves the existing edges, everything below is new and cannot clash.
+        for (const auto* existing_p = &m_root; const auto& [part_text, part_kind] : parts.value()) {
+            if (!existing_p) {
+                break;
+            }
+
+            if (part_kind == PatternPartKind::static_text) {
+                existing_p = find_static(*existing_p, part_text);
+                continue;
+            }
+
+            const auto& capture_p = (part_kind == PatternPartKind::wildcard) ? existing_p->wildcard_child : existing_p->param_child;
+
+            if (capture_p && capture_p->capture_name != part_text) {
+                return {};
+            }
+
+            existing_p = capture_p.get();
+        }
+
+        // 2. Build the branch, sharing a capture node with any other pattern's capture at the same position.
+        auto* node_p = &m_root;
+
+        for (const auto& [part_text, part_kind] : parts.value()) {
+            if (part_kind == PatternPartKind::static_text) {
+                node_p = &insert_static(*node_p, part_text);
+                continue;
+            }
+
+            auto& capture_p = (part_kind == PatternPartKind::wildcard) ? node_p->wildcard_child : node_p->param_child;
+
+            if (!capture_p) {
+                capture_p = std::make_unique<Node>();
+                capture_p->capture_name = part_text;
+            }
+
+            node_p = capture_p.get();
+        }
+
+        if (!node_p->slot) {
+            node_p->slot = slot;
+        }
+
+        return node_p->slot;
+    }
+
+    auto RadixRouter::find(std::string_view path, RouteParams& params) const noexcept -> std::optional<std::size_t> {
+        if (const auto matched_p = match(m_root, path, params); matched_p) {
+            return matched_p->slot;
+        }
+
+        return {};
+    }
+}
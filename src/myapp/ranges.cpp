@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <utility>
+
+#include "myapp/ranges.hpp"
+
+namespace DerkHttpd::App {
+    constexpr std::string_view range_unit_prefix = "bytes=";
+    constexpr std::string_view range_spacing_chars = " \t";
+
+    [[nodiscard]] static auto parse_range_bound(std::string_view sv) noexcept -> std::optional<std::uintmax_t> {
+        std::uintmax_t bound = 0;
+
+        if (sv.empty()) {
+            return {};
+        }
+
+        if (const auto [parse_end, parse_err] = std::from_chars(sv.data(), sv.data() + sv.length(), bound); parse_err != std::errc {} || parse_end != sv.data() + sv.length()) {
+            return {};
+        }
+
+        return bound;
+    }
+
+    auto parse_byte_ranges(std::string_view range_value, std::uintmax_t full_size) -> RangeSet {
+        RangeSet result {
+            .ranges = {},
+            .full_size = full_size,
+            .verdict = RangeVerdict::ignored,
+        };
+
+        if (!range_value.starts_with(range_unit_prefix)) {
+            return result;
+        }
+
+        range_value.remove_prefix(range_unit_prefix.length());
+
+        std::size_t spec_count = 0;
+
+        // 1. Check each `first-last`, `first-` or `-suffix` spec, clamping it to the representation. Any syntax error voids the whole header.
+        while (!range_value.empty()) {
+            const auto comma_pos = range_value.find(',');
+            auto spec_sv = range_value.substr(0, comma_pos);
+            range_value = (comma_pos == std::string_view::npos) ? std::string_view {} : range_value.substr(comma_pos + 1);
+
+            if (const auto spec_begin = spec_sv.find_first_not_of(range_spacing_chars); spec_begin == std::string_view::npos) {
+                continue;
+            } else {
+                spec_sv = spec_sv.substr(spec_begin, spec_sv.find_last_not_of(range_spacing_chars) - spec_begin + 1);
+            }
+
+            if (++spec_count > max_byte_ranges) {
+                result.ranges.clear();
+                return result;
+            }
+
+            const auto dash_pos = spec_sv.find('-');
+
+            if (dash_pos == std::string_view::npos) {
+                result.ranges.clear();
+                return result;
+            }
+
+            const auto first_sv = spec_sv.substr(0, dash_pos);
+            const auto last_sv = spec_sv.substr(dash_pos + 1);
+
+            if (first_sv.empty()) {
+                // Suffix spec: the final N bytes.
+                const auto suffix_n = parse_range_bound(last_sv);
+
+                if (!suffix_n) {
+                    result.ranges.clear();
+                    return result;
+                }
+
+                if (suffix_n.value() > 0 && full_size > 0) {
+                    result.ranges.push_back(ByteRange {
+                        .first = full_size - std::min(suffix_n.value(), full_size),
+                        .last = full_size - 1,
+                    });
+                }
+
+                continue;
+            }
+
+            const auto first_pos = parse_range_bound(first_sv);
+            const auto last_pos = (last_sv.empty()) ? std::optional<std::uintmax_t> {full_size - 1} : parse_range_bound(last_sv);
+
+            if (!first_pos || !last_pos || (!last_sv.empty() && last_pos.value() < first_pos.value())) {
+                result.ranges.clear();
+                return result;
+            }
+
+            if (first_pos.value() < full_size) {
+                result.ranges.push_back(ByteRange {
+                    .first = first_pos.value(),
+                    .last = std::min(last_pos.value(), full_size - 1),
+                });
+            }
+        }
+
+        if (spec_count == 0) {
+            return result;
+        }
+
+        if (result.ranges.empty()) {
+            result.verdict = RangeVerdict::unsatisfiable;
+            return result;
+        }
+
+        // 2. Coalesce overlapping or adjacent ranges, so overlapping specs cannot make the server send the same bytes repeatedly.
+        std::ranges::sort(result.ranges, {}, &ByteRange::first);
+
+        std::vector<ByteRange> coalesced;
+
+        for (const auto& range : result.ranges) {
+            if (!coalesced.empty() && range.first <= coalesced.back().last + 1) {
+                coalesced.back().last = std::max(coalesced.back().last, range.last);
+            } else {
+                coalesced.push_back(range);
+            }
+        }
+
+        result.ranges = std::move(coalesced);
+        result.verdict = RangeVerdict::satisfiable;
+
+        return result;
+    }
+}
@@ -1,6 +1,7 @@
 #include <chrono>
 #include <format>
 #include <iomanip>
+#include <random>
 #include <sstream>
 
 #include "myapp/response_helpers.hpp"
@@ -12,9 +13,13 @@ namespace DerkHttpd::App {
         return std::format("{0:%a}, {0:%e} {0:%b} {0:%Y} {0:%H}:{0:%M}:{0:%S} UTC", now_time);
     }
 
-    auto parse_date_string(const std::string& date) -> std::chrono::seconds {
+    auto get_date_string(std::filesystem::file_time_type file_time) -> std::string {
+        return std::format("{0:%a}, {0:%e} {0:%b} {0:%Y} {0:%H}:{0:%M}:{0:%S} UTC", std::chrono::time_point_cast<std::chrono::seconds>(file_time));
+    }
+
+    auto parse_date_string(std::string_view date) -> std::chrono::seconds {
         // 1. Parse formatted GMT / UTC date from the client.
-        std::istringstream str_reader {date};
+        std::istringstream str_reader {std::string {date}};
         std::tm date_tm = {};
 
         str_reader >> std::get_time(&date_tm, "%a, %e %b %Y %H:%M:%S GMT");
@@ -31,4 +36,136 @@ namespace DerkHttpd::App {
             std::chrono::system_clock::now().time_since_epoch()
         );
     }
-}
\ No newline at end of file
+
+
+    /// NOTE: A fresh random boundary per response, so no file can be crafted to contain it and break the `multipart/byteranges` framing. Each thread seeds its own engine once, so only the first multipart response on a thread asks the OS for entropy.
+    [[nodiscard]] static auto make_multipart_boundary() -> std::string {
+        thread_local std::mt19937_64 boundary_engine {std::random_device {}()};
+
+        const auto high_bits = boundary_engine();
+        const auto low_bits = boundary_engine();
+
+        return std::format("derkhttpd-{:016x}{:016x}", high_bits, low_bits);
+    }
+
+    namespace ResponseUtils {
+        void response_put_allowed_verbs(Http::Response& res, Http::Verb verb, Http::VerbSet allowed) {
+            if (allowed.contains(Http::Verb::http_get)) {
+                allowed.add(Http::Verb::http_head);
+            }
+
+            allowed.add(Http::Verb::http_options);
+
+            // A 204 must not carry any payload headers, so only the `Allow` list is set.
+            if (verb == Http::Verb::http_options) {
+                res.body = Http::Blob {};
+                res.modify_timestamp = get_epoch_seconds_now();
+                res.http_status = Http::Status::http_no_content;
+            } else {
+                EmptyReply bad_verb_err {Http::Status::http_method_not_allowed};
+                response_put_all(res, bad_verb_err);
+            }
+
+            res.headers.insert_or_assign("Allow", Http::verb_set_to_allow_value(allowed));
+        }
+
+        void response_put_ranges(Http::Response& res, const RangeSet& range_set) {
+            const auto full_size = range_set.full_size;
+
+            // 1. Nothing overlaps the file: only report its real size.
+            if (range_set.verdict == RangeVerdict::unsatisfiable) {
+                res.body = Http::Blob {};
+                res.headers.insert_or_assign("Content-Length", "0");
+                res.headers.emplace("Content-Range", std::format("bytes */{}", full_size));
+                res.http_status = Http::Status::http_range_not_satisfiable;
+
+                return;
+            }
+
+            // NOTE: On-disk payloads are read by position, while cached and embedded ones are sliced in place, so no unused prefix is ever read or copied.
+            const auto extract_part = [&res](const ByteRange& range) -> std::optional<Http::SharedBytes> {
+                const auto part_length = range.last - range.first + 1;
+
+                if (const auto region_p = std::get_if<Http::FileRegion>(&res.body); region_p) {
+                    return read_file_region(Http::FileRegion {
+                        .path = region_p->path,
+                        .offset = region_p->offset + range.first,
+                        .length = part_length,
+                    }).transform([](Http::Blob&& part_blob) {
+                        return Http::SharedBytes {std::move(part_blob)};
+                    });
+                }
+
+                if (const auto shared_bytes_p = std::get_if<Http::SharedBytes>(&res.body); shared_bytes_p) {
+                    return shared_bytes_p->slice(range.first, part_length);
+                }
+
+                if (const auto static_bytes_p = std::get_if<Http::StaticBytes>(&res.body); static_bytes_p) {
+                    return Http::SharedBytes::from_static(static_bytes_p->bytes.substr(range.first, part_length));
+                }
+
+                const auto& full_blob = std::get<Http::Blob>(res.body);
+
+                return Http::SharedBytes {Http::Blob (full_blob.begin() + range.first, full_blob.begin() + range.first + part_length)};
+            };
+
+            // 2. A single range is just a narrower region for `sendfile`, or a slice of the cached or embedded bytes.
+            if (range_set.ranges.size() == 1) {
+                const auto [range_first, range_last] = range_set.ranges.front();
+                const auto range_length = range_last - range_first + 1;
+
+                if (auto region_p = std::get_if<Http::FileRegion>(&res.body); region_p) {
+                    region_p->offset += range_first;
+                    region_p->length = range_length;
+                } else if (auto static_bytes_p = std::get_if<Http::StaticBytes>(&res.body); static_bytes_p) {
+                    // The precompressed variants describe the whole asset, so they no longer apply.
+                    *static_bytes_p = Http::StaticBytes {
+                        .bytes = static_bytes_p->bytes.substr(range_first, range_length),
+                        .coded_variants = {},
+                    };
+                } else {
+                    res.body = extract_part(range_set.ranges.front()).value();
+                }
+
+                res.headers.insert_or_assign("Content-Length", std::to_string(range_length));
+                res.headers.emplace("Content-Range", std::format("bytes {}-{}/{}", range_first, range_last, full_size));
+                res.http_status = Http::Status::http_partial_content;
+
+                return;
+            }
+
+            // 3. Several ranges become `multipart/byteranges` parts, gathered between their part headers without joining them into one buffer.
+            const auto boundary = make_multipart_boundary();
+            // Views the header in place, as the headers only change once every part is built.
+            const auto content_type_it = res.headers.find("Content-Type");
+            const std::string_view part_mime = (content_type_it != res.headers.end()) ? std::string_view {content_type_it->second} : "application/octet-stream";
+            Http::SharedChain multipart_body;
+            std::size_t multipart_length = 0;
+
+            multipart_body.reserve(range_set.ranges.size() * 2 + 1);
+
+            for (const auto& range : range_set.ranges) {
+                auto part_bytes = extract_part(range);
+
+                if (!part_bytes) {
+                    res.body = Http::Blob {};
+                    res.headers.clear();
+                    res.headers.emplace("Content-Length", "0");
+                    res.http_status = Http::Status::http_server_error;
+
+                    return;
+                }
+
+                multipart_length += multipart_body.emplace_back(std::format("\r\n--{}\r\nContent-Type: {}\r\nContent-Range: bytes {}-{}/{}\r\n\r\n", boundary, part_mime, range.first, range.last, full_size)).size();
+                multipart_length += multipart_body.emplace_back(std::move(part_bytes.value())).size();
+            }
+
+            multipart_length += multipart_body.emplace_back(std::format("\r\n--{}--\r\n", boundary)).size();
+
+            res.headers.insert_or_assign("Content-Length", std::to_string(multipart_length));
+            res.headers.insert_or_assign("Content-Type", std::format("multipart/byteranges; boundary={}", boundary));
+            res.body = std::move(multipart_body);
+            res.http_status = Http::Status::http_partial_content;
+        }
+    }
+}
@@ -2,53 +2,181 @@
 #include "myapp/response_helpers.hpp"
 
 namespace DerkHttpd::App {
-    const auto dud_fallback_handler = []([[maybe_unused]] Http::Request req, const std::map<std::string, Uri::QueryValue>& params) -> Http::Response {
-        Http::Response res;
+    const auto dud_fallback_handler = [](Http::Request& req, [[maybe_unused]] const Uri::QueryParams& params) -> Http::Response {
+        Http::Response res = req.make_response();
         
         App::StringReply generic_error_msg {"No matching middleware found.", "text/plain"};
-        App::ResponseUtils::response_put_all(res, generic_error_msg, Http::Status::http_not_found);
+        App::ResponseUtils::response_put_all(res, std::move(generic_error_msg), Http::Status::http_not_found);
 
         return res;
     };
 
 
-    auto compare_host_str(std::string_view incoming, std::string_view host_name, std::string_view host_port) noexcept -> bool {
-        // Case 1: If the host has no ':', it's just a special host name.
-        if (!incoming.contains(':')) {
-            return incoming == host_name;
+    Routes::Routes()
+    : m_fallback {dud_fallback_handler}, m_static_dispatch {nullptr}, m_router {}, m_handlers {}, m_mounts {}, m_filters {} {}
+
+    auto Routes::bind_handler(Http::VerbSet verbs, const std::string& route_pattern, const ParamMiddleware& handler_box) -> bool {
+        const auto handler_slot = m_router.insert(route_pattern, m_handlers.size());
+
+        if (!handler_slot) {
+            return false;
+        }
+
+        if (handler_slot.value() == m_handlers.size()) {
+            m_handlers.emplace_back();
+        }
+
+        auto& verb_handlers = m_handlers[handler_slot.value()];
+
+        if (allowed_verbs_of(verb_handlers).overlaps(verbs)) {
+            return false;
+        }
+
+        for (std::size_t verb_idx = 0; verb_idx < verb_handlers.size(); ++verb_idx) {
+            if (verbs.contains(static_cast<Http::Verb>(verb_idx))) {
+                verb_handlers[verb_idx] = handler_box;
+            }
         }
 
-        // Case 2 (general): check both hostname and port by the full syntax:
-        // https://developer.mozilla.org/en-US/docs/Web/HTTP/Reference/Headers/Host#syntax
-        const auto colon_pos = incoming.find_last_of(':');
-        std::string_view incoming_host_name = incoming.substr(0, colon_pos);
-        std::string_view incoming_port_name = incoming.substr(colon_pos + 1);
+        return true;
+    }
+
+    auto Routes::allowed_verbs_of(const VerbHandlers& verb_handlers) noexcept -> Http::VerbSet {
+        Http::VerbSet allowed;
 
-        return incoming_host_name == host_name && incoming_port_name == host_port;
+        for (std::size_t verb_idx = 0; verb_idx < verb_handlers.size(); ++verb_idx) {
+            if (verb_handlers[verb_idx]) {
+                allowed.add(static_cast<Http::Verb>(verb_idx));
+            }
+        }
+
+        return allowed;
     }
 
+    auto Routes::set_handler(Http::Verb verb, const std::string& route_pattern, Middleware handler_box) -> bool {
+        return set_handler(verb, route_pattern, ParamMiddleware {[plain_handler = std::move(handler_box)](Http::Request& req, const Uri::QueryParams& params, [[maybe_unused]] const RouteParams& route_params) -> Http::Response {
+            return plain_handler(req, params);
+        }});
+    }
 
-    auto Routes::check_host_header(const Http::Request& req) const -> bool {
-        if (!req.headers.contains("Host") && req.http_schema == Http::Schema::http_1_1) {
+    auto Routes::set_handler(Http::Verb verb, const std::string& route_pattern, ParamMiddleware handler_box) -> bool {
+        if (verb == Http::Verb::http_head) {
             return false;
         }
 
-        return compare_host_str(
-            req.headers.at("Host"),
-            m_host_name,
-            m_host_port
-        );
+        return bind_handler(Http::VerbSet {verb}, route_pattern, handler_box);
+    }
+
+    auto Routes::set_handler(const std::string& route_path, Middleware handler_box) -> bool {
+        return set_handler(route_path, ParamMiddleware {[plain_handler = std::move(handler_box)](Http::Request& req, const Uri::QueryParams& params, [[maybe_unused]] const RouteParams& route_params) -> Http::Response {
+            return plain_handler(req, params);
+        }});
+    }
+
+    auto Routes::set_handler(const std::string& route_pattern, ParamMiddleware handler_box) -> bool {
+        return bind_handler(any_route_verbs, route_pattern, handler_box);
     }
 
-    Routes::Routes(std::string_view server_host_name, std::string_view server_host_port)
-    : m_fallback {dud_fallback_handler}, m_handlers {}, m_host_name {server_host_name}, m_host_port {server_host_port} {}
+    auto Routes::set_handler(const std::string& route_path, Middleware handler_box, MicrocachePolicy cache_policy) -> bool {
+        auto route_cache = std::make_shared<ResponseMicrocache>(std::move(cache_policy));
+
+        return set_handler(Http::Verb::http_get, route_path, Middleware {[route_cache, inner_handler = std::move(handler_box)](Http::Request& req, const Uri::QueryParams& params) -> Http::Response {
+            return route_cache->fetch_or_fill(req, params, inner_handler);
+        }});
+    }
+
+    auto Routes::route_request(Http::Request& req) const -> Http::Response {
+        // 1a. `OPTIONS *` asks about the whole server rather than a resource.
+        if (req.http_verb == Http::Verb::http_options && req.uri == "*") {
+            Http::Response res = req.make_response();
+            ResponseUtils::response_put_allowed_verbs(res, req.http_verb, any_route_verbs);
+
+            return res;
+        }
+
+        // 1b. Validate request syntax & semantics to prevent false-positive responses.
+        auto req_uri = Uri::parse_simple_uri(req.uri, req.resource());
+
+        if (!req_uri) {
+            // Protocol syntax error: the URI is malformed.
+            Http::Response res = req.make_response();
+            App::EmptyReply uri_syntax_error {Http::Status::http_bad_request};
 
-    auto Routes::set_handler(const std::string& route_path, Middleware handler_box) noexcept -> bool {
-        if (m_handlers.contains(route_path)) {
+            App::ResponseUtils::response_put_all(res, uri_syntax_error);
+
+            return res;
+        }
+
+        const auto& uri_obj = req_uri.value();
+
+        // 2a. Try the build-time routes first, as their lookup is one perfect-hash probe.
+        if (m_static_dispatch) {
+            if (auto static_res = m_static_dispatch(uri_obj.path(), req, uri_obj.params()); static_res) {
+                return std::move(static_res.value());
+            } else if (!static_res.error().empty()) {
+                Http::Response res = req.make_response();
+                ResponseUtils::response_put_allowed_verbs(res, req.http_verb, static_res.error());
+
+                return res;
+            }
+        }
+
+        // 2b. Try finding the matching route by URI path, then its handler by verb. The captures view `uri_obj`, which outlives the handler call.
+        if (RouteParams route_params; auto handler_slot = m_router.find(uri_obj.path(), route_params)) {
+            const auto& verb_handlers = m_handlers[handler_slot.value()];
+
+            if (const auto& handler = verb_handlers[static_cast<std::size_t>(req.http_verb)]; handler) {
+                return handler(req, uri_obj.params(), route_params);
+            }
+
+            Http::Response res = req.make_response();
+            ResponseUtils::response_put_allowed_verbs(res, req.http_verb, allowed_verbs_of(verb_handlers));
+
+            return res;
+        }
+
+        // 3. Try serving a static file from the most specific mounted directory.
+        if (auto mount_it = std::find_if(m_mounts.begin(), m_mounts.end(), [&uri_obj](const auto& mount_p) -> bool {
+            return mount_p->matches(uri_obj.path());
+        }); mount_it != m_mounts.end()) {
+            return (*mount_it)->serve(req, uri_obj.path());
+        }
+
+        // 4. Call the default error handler on an unset middleware route. It gives a simple 404 response for now.
+        return m_fallback(req, {});
+    }
+
+    auto Routes::route_request_thunk(const void* routes_p, Http::Request& req) -> Http::Response {
+        return static_cast<const Routes*>(routes_p)->route_request(req);
+    }
+
+    void Routes::add_filter(FilterBox filter) {
+        m_filters.push_back(std::move(filter));
+    }
+
+    auto Routes::dispatch_handler(Http::Request& req) const noexcept -> Http::Response {
+        return FilterNext {m_filters, &route_request_thunk, this}(req);
+    }
+
+    auto Routes::mount_directory(const std::string& url_prefix, const std::filesystem::path& root_dir) -> bool {
+        std::error_code fs_err;
+        auto canonical_root = std::filesystem::canonical(root_dir, fs_err);
+
+        if (fs_err || !std::filesystem::is_directory(canonical_root, fs_err) || !url_prefix.starts_with('/')) {
+            return false;
+        }
+
+        if (std::ranges::any_of(m_mounts, [&url_prefix](const auto& mount_p) noexcept -> bool {
+            return mount_p->get_url_prefix() == url_prefix;
+        })) {
             return false;
         }
 
-        m_handlers.emplace(route_path, handler_box);
+        auto mount_pos = std::ranges::find_if(m_mounts, [&url_prefix](const auto& mount_p) noexcept -> bool {
+            return mount_p->get_url_prefix().length() < url_prefix.length();
+        });
+
+        m_mounts.insert(mount_pos, std::make_shared<StaticMount>(url_prefix, std::move(canonical_root)));
 
         return true;
     }
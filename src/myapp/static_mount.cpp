@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <ranges>
+#include <utility>
+
+#include "myapp/etags.hpp"
+#include "myapp/file_cache.hpp"
+#include "myapp/mime_types.hpp"
+#include "myapp/response_helpers.hpp"
+#include "myapp/static_mount.hpp"
+
+namespace DerkHttpd::App {
+    StaticMount::StaticMount(std::string url_prefix, std::filesystem::path canonical_root) noexcept
+    : m_url_prefix {std::move(url_prefix)}, m_root_dir {std::move(canonical_root)}, m_blocks_mtx {}, m_blocks {} {}
+
+    void StaticMount::put_headers(Http::HeaderMap& headers, const std::filesystem::path& file_path, const FileIdentity& identity, std::string_view mime) const {
+        std::lock_guard blocks_lock {m_blocks_mtx};
+        auto& block = m_blocks[file_path.string()];
+
+        // NOTE: A fresh slot has a zeroed identity, which no real file matches, so it gets built here too.
+        if (block.identity != identity || block.headers.empty()) {
+            block.identity = identity;
+            block.headers.clear();
+            block.headers.emplace("Accept-Ranges", "bytes");
+            block.headers.emplace("Content-Length", std::to_string(identity.size));
+            block.headers.emplace("Content-Type", mime);
+            block.headers.emplace("ETag", make_entity_tag(identity));
+            block.headers.emplace("Last-Modified", get_date_string(identity.modify_time));
+        }
+
+        headers = block.headers;
+    }
+
+    auto StaticMount::get_url_prefix() const noexcept -> std::string_view {
+        return m_url_prefix;
+    }
+
+    auto StaticMount::matches(std::string_view uri_path) const noexcept -> bool {
+        if (!uri_path.starts_with(m_url_prefix)) {
+            return false;
+        }
+
+        return m_url_prefix.ends_with('/') || uri_path.length() == m_url_prefix.length() || uri_path[m_url_prefix.length()] == '/';
+    }
+
+    auto StaticMount::resolve(std::string_view uri_path) const -> std::optional<std::filesystem::path> {
+        auto rel_path_sv = uri_path.substr(m_url_prefix.length());
+
+        while (rel_path_sv.starts_with('/')) {
+            rel_path_sv.remove_prefix(1);
+        }
+
+        // 1. Reject traversal segments and hidden files lexically, before touching the file system.
+        for (const auto segment : std::views::split(rel_path_sv, '/')) {
+            if (std::string_view {segment.begin(), segment.end()}.starts_with('.')) {
+                return {};
+            }
+        }
+
+        if (rel_path_sv.contains('\0') || rel_path_sv.contains('\\')) {
+            return {};
+        }
+
+        auto candidate = m_root_dir / rel_path_sv;
+        std::error_code fs_err;
+
+        if (std::filesystem::is_directory(candidate, fs_err)) {
+            candidate /= index_file_name;
+        }
+
+        // 2. Resolve symlinks, then check that the real path still lies under the root.
+        auto real_path = std::filesystem::canonical(candidate, fs_err);
+
+        if (fs_err || !std::filesystem::is_regular_file(real_path, fs_err)) {
+            return {};
+        }
+
+        if (const auto [root_end, path_end] = std::ranges::mismatch(m_root_dir, real_path); root_end != m_root_dir.end()) {
+            return {};
+        }
+
+        return real_path;
+    }
+
+    auto StaticMount::serve(const Http::Request& req, std::string_view uri_path) const -> Http::Response {
+        Http::Response res = req.make_response();
+
+        if (req.http_verb != Http::Verb::http_get) {
+            ResponseUtils::response_put_allowed_verbs(res, req.http_verb, Http::VerbSet {Http::Verb::http_get});
+
+            return res;
+        }
+
+        const auto file_path = resolve(uri_path);
+
+        if (!file_path) {
+            EmptyReply missing_err {Http::Status::http_not_found};
+            ResponseUtils::response_put_all(res, missing_err);
+
+            return res;
+        }
+
+        const auto mime = lookup_mime_type(file_path->extension().native());
+        const auto cached_file = FileCache::instance().fetch(file_path.value(), mime);
+        const auto file_identity = (cached_file) ? std::optional<FileIdentity> {cached_file->identity} : stat_file_identity(file_path.value());
+
+        if (!file_identity) {
+            EmptyReply missing_err {Http::Status::http_not_found};
+            ResponseUtils::response_put_all(res, missing_err);
+
+            return res;
+        }
+
+        put_headers(res.headers, file_path.value(), file_identity.value(), mime);
+
+        if (cached_file) {
+            res.body = cached_file->bytes;
+        } else {
+            res.body = Http::FileRegion {
+                .path = file_path.value(),
+                .offset = 0,
+                .length = file_identity->size,
+            };
+        }
+
+        res.modify_timestamp = file_identity->modify_time;
+        res.origin = file_path.value();
+        res.http_status = Http::Status::http_ok;
+
+        return res;
+    }
+}
@@ -0,0 +1,166 @@
+#include "myapp/response_helpers.hpp"
+#include "myapp/vhosts.hpp"
+
+namespace DerkHttpd::App {
+    [[nodiscard]] static constexpr auto is_host_char(char c, bool in_ip_literal) noexcept -> bool {
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || (in_ip_literal && (c == ':' || c == '[' || c == ']'));
+    }
+
+    auto normalize_host(std::string_view raw_host, HostBuffer& out) noexcept -> std::optional<std::string_view> {
+        auto host = raw_host;
+
+        // 1. Drop the port, which follows the closing bracket of an IPv6 literal or else the only colon.
+        if (host.starts_with('[')) {
+            const auto bracket_pos = host.find(']');
+
+            if (bracket_pos == std::string_view::npos || (bracket_pos + 1 < host.length() && host[bracket_pos + 1] != ':')) {
+                return {};
+            }
+
+            host = host.substr(0, bracket_pos + 1);
+        } else if (const auto colon_pos = host.find(':'); colon_pos != std::string_view::npos) {
+            if (host.find(':', colon_pos + 1) != std::string_view::npos) {
+                return {};
+            }
+
+            host = host.substr(0, colon_pos);
+        }
+
+        // 2. A fully qualified name may end with a dot, which names the same host.
+        if (host.ends_with('.')) {
+            host.remove_suffix(1);
+        }
+
+        if (host.empty() || host.length() > out.size()) {
+            return {};
+        }
+
+        // 3. Host names are case-insensitive, so only lowercase text reaches the site tables.
+        const auto in_ip_literal = host.starts_with('[');
+
+        for (std::size_t char_idx = 0; char_idx < host.length(); ++char_idx) {
+            auto c = host[char_idx];
+
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+
+            if (!is_host_char(c, in_ip_literal)) {
+                return {};
+            }
+
+            out[char_idx] = c;
+        }
+
+        return std::string_view {out.data(), host.length()};
+    }
+
+    auto VirtualHosts::find_site(std::string_view host) const noexcept -> const Routes* {
+        if (auto exact_it = m_exact_sites.find(host); exact_it != m_exact_sites.end()) {
+            return exact_it->second;
+        }
+
+        // Try the longest suffix first, so `*.api.example.com` wins over `*.example.com`.
+        for (auto dot_pos = host.find('.'); dot_pos != std::string_view::npos; dot_pos = host.find('.', dot_pos + 1)) {
+            if (auto wildcard_it = m_wildcard_sites.find(host.substr(dot_pos + 1)); wildcard_it != m_wildcard_sites.end()) {
+                return wildcard_it->second;
+            }
+        }
+
+        return m_default_site;
+    }
+
+    auto VirtualHosts::bind_site(int fd, std::string_view raw_host) const -> const Routes* {
+        const auto binding_p = (fd >= 0 && static_cast<std::size_t>(fd) < m_bindings.size()) ? &m_bindings[fd] : nullptr;
+
+        // 1. Clients resend the same `Host` bytes on every request, so a repeat skips normalizing as well as the table lookups.
+        if (binding_p && binding_p->site && binding_p->raw_host == raw_host) {
+            return binding_p->site;
+        }
+
+        HostBuffer host_buffer;
+        const auto host = normalize_host(raw_host, host_buffer);
+
+        if (!host) {
+            return nullptr;
+        }
+
+        // 2. Otherwise, look the site up and rebind. The site tables are fixed once serving starts, so a binding left by a closed connection is still right for a new one reusing its fd.
+        const auto site = find_site(host.value());
+
+        if (binding_p) {
+            binding_p->raw_host.assign(raw_host);
+            binding_p->site = site;
+        }
+
+        return site;
+    }
+
+    VirtualHosts::VirtualHosts(std::size_t binding_slots)
+    : m_sites {}, m_exact_sites {}, m_wildcard_sites {}, m_default_site {nullptr}, m_bindings (binding_slots) {}
+
+    auto VirtualHosts::add_host(std::string_view host_pattern) -> Routes* {
+        const auto is_wildcard = host_pattern.starts_with("*.");
+        HostBuffer key_buffer;
+        const auto host_key = normalize_host((is_wildcard) ? host_pattern.substr(2) : host_pattern, key_buffer);
+
+        if (!host_key) {
+            return nullptr;
+        }
+
+        auto& site_table = (is_wildcard) ? m_wildcard_sites : m_exact_sites;
+
+        if (auto site_it = site_table.find(host_key.value()); site_it != site_table.end()) {
+            return site_it->second;
+        }
+
+        auto& site_p = m_sites.emplace_back(std::make_unique<Routes>());
+
+        site_table.emplace(std::string {host_key.value()}, site_p.get());
+
+        return site_p.get();
+    }
+
+    auto VirtualHosts::set_default_host(std::string_view host_pattern) -> bool {
+        const auto is_wildcard = host_pattern.starts_with("*.");
+        HostBuffer key_buffer;
+        const auto host_key = normalize_host((is_wildcard) ? host_pattern.substr(2) : host_pattern, key_buffer);
+
+        if (!host_key) {
+            return false;
+        }
+
+        const auto& site_table = (is_wildcard) ? m_wildcard_sites : m_exact_sites;
+
+        if (auto site_it = site_table.find(host_key.value()); site_it != site_table.end()) {
+            m_default_site = site_it->second;
+            return true;
+        }
+
+        return false;
+    }
+
+    auto VirtualHosts::dispatch_handler(int fd, Http::Request& req) const -> Http::Response {
+        const Routes* site = nullptr;
+
+        // 1. HTTP/1.1 requests must name their host, while HTTP/1.0 ones may leave it to the default site.
+        if (auto host_it = req.headers.find("Host"); host_it != req.headers.end()) {
+            site = bind_site(fd, host_it->second);
+        } else if (req.http_schema != Http::Schema::http_1_1) {
+            site = m_default_site;
+        }
+
+        if (!site) {
+            // Protocol errors: the `Host` header is missing, malformed or names no site here.
+            Http::Response res = req.make_response();
+            EmptyReply host_error {Http::Status::http_bad_request};
+
+            ResponseUtils::response_put_all(res, host_error);
+
+            return res;
+        }
+
+        // 2. The site runs its own filters and routes.
+        return site->dispatch_handler(req);
+    }
+}
@@ -1,4 +1,5 @@
 #include <array>
+#include <string>
 #include <string_view>
 
 #include "myhttp/enums.hpp"
@@ -10,10 +11,13 @@ namespace DerkHttpd::Http {
         "POST",
         "PUT",
         "DELETE",
+        "OPTIONS",
     };
 
     constexpr std::array<std::string_view, scoped_enum_len<Status>()> status_names {
         "OK",
+        "No Content",
+        "Partial Content",
         "Not Modified",
         "Permanent Redirect",
         "Bad Request",
@@ -21,14 +25,19 @@ namespace DerkHttpd::Http {
         "Method Not Allowed",
         "Not Acceptable",
         "Length Required",
+        "Precondition Failed",
         "Content Too Large",
+        "Range Not Satisfiable",
         "Request Header Fields Too Large",
         "Internal Server Error",
         "Not Implemented",
+        "Service Unavailable",
     };
 
     constexpr std::array<std::string_view, scoped_enum_len<Status>()> status_code_names {
         "200",
+        "204",
+        "206",
         "304",
         "308",
         "400",
@@ -38,9 +47,11 @@ namespace DerkHttpd::Http {
         "411",
         "412",
         "413",
+        "416",
         "431",
         "500",
         "501",
+        "503",
     };
 
     constexpr std::array<std::string_view, scoped_enum_len<Schema>()> schema_names {
@@ -49,6 +60,13 @@ namespace DerkHttpd::Http {
         "HTTP/0.0",
     };
 
+    constexpr std::array<std::string_view, scoped_enum_len<ContentCoding>()> coding_names {
+        "identity",
+        "deflate",
+        "gzip",
+        "zstd",
+    };
+
     auto verb_enum_to_name(Verb v) noexcept -> std::string_view {
         return verb_names[static_cast<std::size_t>(v)];
     }
@@ -64,4 +82,24 @@ namespace DerkHttpd::Http {
     auto schema_enum_to_name(Schema schema) noexcept -> std::string_view {
         return schema_names[static_cast<std::size_t>(schema)];
     }
-}
\ No newline at end of file
+
+    auto coding_enum_to_name(ContentCoding coding) noexcept -> std::string_view {
+        return coding_names[static_cast<std::size_t>(coding)];
+    }
+
+    auto verb_set_to_allow_value(VerbSet verbs) -> std::string {
+        std::string allow_value;
+
+        for (std::size_t verb_idx = 0; verb_idx < scoped_enum_len<Verb>(); ++verb_idx) {
+            if (const auto verb = static_cast<Verb>(verb_idx); verbs.contains(verb)) {
+                if (!allow_value.empty()) {
+                    allow_value += ", ";
+                }
+
+                allow_value += verb_names[verb_idx];
+            }
+        }
+
+        return allow_value;
+    }
+}
@@ -1,8 +1,8 @@
 #include <utility>
 #include <algorithm>
+#include <charconv>
 #include <string>
 
-#include <sstream>
 #include <iostream>
 #include <print>
 
@@ -14,46 +14,56 @@ namespace DerkHttpd::Http {
     constexpr auto http_chunk_prefix_base = 16;
     constexpr auto http_chunk_prefix_dud = -1;
 
+    /// NOTE: Takes the next run of non-space chars off `rest`, like `operator>>` on a stream but without copying the line.
+    [[nodiscard]] static constexpr auto take_word(std::string_view& rest) noexcept -> std::string_view {
+        constexpr std::string_view space_chars {" \t\r\n"};
+
+        const auto word_begin = std::min(rest.find_first_not_of(space_chars), rest.length());
+        const auto word_end = std::min(rest.find_first_of(space_chars, word_begin), rest.length());
+        const auto word = rest.substr(word_begin, word_end - word_begin);
+
+        rest.remove_prefix(word_end);
+
+        return word;
+    }
+
     auto HttpIntake::parse_request_line(std::string_view sv) -> std::expected<RawReqLine, std::string> {
-        std::istringstream tokenizer {std::format("{}", sv)};
-        std::string verb_lexeme;
-        std::string path_lexeme;
-        std::string schema_lexeme;
+        const auto verb_lexeme = take_word(sv);
+        const auto path_lexeme = take_word(sv);
+        const auto schema_lexeme = take_word(sv);
 
-        tokenizer >> verb_lexeme;
-        tokenizer >> path_lexeme;
-        tokenizer >> schema_lexeme;
+        const auto verb_it = m_verbs.find(verb_lexeme);
+        const auto schema_it = m_schemas.find(schema_lexeme);
 
         return RawReqLine {
-            .rel_uri = std::move(path_lexeme),
-            .verb = m_verbs.contains(verb_lexeme) ? m_verbs.at(verb_lexeme) : Verb::http_get,
-            .schema = m_schemas.contains(schema_lexeme) ? m_schemas.at(schema_lexeme) : Schema::http_1_1,
+            .rel_uri = path_lexeme,
+            .verb = (verb_it != m_verbs.end()) ? verb_it->second : Verb::http_get,
+            .schema = (schema_it != m_schemas.end()) ? schema_it->second : Schema::http_1_1,
         };
     }
 
     // TODO: skip leading & trailing spaces around header key and value.
     auto HttpIntake::parse_request_header(std::string_view sv) -> std::expected<RawHeader, std::string> {
-        if (sv.empty()) {
+        // A line without ':' is all key, which leaves the value empty.
+        const auto colon_pos = sv.find(':');
+
+        if (colon_pos == std::string_view::npos) {
             return RawHeader {
-                .key = {},
+                .key = sv,
                 .value = {},
             };
         }
 
-        std::istringstream tokenizer {std::format("{}", sv)};
-        std::string header_key_lexeme;
-        std::string header_value_lexeme;
-
-        std::getline(tokenizer, header_key_lexeme, ':');
+        auto value_sv = sv.substr(colon_pos + 1);
 
         // Skip extra spaces between ':' and <value> for correct strings.
-        tokenizer.ignore(1, ' ');
-
-        std::getline(tokenizer, header_value_lexeme);
+        if (value_sv.starts_with(' ')) {
+            value_sv.remove_prefix(1);
+        }
 
         return RawHeader {
-            .key = std::move(header_key_lexeme),
-            .value = std::move(header_value_lexeme),
+            .key = sv.substr(0, colon_pos),
+            .value = value_sv,
         };
     }
 
@@ -71,9 +81,9 @@ namespace DerkHttpd::Http {
         } else {
             auto& [req_path, req_verb, req_schema] = request_line.value();
 
-            m_temp.uri = std::move(req_path);
-            m_temp.http_verb = req_verb;
-            m_temp.http_schema = req_schema;
+            m_temp->uri = req_path;
+            m_temp->http_verb = req_verb;
+            m_temp->http_schema = req_schema;
         }
 
         return State::httpin_state_header;
@@ -88,14 +98,18 @@ namespace DerkHttpd::Http {
 
         std::string_view temp_line {m_buffer.data(), static_cast<std::size_t>(io_result.value())};
 
-        if (temp_line.length() >= static_cast<std::size_t>(m_max_header_size)) {
+        m_header_block_n += static_cast<int>(temp_line.length());
+
+        if (temp_line.length() >= static_cast<std::size_t>(m_max_header_size) || m_header_block_n > m_max_header_block_size) {
+            m_reject_status = Status::http_request_header_fields_too_large;
             return State::httpin_state_constraint_error;
         }
 
         if (auto request_line = parse_request_header(temp_line); !request_line.has_value()) {
             return State::httpin_state_syntax_error;
         } else if (auto& [key , value] = request_line.value(); !key.empty() && !value.empty()) {
-            m_temp.headers[key] = std::move(value);
+            // The key is built on the request's resource, so inserting it moves instead of copying.
+            m_temp->headers.insert_or_assign(HeaderMap::key_type {key, m_temp->headers.get_allocator()}, value);
 
             return State::httpin_state_header;
         } else {
@@ -104,8 +118,8 @@ namespace DerkHttpd::Http {
     }
 
     auto HttpIntake::handle_state_choose_body_mode() -> State {
-        if (m_temp.headers.contains("Transfer-Encoding")) {
-            if (const auto& transfer_encoding = m_temp.headers.at("Transfer-Encoding"); transfer_encoding == "chunked") {
+        if (m_temp->headers.contains("Transfer-Encoding")) {
+            if (const auto& transfer_encoding = m_temp->headers.at("Transfer-Encoding"); transfer_encoding == "chunked") {
                 return State::httpin_state_chunk;
             }
         }
@@ -116,29 +130,36 @@ namespace DerkHttpd::Http {
     auto HttpIntake::handle_state_simple_body(int fd) -> State {
         Blob temp_body;
 
-        auto pending_body_n = (m_temp.headers.contains("Content-Length")) ? std::stoi(m_temp.headers.at("Content-Length")) : 0;
+        int pending_body_n = 0;
+
+        if (auto length_it = m_temp->headers.find("Content-Length"); length_it != m_temp->headers.end()) {
+            const auto& length_text = length_it->second;
+
+            if (const auto [length_end, length_err] = std::from_chars(length_text.data(), length_text.data() + length_text.size(), pending_body_n); length_err != std::errc {} || pending_body_n < 0) {
+                return State::httpin_state_syntax_error;
+            }
+        }
 
-        if (pending_body_n > m_max_body_size) {
-            // std::println(std::cerr, "Intake ERR: request body too big!");
+        if (!reserve_body(pending_body_n)) {
             return State::httpin_state_constraint_error;
         }
 
+        // NOTE: The body is sized once and then moved along to the handler, so its bytes are copied only out of the read buffer.
+        temp_body.reserve(static_cast<std::size_t>(pending_body_n));
+
         while (pending_body_n > 0) {
             if (auto recv_result = Net::socket_read_n(fd, pending_body_n, m_buffer); !recv_result.has_value()) {
                 return State::httpin_state_syntax_error;
             } else if (const auto read_n = recv_result.value(); read_n > 0) {
-                for (std::string_view fragment_view = m_buffer.data(); const auto ch : fragment_view) {
-                    temp_body.emplace_back(ch);
-                }
+                temp_body.append_range(std::string_view {m_buffer.begin(), m_buffer.begin() + read_n});
 
                 pending_body_n -= read_n;
-                std::ranges::fill(m_buffer, '\0');
             } else {
                 break;
             }
         }
 
-        m_temp.body = std::move(temp_body);
+        m_temp->body = std::move(temp_body);
 
         return State::httpin_state_done;
     }
@@ -160,8 +181,12 @@ namespace DerkHttpd::Http {
             }
         })({m_buffer.data()});
 
-        // 2. If the prefix length is valid and positive, read another body chunk.
+        // 2. If the prefix length is valid and positive, read another body chunk. Chunks add up against the same limits as a simple body.
         if (chunk_length > 0) {
+            if (!reserve_body(chunk_length)) {
+                return State::httpin_state_constraint_error;
+            }
+
             ssize_t pending_chunk_n = chunk_length;
 
             while (pending_chunk_n > 0) {
@@ -170,7 +195,7 @@ namespace DerkHttpd::Http {
 
                     return State::httpin_state_syntax_error;
                 } else if (const auto chunk_io_read_n = chunk_temp_io_res.value(); chunk_io_read_n > 0) {
-                    m_temp.body.append_range(std::string_view {m_buffer.begin(), m_buffer.begin() + chunk_io_read_n});
+                    m_temp->body.append_range(std::string_view {m_buffer.begin(), m_buffer.begin() + chunk_io_read_n});
 
                     pending_chunk_n -= chunk_io_read_n;
                 } else {
@@ -195,8 +220,22 @@ namespace DerkHttpd::Http {
         return (chunk_length == 0) ? State::httpin_state_done : State::httpin_state_chunk ;
     }
 
+    auto HttpIntake::reserve_body(int n) noexcept -> bool {
+        if (n > m_max_body_size - static_cast<int>(m_body_lease.size())) {
+            m_reject_status = Status::http_content_too_large;
+            return false;
+        }
+
+        if (!m_body_lease.try_grow(Net::MemoryBudget::instance(), static_cast<std::size_t>(n))) {
+            m_reject_status = Status::http_service_unavailable;
+            return false;
+        }
+
+        return true;
+    }
+
     HttpIntake::HttpIntake(IntakeConfig config) noexcept
-    : m_buffer {}, m_verbs {}, m_schemas {}, m_temp {}, m_state {State::httpin_state_request_line}, m_max_header_size {480}, m_max_body_size {config.max_body_size} {
+    : m_buffer {}, m_verbs {}, m_schemas {}, m_temp {}, m_body_lease {}, m_state {State::httpin_state_request_line}, m_reject_status {Status::http_bad_request}, m_header_block_n {0}, m_max_header_size {std::min(config.max_header_size, static_cast<int>(Net::ByteBuffer<>{}.size()) - 1)}, m_max_header_block_size {config.max_header_block_size}, m_max_body_size {config.max_body_size} {
         std::ranges::fill(m_buffer, 0);
 
         m_verbs.emplace("GET"s, Verb::http_get);
@@ -204,13 +243,23 @@ namespace DerkHttpd::Http {
         m_verbs.emplace("POST"s, Verb::http_post);
         m_verbs.emplace("PUT"s, Verb::http_put);
         m_verbs.emplace("DELETE"s, Verb::http_delete);
+        m_verbs.emplace("OPTIONS"s, Verb::http_options);
 
         m_schemas.emplace("HTTP/1.0"s, Schema::http_1_0);
         m_schemas.emplace("HTTP/1.1"s, Schema::http_1_1);
     }
 
-    auto HttpIntake::operator()(int fd) -> std::expected<Request, std::string> {
+    auto HttpIntake::operator()(int fd, std::pmr::memory_resource* arena) -> std::expected<Request, IntakeError> {
+        m_body_lease.reset();
         m_state = State::httpin_state_request_line;
+        m_header_block_n = 0;
+        m_temp.emplace(Request {
+            .body = {},
+            .headers = HeaderMap {arena},
+            .uri = std::pmr::string {arena},
+            .http_verb = Verb::http_get,
+            .http_schema = Schema::http_1_1,
+        });
 
         auto request_malformed = false;
         auto request_bad_sema = false;
@@ -248,12 +297,31 @@ namespace DerkHttpd::Http {
             }
         }
 
+        // NOTE: The pending request is dropped on every path, so no view of `arena` outlives this call inside the intake.
+        Request done_request = std::move(m_temp.value());
+
+        m_temp.reset();
+
         if (request_malformed) {
-            return std::unexpected {"Invalid request syntax!"};
+            m_body_lease.reset();
+
+            return std::unexpected {IntakeError {
+                .message = "Invalid request syntax!",
+                .reply_status = {},
+            }};
         } else if (request_bad_sema) {
-            return std::unexpected {"Invalid request header / body sizing!"};
+            m_body_lease.reset();
+
+            return std::unexpected {IntakeError {
+                .message = "Invalid request header / body sizing!",
+                .reply_status = m_reject_status,
+            }};
         }
 
-        return {std::exchange(m_temp, {})};
+        return {std::move(done_request)};
+    }
+
+    void HttpIntake::release_body_budget() noexcept {
+        m_body_lease.reset();
     }
 }
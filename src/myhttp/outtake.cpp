@@ -1,200 +1,157 @@
-#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <format>
 #include <string>
+#include <utility>
 
-#include "mynet/io_funcs.hpp"
+#include "mynet/outbound.hpp"
 #include "myhttp/enums.hpp"
 #include "myhttp/msgs.hpp"
 #include "myhttp/outtake.hpp"
 
 namespace DerkHttpd::Http {
-    void HttpOuttake::reset() noexcept {
-        std::ranges::fill(m_reply_bytes, '\0');
-        m_load_count = 0;
-    }
-
-    auto HttpOuttake::serialize(std::string_view sv) noexcept -> bool {
-        if (const auto sv_len = sv.length(); m_reply_bytes.size() - m_load_count >= sv_len) {
-            std::copy(sv.begin(), sv.end(), m_reply_bytes.begin() + m_load_count);
-            m_load_count += sv_len;
-
-            return true;
-        }
+    constexpr auto head_bytes_reserve_n = 512;
 
-        return false;
+    void HttpOuttake::serialize(std::string_view sv) {
+        m_head_bytes.append_range(sv);
     }
 
-    auto HttpOuttake::write_status_line(int fd, Schema schema, Status status) -> Net::IOResult<ssize_t> {
-        reset();
-
-        const auto schema_name_sv = schema_enum_to_name(schema);
-        const auto status_code_sv = status_enum_to_code(status);
-        const auto status_name_sv = status_enum_to_name(status);
-
-        if (!serialize(schema_name_sv)) {
-            return std::unexpected {"Buffer space exhausted for HTTP schema of reply."};
-        }
-
-        if (!serialize(" ")) {
-            return std::unexpected {"Buffer space exhausted for post-reply-schema SP."};
-        }
-
-        if (!serialize(status_code_sv)) {
-            return std::unexpected {"Buffer space exhausted for HTTP status code of reply."};
-        }
+    void HttpOuttake::serialize_status_line(Schema schema, Status status) {
+        serialize(schema_enum_to_name(schema));
+        serialize(" ");
+        serialize(status_enum_to_code(status));
+        serialize(" ");
+        serialize(status_enum_to_name(status));
+        serialize("\r\n");
+    }
 
-        if (!serialize(" ")) {
-            return std::unexpected {"Buffer space exhausted for post-status-code SP."};
+    void HttpOuttake::serialize_batched_headers(const HeaderMap& headers) {
+        for (const auto& [header_key, header_value] : headers) {
+            serialize(header_key);
+            serialize(": ");
+            serialize(header_value);
+            serialize("\r\n");
         }
 
-        if (!serialize(status_name_sv)) {
-            return std::unexpected {"Buffer space exhausted for status-msg of reply."};
-        }
+        serialize("\r\n");
+    }
 
-        if (!serialize("\r\n")) {
-            return std::unexpected {"Buffer space exhausted for CRLF of reply-status-line."};
-        }
+    auto HttpOuttake::queue_body(Net::OutboundQueue& outbound, Blob&& blob) -> bool {
+        outbound.push_bytes(std::move(blob));
 
-        return Net::socket_write_n(fd, m_load_count, m_reply_bytes);
+        return true;
     }
 
-    auto HttpOuttake::write_batched_headers(int fd, const std::map<std::string, std::string>& headers) -> Net::IOResult<ssize_t> {
-        reset();
-
-        auto has_serialize_err = false;
+    auto HttpOuttake::queue_body(Net::OutboundQueue& outbound, App::ChunkIterPtr chunking_it) -> bool {
+        if (!chunking_it) {
+            return false;
+        }
 
-        for (std::size_t header_count = 0; const auto& [header_key, header_value] : headers) {
-            ++header_count;
+        // NOTE: The producer frames one chunk per call, so a stalled client only parks the iterator's position instead of buffering the whole payload.
+        auto ready_probe = [chunk_source = chunking_it]() -> bool {
+            return chunk_source->is_ready();
+        };
 
-            if (!serialize(header_key)) {
-                has_serialize_err = true;
-                break;
+        outbound.push_producer([chunk_source = std::move(chunking_it), source_done = false]() mutable -> Net::IOResult<Net::OutBytes> {
+            if (source_done) {
+                return Net::OutBytes {};
             }
 
-            if (!serialize(": ")) {
-                has_serialize_err = true;
-                break;
-            }
-            
-            if (!serialize(header_value)) {
-                has_serialize_err = true;
-                break;
-            }
+            auto next_chunk = chunk_source->next();
 
-            if (!serialize("\r\n")) {
-                has_serialize_err = true;
-                break;
+            if (!next_chunk) {
+                return std::unexpected {"Failed to transmit a file chunk."};
             }
 
-            if (header_count >= headers.size()) {
-                if (!serialize("\r\n")) {
-                    has_serialize_err = true;
-                    break;
-                }
-            }
+            Net::OutBytes http_chunk;
 
-            if (auto io_res = Net::socket_write_n(fd, m_load_count, m_reply_bytes); !io_res) {
-                // Report errors ASAP when some I/O goes wrong.
-                return io_res;
-            } else {   
-                reset();
+            if (const auto& chunk_payload_blob = next_chunk.value(); !chunk_payload_blob.empty()) {
+                http_chunk.reserve(chunk_payload_blob.size() + 16);
+                http_chunk.append_range(std::format("{:x}\r\n", chunk_payload_blob.size()));
+                http_chunk.append_range(chunk_payload_blob);
+                http_chunk.append_range(std::string_view {"\r\n"});
+            } else {
+                http_chunk.append_range(std::string_view {"0\r\n\r\n"});
+                source_done = true;
             }
-        }
 
-        if (has_serialize_err) {
-            return std::unexpected {"Failed to encode a server-made header: exceeds buffer size."};
-        }
+            return http_chunk;
+        }, std::move(ready_probe));
 
-        return {static_cast<ssize_t>(m_load_count)};
+        return true;
     }
 
-    auto HttpOuttake::write_body(int fd, const Blob& blob) -> Net::IOResult<ssize_t> {
-        auto blob_data = blob.data();
+    auto HttpOuttake::queue_body(Net::OutboundQueue& outbound, const FileRegion& region) -> bool {
+        if (region.length == 0) {
+            return true;
+        }
 
-        const int output_buffer_size = m_reply_bytes.size();
-        int pending_load_n = blob.size();
-        int temp_n = 0;
-        int done_n = 0;
+        const auto file_fd = open(region.path.c_str(), O_RDONLY | O_CLOEXEC);
 
-        std::ranges::fill(m_reply_bytes, '\0');
+        if (file_fd == -1) {
+            return false;
+        }
 
-        while (pending_load_n > 0) {
-            temp_n = std::min(pending_load_n, output_buffer_size);
+#ifdef POSIX_FADV_WILLNEED
+        // NOTE: Start paging the span in while the head is sent, so `sendfile` is less likely to block on a cold page cache.
+        posix_fadvise(file_fd, static_cast<off_t>(region.offset), static_cast<off_t>(region.length), POSIX_FADV_WILLNEED);
+#endif
 
-            std::copy_n(blob_data + done_n, temp_n, m_reply_bytes.data());
+        outbound.push_file(file_fd, static_cast<off_t>(region.offset), region.length);
 
-            if (auto io_result = Net::socket_write_n(fd, temp_n, m_reply_bytes); !io_result) {
-                return io_result;
-            }
+        return true;
+    }
 
-            done_n += temp_n;
-            pending_load_n -= temp_n;
-        }
+    auto HttpOuttake::queue_body(Net::OutboundQueue& outbound, const StaticBytes& static_bytes) -> bool {
+        outbound.push_static(static_bytes.bytes.data(), static_bytes.bytes.size());
 
-        return {static_cast<ssize_t>(done_n)};
+        return true;
     }
 
-    auto HttpOuttake::write_body(int fd, App::ChunkIterPtr chunking_it) -> Net::IOResult<ssize_t> {
-        reset();
+    auto HttpOuttake::queue_body(Net::OutboundQueue& outbound, SharedBytes&& shared_bytes) -> bool {
+        const auto bytes_sv = shared_bytes.view();
 
-        Http::Blob http_chunk;
+        // NOTE: The queue only takes a reference, so every connection sending these bytes shares one buffer.
+        outbound.push_shared(shared_bytes.owner(), bytes_sv.data(), bytes_sv.size());
 
-        // NOTE: counts only resource bytes, not including the hex length prefix per chunk!
-        ssize_t total_write_count = 0;
+        return true;
+    }
 
-        while (true) {
-            if (auto next_chunk = chunking_it->next(); !next_chunk) {
-                return std::unexpected {"Failed to transmit a file chunk."};
-            } else {
-                const auto& chunk_payload_blob = next_chunk.value();
-
-                if (!chunk_payload_blob.empty()) {
-                    http_chunk.append_range(
-                        std::format("{:x}\r\n{}\r\n", chunk_payload_blob.size(), std::string_view {chunk_payload_blob.begin(), chunk_payload_blob.end()})
-                    );
-                } else {
-                    http_chunk.append_range(std::string_view {"0\r\n\r\n"});
-                }
-
-                if (auto chunk_io_res = write_body(fd, http_chunk); !chunk_io_res) {
-                    return chunk_io_res;
-                } else {
-                    total_write_count += chunk_io_res.value();
-                }
-
-                if (chunk_payload_blob.empty()) {
-                    break;
-                }
-
-                http_chunk.clear();
+    auto HttpOuttake::queue_body(Net::OutboundQueue& outbound, SharedChain&& shared_chain) -> bool {
+        for (auto& piece : shared_chain) {
+            if (!queue_body(outbound, std::move(piece))) {
+                return false;
             }
         }
 
-        return {total_write_count};
+        return true;
     }
 
-    HttpOuttake::HttpOuttake() noexcept 
-    : m_reply_bytes {}, m_load_count {0} {}
+    HttpOuttake::HttpOuttake() noexcept
+    : m_head_bytes {} {}
 
-    auto HttpOuttake::operator()(int fd, const Response& res) -> bool {
-        const auto& [res_body, res_headers, res_time, res_status, res_schema] = res;
+    auto HttpOuttake::operator()(Response&& res, Net::OutboundQueue& outbound) -> bool {
+        m_head_bytes.clear();
+        m_head_bytes.reserve(head_bytes_reserve_n);
 
-        if (auto start_line_io_res = write_status_line(fd, res_schema, res_status); !start_line_io_res) {
-            return false;
-        }
-
-        if (auto headers_io_res = write_batched_headers(fd, res_headers); !headers_io_res) {
-            return false;
-        }
+        serialize_status_line(res.http_schema, res.http_status);
+        serialize_batched_headers(res.headers);
 
-        Net::IOResult<ssize_t> body_send_res;
+        outbound.push_bytes(std::exchange(m_head_bytes, {}));
 
         if (auto blob_p = std::get_if<Http::Blob>(&res.body); blob_p) {
-            body_send_res = write_body(fd, *blob_p);
-        } else {
-            body_send_res = write_body(fd, std::get<App::ChunkIterPtr>(res.body));
+            return queue_body(outbound, std::move(*blob_p));
+        } else if (auto region_p = std::get_if<FileRegion>(&res.body); region_p) {
+            return queue_body(outbound, *region_p);
+        } else if (auto static_bytes_p = std::get_if<StaticBytes>(&res.body); static_bytes_p) {
+            return queue_body(outbound, *static_bytes_p);
+        } else if (auto shared_bytes_p = std::get_if<SharedBytes>(&res.body); shared_bytes_p) {
+            return queue_body(outbound, std::move(*shared_bytes_p));
+        } else if (auto shared_chain_p = std::get_if<SharedChain>(&res.body); shared_chain_p) {
+            return queue_body(outbound, std::move(*shared_chain_p));
         }
 
-        return body_send_res.has_value() && body_send_res.value() > 0;
+        return queue_body(outbound, std::get<App::ChunkIterPtr>(std::move(res.body)));
     }
 }
@@ -1,11 +1,178 @@
+#include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <utility>
+
 #include "mynet/handles.hpp"
 
 namespace DerkHttpd::Net {
-    Handles::Handles(pollfd pollable_fd)
-    : m_pfds {} {
+    TaskCompleter::TaskCompleter(ReportFn report_fn, void* sink_p, ConnectionId conn) noexcept
+    : m_report_fn {report_fn}, m_sink_p {sink_p}, m_conn {conn} {}
+
+    TaskCompleter::~TaskCompleter() {
+        (*this)({.conn = m_conn, .ok = false});
+    }
+
+    TaskCompleter::TaskCompleter(TaskCompleter&& other) noexcept
+    : m_report_fn {std::exchange(other.m_report_fn, nullptr)}, m_sink_p {other.m_sink_p}, m_conn {other.m_conn} {}
+
+    TaskCompleter& TaskCompleter::operator=(TaskCompleter&& other) noexcept {
+        if (this != &other) {
+            (*this)({.conn = m_conn, .ok = false});
+
+            m_report_fn = std::exchange(other.m_report_fn, nullptr);
+            m_sink_p = other.m_sink_p;
+            m_conn = other.m_conn;
+        }
+
+        return *this;
+    }
+
+    void TaskCompleter::operator()(IOTaskResult result) noexcept {
+        if (const auto report_fn = std::exchange(m_report_fn, nullptr); report_fn) {
+            report_fn(m_sink_p, result);
+        }
+    }
+
+    void Handles::report_completion(void* completion_vp, IOTaskResult result) noexcept {
+        auto& completion = *static_cast<TaskCompletion*>(completion_vp);
+        auto& owner = *completion.owner;
+
+        completion.result = result;
+        owner.m_completions.push(completion);
+        owner.m_completion_signal.notify();
+    }
+
+    auto Handles::deduce_client_events(const OutboundQueue& outbound) -> short {
+        short client_events = 0;
+
+        if (outbound.has_pending() && !outbound.awaits_input()) {
+            client_events |= POLLOUT;
+        }
+
+        if (!outbound.is_closing() && !outbound.above_high_water() && !MemoryBudget::instance().is_exhausted()) {
+            client_events |= POLLIN;
+        }
+
+        return client_events;
+    }
+
+    auto Handles::is_wake_fd(int fd) const noexcept -> bool {
+        return m_wake_signal && m_wake_signal->get_fd() == fd;
+    }
+
+    auto Handles::is_completion_fd(int fd) const noexcept -> bool {
+        return m_completion_signal.is_valid() && m_completion_signal.get_fd() == fd;
+    }
+
+    auto Handles::unparked_fd(const pollfd& pfd) noexcept -> int {
+        return (pfd.fd < 0) ? ~pfd.fd : pfd.fd;
+    }
+
+    auto Handles::is_client_fd(int fd) const noexcept -> bool {
+        return fd >= 0 && static_cast<std::size_t>(fd) < m_conns.size() && m_conns[fd].is_open;
+    }
+
+    auto Handles::find_connection(ConnectionId id) noexcept -> Connection* {
+        if (!is_client_fd(id.fd)) {
+            return nullptr;
+        }
+
+        auto& conn = m_conns[id.fd];
+
+        return (conn.generation == id.generation) ? &conn : nullptr;
+    }
+
+    void Handles::open_connection(int fd) {
+        const auto slot_idx = static_cast<std::size_t>(fd);
+
+        if (slot_idx >= m_conns.size()) {
+            m_conns.resize(slot_idx + 1);
+        }
+
+        // 1. Keep the slot's queue from its last client, as closing already emptied it.
+        auto& conn = m_conns[slot_idx];
+
+        if (!conn.outbound) {
+            conn.outbound = std::make_unique<OutboundQueue>(m_outbound_high_water_n);
+            conn.completion = std::make_unique<TaskCompletion>(TaskCompletion {
+                .result = {},
+                .next = nullptr,
+                .owner = this,
+            });
+        }
+
+        conn.pfd_idx = m_pfds.size();
+        ++conn.generation;
+        conn.is_open = true;
+
+        // 2. Register the client for polling.
+        m_pfds.emplace_back(pollfd {
+            .fd = fd,
+            .events = deduce_client_events(*conn.outbound),
+            .revents = 0,
+        });
+    }
+
+    void Handles::close_connection(int fd) noexcept {
+        auto& conn = m_conns[fd];
+        const auto vacant_idx = conn.pfd_idx;
+
+        // 1. Fill the vacant `pollfd` with the last one, then tell its owner where it went.
+        if (const auto last_idx = m_pfds.size() - 1; vacant_idx != last_idx) {
+            m_pfds[vacant_idx] = m_pfds[last_idx];
+            m_conns[unparked_fd(m_pfds[vacant_idx])].pfd_idx = vacant_idx;
+        }
+
+        m_pfds.pop_back();
+
+        // 2. Empty the slot but keep its queue for the fd's next client.
+        conn.outbound->reset();
+        conn.is_open = false;
+        close(fd);
+    }
+
+    Handles::Handles(pollfd pollable_fd, std::size_t outbound_high_water_n, std::shared_ptr<WakeSignal> wake_signal)
+    : m_pfds {}, m_conns {}, m_completions {}, m_completion_signal {}, m_outbound_high_water_n {outbound_high_water_n}, m_wake_signal {std::move(wake_signal)}, m_shedding_reads {false}, m_draining {false} {
         m_pfds.emplace_back(pollable_fd);
+
+        if (m_wake_signal && m_wake_signal->is_valid()) {
+            m_pfds.emplace_back(pollfd {
+                .fd = m_wake_signal->get_fd(),
+                .events = POLLIN,
+                .revents = 0,
+            });
+        } else {
+            m_wake_signal.reset();
+        }
+
+        // Without the signal, finished tasks are still reaped, but only once the poll times out.
+        if (m_completion_signal.is_valid()) {
+            m_pfds.emplace_back(pollfd {
+                .fd = m_completion_signal.get_fd(),
+                .events = POLLIN,
+                .revents = 0,
+            });
+        }
+    }
+
+    void Handles::begin_drain() noexcept {
+        if (std::exchange(m_draining, true)) {
+            return;
+        }
+
+        // An upgraded process may still accept on its own copy of this socket, so closing ours loses no pending connection.
+        if (auto& listener_pfd = m_pfds.front(); listener_pfd.fd != -1) {
+            close(listener_pfd.fd);
+            listener_pfd.fd = -1;
+        }
+    }
+
+    auto Handles::is_drained() const noexcept -> bool {
+        return m_draining && std::ranges::none_of(m_pfds, [this](const pollfd& pfd) noexcept -> bool {
+            return is_client_fd(unparked_fd(pfd));
+        });
     }
 
     Handles::~Handles() {
@@ -13,12 +180,42 @@ namespace DerkHttpd::Net {
             return;
         }
 
+        // 1. Cut off the clients of in-flight tasks, so a task blocked reading a slow client returns at once instead of holding up shutdown. Their fds stay open until the tasks are done with them.
+        std::size_t in_flight_n = 0;
+
+        for (std::size_t pfd_idx = 1; pfd_idx < m_pfds.size(); ++pfd_idx) {
+            if (const auto fd_n = unparked_fd(m_pfds[pfd_idx]); m_pfds[pfd_idx].fd < 0 && is_client_fd(fd_n)) {
+                shutdown(fd_n, SHUT_RDWR);
+                ++in_flight_n;
+            }
+        }
+
+        // 2. In-flight tasks still use their client's queue, socket and completion node, and one that handed its completer on may report well after its own thread ended. So wait for every report, not just the threads.
+        while (in_flight_n > 0) {
+            for (auto completion_p = m_completions.take_all(); completion_p; completion_p = completion_p->next, --in_flight_n) {
+                m_conns[completion_p->result.conn.fd].in_flight.wait();
+            }
+
+            if (in_flight_n > 0) {
+                pollfd completion_pfd {
+                    .fd = (m_completion_signal.is_valid()) ? m_completion_signal.get_fd() : -1,
+                    .events = POLLIN,
+                    .revents = 0,
+                };
+
+                poll(&completion_pfd, 1, fallback_timeout);
+                m_completion_signal.drain();
+            }
+        }
+
+        // 3. Close every socket but the wake signals, which close their own fds.
         for (const auto& pfd : m_pfds) {
-            if (const auto fd_n = pfd.fd; fd_n > 0) {
+            if (const auto fd_n = unparked_fd(pfd); fd_n > 0 && !is_wake_fd(fd_n) && !is_completion_fd(fd_n)) {
                 close(fd_n);
             }
         }
 
+        m_conns.clear();
         m_pfds.clear();
     }
 }
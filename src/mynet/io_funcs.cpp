@@ -1,6 +1,14 @@
 #include <sys/socket.h>
+#include <sys/types.h>
+#include <cerrno>
 #include <algorithm>
 
+#ifdef __APPLE__
+#include <sys/uio.h>
+#else
+#include <sys/sendfile.h>
+#endif
+
 #include "mynet/io_funcs.hpp"
 
 namespace DerkHttpd::Net {
@@ -62,19 +70,45 @@ namespace DerkHttpd::Net {
         return {done_rc};
     }
 
-    auto socket_write_n(int fd, ssize_t n, const ByteBuffer<>& src) noexcept -> IOResult<ssize_t> {
-        const auto src_data_p = src.data();
-        auto pending_wc = n;
+    auto socket_writev_some(int fd, const iovec* iov, int iov_n) noexcept -> IOResult<ssize_t> {
+        while (true) {
+            if (const ssize_t temp_wc = writev(fd, iov, iov_n); temp_wc >= 0) {
+                return {temp_wc};
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return {0};
+            } else if (errno != EINTR) {
+                return std::unexpected {"Bad write with fd in io_funcs.cpp::socket_writev_some(): temp_wc < 0"};
+            }
+        }
+    }
+
+    auto socket_send_file_some(int fd, int file_fd, off_t offset, std::size_t n) noexcept -> IOResult<ssize_t> {
+        auto file_pos = offset;
+        auto pending_wc = static_cast<ssize_t>(n);
         ssize_t done_wc = 0;
 
         while (pending_wc > 0) {
-            if (const ssize_t temp_wc = send(fd, src_data_p + done_wc, pending_wc, 0); temp_wc > 0) {
+#ifdef __APPLE__
+            // NOTE: Darwin's variant reports partial progress through `temp_len`, even when it fails with `EAGAIN`.
+            off_t temp_len = pending_wc;
+            const auto send_status = sendfile(file_fd, fd, file_pos, &temp_len, nullptr, 0);
+            const ssize_t temp_wc = (send_status == -1 && temp_len == 0) ? -1 : static_cast<ssize_t>(temp_len);
+
+            file_pos += temp_len;
+#else
+            const ssize_t temp_wc = sendfile(fd, file_fd, &file_pos, static_cast<std::size_t>(pending_wc));
+#endif
+
+            if (temp_wc > 0) {
                 done_wc += temp_wc;
                 pending_wc -= temp_wc;
             } else if (temp_wc == 0) {
-                return {0};
-            } else {
-                return std::unexpected {"Bad write with fd in io_funcs.cpp::socket_write_n(): temp_wc < 0"};
+                // The file shrank under the response, so its declared length can no longer be honored.
+                return std::unexpected {"Truncated file source in io_funcs.cpp::socket_send_file_some(): temp_wc == 0"};
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            } else if (errno != EINTR) {
+                return std::unexpected {"Bad write with fd in io_funcs.cpp::socket_send_file_some(): temp_wc < 0"};
             }
         }
 
@@ -0,0 +1,132 @@
+#ifdef __linux__
+#include <linux/close_range.h>
+#endif
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <string_view>
+#include <vector>
+
+#include "mynet/listener_handoff.hpp"
+
+extern char** environ;
+
+namespace DerkHttpd::Net {
+    auto take_inherited_listener() noexcept -> std::optional<int> {
+        const char* fd_text = std::getenv(inherited_listener_env);
+
+        if (!fd_text) {
+            return {};
+        }
+
+        const std::string_view fd_sv {fd_text};
+        int listener_fd = -1;
+        const auto [parse_end, parse_errc] = std::from_chars(fd_sv.data(), fd_sv.data() + fd_sv.size(), listener_fd);
+
+        unsetenv(inherited_listener_env);
+
+        if (parse_errc != std::errc {} || parse_end != fd_sv.data() + fd_sv.size() || listener_fd < 0) {
+            return {};
+        }
+
+        int accepts_conns = 0;
+        socklen_t option_len = sizeof(accepts_conns);
+
+        if (getsockopt(listener_fd, SOL_SOCKET, SO_ACCEPTCONN, &accepts_conns, &option_len) != 0 || accepts_conns == 0) {
+            return {};
+        }
+
+        // The parent cleared this only for the exec, so the next upgrade decides again what crosses over.
+        fcntl(listener_fd, F_SETFD, FD_CLOEXEC);
+
+        return listener_fd;
+    }
+
+    auto spawn_upgraded_server(int listener_fd, char* const argv[]) -> std::expected<pid_t, std::string> {
+        // 1. Prepare everything the child needs before forking, as a child of a threaded process may only make async-signal-safe calls.
+        const auto listener_entry_prefix = std::format("{}=", inherited_listener_env);
+        auto listener_entry = std::format("{}{}", listener_entry_prefix, listener_fd);
+        std::vector<char*> child_env;
+
+        for (auto env_pp = environ; *env_pp; ++env_pp) {
+            if (!std::string_view {*env_pp}.starts_with(listener_entry_prefix)) {
+                child_env.push_back(*env_pp);
+            }
+        }
+
+        child_env.push_back(listener_entry.data());
+        child_env.push_back(nullptr);
+
+        const auto fd_limit = static_cast<int>(sysconf(_SC_OPEN_MAX));
+
+        // 2. The child writes its errno here only if the exec fails. A successful exec closes the write end, so the parent reads EOF.
+        std::array<int, 2> status_fds {-1, -1};
+
+        if (pipe(status_fds.data()) != 0) {
+            return std::unexpected {std::format("spawn_upgraded_server: failed to create status pipe: {}", std::strerror(errno))};
+        }
+
+        for (const auto status_fd : status_fds) {
+            fcntl(status_fd, F_SETFD, FD_CLOEXEC);
+        }
+
+        const auto child_pid = fork();
+
+        if (child_pid == -1) {
+            const auto fork_errno = errno;
+
+            close(status_fds[0]);
+            close(status_fds[1]);
+
+            return std::unexpected {std::format("spawn_upgraded_server: failed to fork: {}", std::strerror(fork_errno))};
+        }
+
+        if (child_pid == 0) {
+            // 3. Only the listener crosses the exec. Clients, cached files and wake fds stay with the draining parent.
+#ifdef __linux__
+            if (close_range(3, ~0U, CLOSE_RANGE_CLOEXEC) != 0)
+#endif
+            {
+                for (int open_fd = 3; open_fd < fd_limit; ++open_fd) {
+                    fcntl(open_fd, F_SETFD, FD_CLOEXEC);
+                }
+            }
+
+            fcntl(listener_fd, F_SETFD, 0);
+            execve(argv[0], argv, child_env.data());
+
+            const int exec_errno = errno;
+            [[maybe_unused]] const auto write_n = write(status_fds[1], &exec_errno, sizeof(exec_errno));
+
+            _exit(127);
+        }
+
+        // 4. Wait for the exec to succeed or fail.
+        close(status_fds[1]);
+
+        int exec_errno = 0;
+        ssize_t read_n = 0;
+
+        do {
+            read_n = read(status_fds[0], &exec_errno, sizeof(exec_errno));
+        } while (read_n == -1 && errno == EINTR);
+
+        close(status_fds[0]);
+
+        if (read_n > 0) {
+            waitpid(child_pid, nullptr, 0);
+
+            return std::unexpected {std::format("spawn_upgraded_server: failed to exec {}: {}", argv[0], std::strerror(exec_errno))};
+        }
+
+        return child_pid;
+    }
+}
@@ -0,0 +1,100 @@
+#include <utility>
+
+#include "mynet/memory_budget.hpp"
+
+namespace DerkHttpd::Net {
+    MemoryBudget::MemoryBudget() noexcept
+    : m_used_n {0}, m_limit_n {default_limit_n} {}
+
+    auto MemoryBudget::instance() noexcept -> MemoryBudget& {
+        static MemoryBudget shared_budget;
+
+        return shared_budget;
+    }
+
+    void MemoryBudget::set_limit(std::size_t limit_n) noexcept {
+        m_limit_n.store(limit_n, std::memory_order_relaxed);
+    }
+
+    auto MemoryBudget::try_reserve(std::size_t n, std::size_t headroom_n) noexcept -> bool {
+        const auto limit_n = m_limit_n.load(std::memory_order_relaxed);
+        auto used_n = m_used_n.load(std::memory_order_relaxed);
+
+        // Retry only while other threads change the count, never once the room is gone.
+        do {
+            if (used_n > limit_n || n > limit_n - used_n || headroom_n > limit_n - used_n - n) {
+                return false;
+            }
+        } while (!m_used_n.compare_exchange_weak(used_n, used_n + n, std::memory_order_relaxed));
+
+        return true;
+    }
+
+    void MemoryBudget::charge(std::size_t n) noexcept {
+        m_used_n.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void MemoryBudget::release(std::size_t n) noexcept {
+        m_used_n.fetch_sub(n, std::memory_order_relaxed);
+    }
+
+    auto MemoryBudget::is_exhausted() const noexcept -> bool {
+        return m_used_n.load(std::memory_order_relaxed) >= m_limit_n.load(std::memory_order_relaxed);
+    }
+
+    auto MemoryBudget::get_used() const noexcept -> std::size_t {
+        return m_used_n.load(std::memory_order_relaxed);
+    }
+
+    auto MemoryBudget::get_limit() const noexcept -> std::size_t {
+        return m_limit_n.load(std::memory_order_relaxed);
+    }
+
+
+    MemoryLease::MemoryLease() noexcept
+    : m_budget {nullptr}, m_n {0} {}
+
+    MemoryLease::MemoryLease(MemoryBudget& budget, std::size_t n) noexcept
+    : m_budget {&budget}, m_n {n} {}
+
+    MemoryLease::~MemoryLease() {
+        reset();
+    }
+
+    MemoryLease::MemoryLease(MemoryLease&& other) noexcept
+    : m_budget {std::exchange(other.m_budget, nullptr)}, m_n {std::exchange(other.m_n, 0)} {}
+
+    MemoryLease& MemoryLease::operator=(MemoryLease&& other) noexcept {
+        if (this != &other) {
+            reset();
+            m_budget = std::exchange(other.m_budget, nullptr);
+            m_n = std::exchange(other.m_n, 0);
+        }
+
+        return *this;
+    }
+
+    auto MemoryLease::try_grow(MemoryBudget& budget, std::size_t n) noexcept -> bool {
+        if (!budget.try_reserve(n)) {
+            return false;
+        }
+
+        m_budget = &budget;
+        m_n += n;
+
+        return true;
+    }
+
+    void MemoryLease::reset() noexcept {
+        if (m_budget) {
+            m_budget->release(m_n);
+        }
+
+        m_budget = nullptr;
+        m_n = 0;
+    }
+
+    auto MemoryLease::size() const noexcept -> std::size_t {
+        return m_n;
+    }
+}
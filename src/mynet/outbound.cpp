@@ -0,0 +1,275 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <utility>
+
+#include "mynet/memory_budget.hpp"
+#include "mynet/outbound.hpp"
+
+namespace DerkHttpd::Net {
+    constexpr auto max_gather_iov_n = 16;
+
+    /// NOTE: Accepted sockets stay blocking for the byte-wise request intake, so only flushes switch to non-blocking mode. This also covers `sendfile`, which has no per-call flag for it.
+    class NonBlockingScope {
+    private:
+        int m_fd;
+        int m_old_flags;
+
+    public:
+        explicit NonBlockingScope(int fd) noexcept
+        : m_fd {fd}, m_old_flags {fcntl(fd, F_GETFL)} {
+            if (m_old_flags != -1 && (m_old_flags & O_NONBLOCK) == 0) {
+                fcntl(m_fd, F_SETFL, m_old_flags | O_NONBLOCK);
+            }
+        }
+
+        ~NonBlockingScope() {
+            if (m_old_flags != -1 && (m_old_flags & O_NONBLOCK) == 0) {
+                fcntl(m_fd, F_SETFL, m_old_flags);
+            }
+        }
+
+        NonBlockingScope(const NonBlockingScope&) = delete;
+        NonBlockingScope& operator=(const NonBlockingScope&) = delete;
+        NonBlockingScope(NonBlockingScope&&) = delete;
+        NonBlockingScope& operator=(NonBlockingScope&&) = delete;
+    };
+
+
+    /// NOTE: Views the bytes of an in-memory segment, or gives an empty view for file spans and producers.
+    [[nodiscard]] static auto view_memory_segment(const auto& segment) noexcept -> std::string_view {
+        if (const auto bytes_p = std::get_if<OutBytes>(&segment); bytes_p) {
+            return {bytes_p->data(), bytes_p->size()};
+        } else if (const auto static_span_p = std::get_if<OutStaticSpan>(&segment); static_span_p) {
+            return {static_span_p->data, static_span_p->length};
+        } else if (const auto shared_span_p = std::get_if<OutSharedSpan>(&segment); shared_span_p) {
+            return {shared_span_p->data, shared_span_p->length};
+        }
+
+        return {};
+    }
+
+    void OutboundQueue::release(Segment& segment) noexcept {
+        if (auto file_span_p = std::get_if<OutFileSpan>(&segment); file_span_p && file_span_p->file_fd != -1) {
+            close(file_span_p->file_fd);
+            file_span_p->file_fd = -1;
+        }
+    }
+
+    OutboundQueue::OutboundQueue(std::size_t high_water_n) noexcept
+    : m_segments {}, m_front_sent_n {0}, m_buffered_n {0}, m_high_water_n {high_water_n}, m_close_on_drain {false} {}
+
+    OutboundQueue::~OutboundQueue() {
+        for (auto& segment : m_segments) {
+            release(segment);
+        }
+
+        MemoryBudget::instance().release(m_buffered_n);
+    }
+
+    void OutboundQueue::reset() noexcept {
+        for (auto& segment : m_segments) {
+            release(segment);
+        }
+
+        m_segments.clear();
+        m_front_sent_n = 0;
+        MemoryBudget::instance().release(std::exchange(m_buffered_n, 0));
+        m_close_on_drain = false;
+    }
+
+    void OutboundQueue::push_bytes(OutBytes bytes) {
+        if (bytes.empty()) {
+            return;
+        }
+
+        m_buffered_n += bytes.size();
+        MemoryBudget::instance().charge(bytes.size());
+        m_segments.emplace_back(std::move(bytes));
+    }
+
+    void OutboundQueue::push_static(const char* data, std::size_t length) {
+        if (length == 0) {
+            return;
+        }
+
+        m_segments.emplace_back(OutStaticSpan {
+            .data = data,
+            .length = length,
+        });
+    }
+
+    void OutboundQueue::push_shared(std::shared_ptr<const void> owner, const char* data, std::size_t length) {
+        if (length == 0) {
+            return;
+        }
+
+        m_segments.emplace_back(OutSharedSpan {
+            .owner = std::move(owner),
+            .data = data,
+            .length = length,
+        });
+    }
+
+    auto OutboundQueue::flush_gathered(int fd) -> IOResult<ssize_t> {
+        std::array<iovec, max_gather_iov_n> gather_iovs;
+        auto iov_n = 0;
+
+        for (const auto& segment : m_segments) {
+            const auto segment_bytes = view_memory_segment(segment);
+
+            if (segment_bytes.empty() || iov_n == max_gather_iov_n) {
+                break;
+            }
+
+            const auto skip_n = (iov_n == 0) ? m_front_sent_n : 0;
+
+            gather_iovs[iov_n++] = iovec {
+                .iov_base = const_cast<char*>(segment_bytes.data() + skip_n),
+                .iov_len = segment_bytes.size() - skip_n,
+            };
+        }
+
+        const auto io_result = socket_writev_some(fd, gather_iovs.data(), iov_n);
+
+        if (!io_result) {
+            return io_result;
+        }
+
+        // Retire every fully sent segment, leaving a partially sent one in front.
+        auto sent_n = static_cast<std::size_t>(io_result.value());
+
+        while (sent_n > 0) {
+            auto& front_segment = m_segments.front();
+            const auto front_left_n = view_memory_segment(front_segment).size() - m_front_sent_n;
+            const auto front_taken_n = std::min(sent_n, front_left_n);
+
+            if (std::holds_alternative<OutBytes>(front_segment)) {
+                m_buffered_n -= front_taken_n;
+                MemoryBudget::instance().release(front_taken_n);
+            }
+
+            sent_n -= front_taken_n;
+
+            if (front_taken_n == front_left_n) {
+                m_segments.pop_front();
+                m_front_sent_n = 0;
+            } else {
+                m_front_sent_n += front_taken_n;
+            }
+        }
+
+        return io_result;
+    }
+
+    void OutboundQueue::push_file(int file_fd, off_t offset, std::size_t length) {
+        if (length == 0) {
+            close(file_fd);
+            return;
+        }
+
+        m_segments.emplace_back(OutFileSpan {
+            .file_fd = file_fd,
+            .offset = offset,
+            .length = length,
+        });
+    }
+
+    void OutboundQueue::push_producer(OutProducer producer, OutReadyProbe ready_probe) {
+        m_segments.emplace_back(OutStream {
+            .producer = std::move(producer),
+            .ready_probe = std::move(ready_probe),
+        });
+    }
+
+    auto OutboundQueue::flush(int fd) -> FlushStatus {
+        if (m_segments.empty()) {
+            return FlushStatus::drained;
+        }
+
+        NonBlockingScope nonblocking_guard {fd};
+
+        while (!m_segments.empty()) {
+            auto& front_segment = m_segments.front();
+
+            if (std::holds_alternative<OutBytes>(front_segment) || std::holds_alternative<OutStaticSpan>(front_segment) || std::holds_alternative<OutSharedSpan>(front_segment)) {
+                // 1. Send what remains of the leading in-memory segments together.
+                const auto io_result = flush_gathered(fd);
+
+                if (!io_result) {
+                    return FlushStatus::failed;
+                } else if (io_result.value() == 0) {
+                    return FlushStatus::pending;
+                }
+            } else if (auto file_span_p = std::get_if<OutFileSpan>(&front_segment); file_span_p) {
+                // 2. Send what remains of a file span straight from the page cache.
+                const auto io_result = socket_send_file_some(fd, file_span_p->file_fd, file_span_p->offset, file_span_p->length);
+
+                if (!io_result) {
+                    return FlushStatus::failed;
+                } else if (io_result.value() == 0) {
+                    return FlushStatus::pending;
+                }
+
+                file_span_p->offset += io_result.value();
+                file_span_p->length -= static_cast<std::size_t>(io_result.value());
+
+                if (file_span_p->length == 0) {
+                    release(front_segment);
+                    m_segments.pop_front();
+                }
+            } else {
+                // 3. Pull the next piece of a stream in front of its producer, so the producer resumes from its position on a later flush. A producer whose input is still in flight parks the queue instead of blocking the flush.
+                auto& [producer, ready_probe] = std::get<OutStream>(front_segment);
+
+                if (ready_probe && !ready_probe()) {
+                    return FlushStatus::stalled;
+                }
+
+                auto produced = producer();
+
+                if (!produced) {
+                    return FlushStatus::failed;
+                } else if (produced->empty()) {
+                    m_segments.pop_front();
+                    continue;
+                }
+
+                m_buffered_n += produced->size();
+                MemoryBudget::instance().charge(produced->size());
+                m_segments.emplace_front(std::move(produced.value()));
+            }
+        }
+
+        return FlushStatus::drained;
+    }
+
+    auto OutboundQueue::has_pending() const noexcept -> bool {
+        return !m_segments.empty();
+    }
+
+    auto OutboundQueue::awaits_input() const -> bool {
+        if (m_segments.empty()) {
+            return false;
+        }
+
+        const auto stream_p = std::get_if<OutStream>(&m_segments.front());
+
+        return stream_p && stream_p->ready_probe && !stream_p->ready_probe();
+    }
+
+    auto OutboundQueue::above_high_water() const noexcept -> bool {
+        return m_buffered_n >= m_high_water_n;
+    }
+
+    void OutboundQueue::close_on_drain() noexcept {
+        m_close_on_drain = true;
+    }
+
+    auto OutboundQueue::is_closing() const noexcept -> bool {
+        return m_close_on_drain;
+    }
+}
@@ -0,0 +1,65 @@
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+
+#include "mynet/wake_signal.hpp"
+
+namespace DerkHttpd::Net {
+    WakeSignal::WakeSignal() noexcept
+    : m_read_fd {-1}, m_write_fd {-1} {
+#ifdef __linux__
+        m_read_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        m_write_fd = m_read_fd;
+#else
+        if (std::array<int, 2> pipe_fds {-1, -1}; pipe(pipe_fds.data()) == 0) {
+            for (const auto pipe_fd : pipe_fds) {
+                fcntl(pipe_fd, F_SETFL, fcntl(pipe_fd, F_GETFL) | O_NONBLOCK);
+                fcntl(pipe_fd, F_SETFD, FD_CLOEXEC);
+            }
+
+            m_read_fd = pipe_fds[0];
+            m_write_fd = pipe_fds[1];
+        }
+#endif
+    }
+
+    WakeSignal::~WakeSignal() {
+        if (m_write_fd != -1 && m_write_fd != m_read_fd) {
+            close(m_write_fd);
+        }
+
+        if (m_read_fd != -1) {
+            close(m_read_fd);
+        }
+    }
+
+    auto WakeSignal::is_valid() const noexcept -> bool {
+        return m_read_fd != -1;
+    }
+
+    auto WakeSignal::get_fd() const noexcept -> int {
+        return m_read_fd;
+    }
+
+    void WakeSignal::notify() noexcept {
+        // NOTE: A full pipe or a saturated eventfd counter is already readable, so a failed write loses no wake-up.
+        const std::uint64_t wake_count = 1;
+
+#ifdef __linux__
+        [[maybe_unused]] const auto write_n = write(m_write_fd, &wake_count, sizeof(wake_count));
+#else
+        [[maybe_unused]] const auto write_n = write(m_write_fd, &wake_count, 1);
+#endif
+    }
+
+    void WakeSignal::drain() noexcept {
+        std::array<char, 64> sink;
+
+        while (read(m_read_fd, sink.data(), sink.size()) > 0) {}
+    }
+}
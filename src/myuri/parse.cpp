@@ -1,7 +1,6 @@
-#include <sstream>
+#include <charconv>
+#include <limits>
 #include <utility>
-#include <format>
-#include <stdexcept>
 
 #include "myuri/parse.hpp"
 
@@ -20,28 +19,25 @@ namespace DerkHttpd::Uri {
 
     auto Lexer::lex_encoded_char(std::string_view sv) noexcept -> Token {
         const auto temp_begin = m_pos;
-        auto hex_high = '\0';
-        auto hex_low = '\0';
 
         ++m_pos; // skip '%', assuming that the pre-check found it as a prefix!
 
-        if (const auto c0 = sv[m_pos]; !match_hex(c0)) {
-            return {temp_begin, 3, TokenTag::unknown};
-        } else {
-            hex_high = c0;
-            ++m_pos;
+        // Both hex digits must be present, as a truncated escape would otherwise read past the source.
+        if (m_end - m_pos < 2) {
+            m_pos = m_end;
+            return {temp_begin, m_end - temp_begin, TokenTag::unknown};
         }
 
-        if (const auto c1 = sv[m_pos]; !match_hex(c1)) {
+        const auto hex_high = hex_value(sv[m_pos]);
+        const auto hex_low = hex_value(sv[m_pos + 1]);
+
+        m_pos += 2;
+
+        if (hex_high < 0 || hex_low < 0) {
             return {temp_begin, 3, TokenTag::unknown};
-        } else {
-            hex_low = c1;
-            ++m_pos;
         }
 
-        int ascii_code = (static_cast<int>(hex_high) << 4) + static_cast<int>(hex_low);
-
-        return {temp_begin, static_cast<char>(ascii_code)};
+        return {temp_begin, static_cast<char>((hex_high << 4) | hex_low)};
     }
 
     auto Lexer::lex_textual(std::string_view src_sv) noexcept -> Token {
@@ -50,7 +46,7 @@ namespace DerkHttpd::Uri {
         auto slashes = 0;
 
         while (!at_eos()) {
-            if (const auto c = src_sv[m_pos]; match_alpha(c) || match_digit(c) || c == '.') {
+            if (const auto c = src_sv[m_pos]; match_alpha(c) || match_digit(c) || match_unreserved(c)) {
                 ++temp_len;
                 ++m_pos;
             } else if (c == '/') {
@@ -86,7 +82,7 @@ namespace DerkHttpd::Uri {
     }
 
     Lexer::Lexer(std::string_view str_sv) noexcept
-    : m_pos (0), m_end (str_sv.length()) {}
+    : m_pos (0), m_end (static_cast<int>(str_sv.length())) {}
 
     auto Lexer::operator()(std::string_view src_sv) noexcept -> Token {
         if (at_eos()) {
@@ -99,25 +95,17 @@ namespace DerkHttpd::Uri {
         case '&': return lex_single(TokenTag::query_delim);
         case '%': return lex_encoded_char(src_sv);
         default:
-            if (peeked == '/' || peeked == '.' || match_alpha(peeked)) {
+            if (peeked == '/' || match_alpha(peeked) || match_unreserved(peeked)) {
                 return lex_textual(src_sv);
             } else if (match_digit(peeked)) {
                 return lex_int(src_sv);
-            } else {   
+            } else {
                 return lex_single(TokenTag::unknown);
             }
         }
     }
 
 
-    void Parser::report_error(const Token& culprit) {
-        throw std::runtime_error {std::format("URI ERR: Syntax Error at [pos {}]:\nUnknown token!", culprit.begin)};
-    }
-
-    void Parser::report_error(const Token& culprit, const std::string& msg) {
-        throw std::runtime_error {std::format("URI ERR: Syntax Error at [pos {}]:\n{}", culprit.begin, msg)};
-    }
-
     auto Parser::advance(std::string_view uri_src, Lexer& lexer) noexcept -> Token {
         return lexer(uri_src);
     }
@@ -130,108 +118,150 @@ namespace DerkHttpd::Uri {
         return m_current.tag == TokenTag::eos;
     }
 
-    void Parser::clear_result() {
-        m_result = {};
-    }
+    void Parser::emit_current(std::string_view uri_src, Uri& result) noexcept {
+        auto& text = result.m_text;
 
-    auto Parser::parse_relative_uri(std::string_view uri_src, Lexer& lexer) -> Uri {
-        auto path = parse_path(uri_src, lexer);
+        if (m_current.tag == TokenTag::item_encoded_char) {
+            text[m_write_pos++] = m_current.as_pct_decoded_char();
+            return;
+        }
 
-        if (!m_current.match_tag_to(TokenTag::query_mark)) {
-            return Uri {std::move(path), {}};
+        // Without an earlier escape, the token already sits at the write position.
+        const auto lexeme = m_current.as_string_view(uri_src);
+
+        if (static_cast<int>(m_write_pos) != m_current.begin) {
+            lexeme.copy(text.data() + m_write_pos, lexeme.length());
         }
 
-        consume_of<TokenTag::query_mark>(uri_src, lexer);
+        m_write_pos += static_cast<std::uint32_t>(lexeme.length());
+    }
+
+    auto Parser::parse_text_run(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> TextSpan {
+        const auto run_begin = m_write_pos;
 
-        auto path_params = parse_query(uri_src, lexer);
+        while (m_current.match_tag_to(TokenTag::path, TokenTag::wordy, TokenTag::item_int, TokenTag::item_encoded_char)) {
+            emit_current(uri_src, result);
+            consume_any(uri_src, lexer);
+        }
 
-        return Uri {std::move(path), std::move(path_params)};
+        return {run_begin, m_write_pos - run_begin};
     }
 
-    auto Parser::parse_path(std::string_view uri_src, Lexer& lexer) -> std::string {
-        std::ostringstream sout;
+    auto Parser::parse_relative_uri(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> std::expected<void, UriError> {
+        result.m_path = parse_text_run(uri_src, lexer, result);
+
+        if (at_eos()) {
+            return {};
+        }
+
+        if (!m_current.match_tag_to(TokenTag::query_mark)) {
+            return std::unexpected {(m_current.as_string_view(uri_src).starts_with('%')) ? UriError::bad_escape : UriError::unknown_token};
+        }
+
+        consume_any(uri_src, lexer);
+
+        return parse_query(uri_src, lexer, result);
+    }
 
+    auto Parser::parse_query(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> std::expected<void, UriError> {
         while (!at_eos()) {
-            if (const auto current_tag = m_current.tag; current_tag == TokenTag::path) {
-                sout << std::format("{}", m_current.as_string_view(uri_src));
-                consume_any(uri_src, lexer);
-            } else if (current_tag == TokenTag::item_encoded_char) {
-                sout << m_current.unescaped;
-                consume_any(uri_src, lexer);
-            } else {
+            auto query_slot = parse_query_item(uri_src, lexer, result);
+
+            if (!query_slot) {
+                return std::unexpected {query_slot.error()};
+            }
+
+            if (result.m_query_n == max_query_params) {
+                return std::unexpected {UriError::too_many_params};
+            }
+
+            result.m_query[result.m_query_n++] = query_slot.value();
+
+            if (at_eos()) {
                 break;
             }
+
+            if (auto delim_ok = consume_of<TokenTag::query_delim>(uri_src, lexer, UriError::bad_query_item); !delim_ok) {
+                return delim_ok;
+            }
         }
 
-        return sout.str();
+        return {};
     }
 
-    auto Parser::parse_query(std::string_view uri_src, Lexer& lexer) -> std::map<std::string, QueryValue> {
-        std::map<std::string, QueryValue> params;
+    auto Parser::parse_query_item(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> std::expected<QuerySlot, UriError> {
+        const auto item_name = parse_text_run(uri_src, lexer, result);
 
-        while (!at_eos()) {
-            auto [item_name, item_value] = parse_query_item(uri_src, lexer);
+        if (item_name.length == 0) {
+            return std::unexpected {UriError::bad_query_item};
+        }
 
-            params.emplace(std::move(item_name), std::move(item_value));
+        if (auto assign_ok = consume_of<TokenTag::query_assign>(uri_src, lexer, UriError::bad_query_item); !assign_ok) {
+            return std::unexpected {assign_ok.error()};
+        }
 
-            if (!m_current.match_tag_to(TokenTag::query_delim)) {
-                continue;
-            }
+        auto item_value = parse_query_value(uri_src, lexer, result);
 
-            consume_any(uri_src, lexer);
+        if (!item_value) {
+            return std::unexpected {item_value.error()};
         }
 
-        return params;
+        return QuerySlot {.name = item_name, .value = item_value.value()};
     }
 
-    auto Parser::parse_query_item(std::string_view uri_src, Lexer& lexer) -> QueryPair {
-        std::string item_name = std::format("{}", m_current.as_string_view(uri_src));
-        consume_of<TokenTag::wordy>(uri_src, lexer);
+    auto Parser::parse_query_value(std::string_view uri_src, Lexer& lexer, Uri& result) noexcept -> std::expected<SlotValue, UriError> {
+        // 1. A lone integer token is stored as a number, while digits followed by more text stay textual e.g `v=2x`.
+        if (m_current.match_tag_to(TokenTag::item_int)) {
+            const auto digits = m_current.as_string_view(uri_src);
+            const auto value_begin = m_write_pos;
 
-        consume_of<TokenTag::query_assign>(uri_src, lexer);
+            emit_current(uri_src, result);
+            consume_any(uri_src, lexer);
 
-        auto item_value = parse_query_value(uri_src, lexer);
+            if (!m_current.match_tag_to(TokenTag::path, TokenTag::wordy, TokenTag::item_encoded_char)) {
+                int number = 0;
 
-        return {
-            .name = std::move(item_name),
-            .value = std::move(item_value),
-        };
-    }
+                if (const auto [num_end, num_err] = std::from_chars(digits.data(), digits.data() + digits.length(), number); num_err != std::errc {}) {
+                    return std::unexpected {UriError::bad_int};
+                }
+
+                return number;
+            }
 
-    auto Parser::parse_query_value(std::string_view uri_src, Lexer& lexer) -> QueryValue {
-        QueryValue val;
-        std::string lexeme = std::format("{}", m_current.as_string_view(uri_src));
+            const auto rest_span = parse_text_run(uri_src, lexer, result);
 
-        if (const auto current_tag = m_current.tag; current_tag == TokenTag::item_int) {
-            val = std::stoi(lexeme);
-        } else if (current_tag == TokenTag::wordy) {
-            val = std::move(lexeme);
+            return TextSpan {value_begin, rest_span.begin + rest_span.length - value_begin};
         }
 
-        consume_of<TokenTag::item_int, TokenTag::wordy>(uri_src, lexer);
-
-        return val;
+        // 2. Otherwise, the value is any run of text, which may be empty as in `flag=`.
+        return parse_text_run(uri_src, lexer, result);
     }
 
-    Parser::Parser()
-    : m_result {}, m_current {0, 0, TokenTag::unknown} {}
+    Parser::Parser() noexcept
+    : m_current {0, 0, TokenTag::unknown}, m_write_pos {0} {}
+
+    auto Parser::operator()(std::string_view uri_src, Lexer& lexer, std::pmr::memory_resource* resource) -> std::expected<Uri, UriError> {
+        if (uri_src.length() > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+            return std::unexpected {UriError::too_long};
+        }
+
+        Uri result {uri_src, resource};
 
-    auto Parser::operator()(std::string_view uri_src, Lexer& lexer) -> std::expected<Uri, std::string> {
         consume_any(uri_src, lexer);
 
-        try {
-            return parse_relative_uri(uri_src, lexer);
-        } catch (const std::runtime_error& parse_err) {
-            return std::unexpected {parse_err.what()};
+        if (auto parse_ok = parse_relative_uri(uri_src, lexer, result); !parse_ok) {
+            return std::unexpected {parse_ok.error()};
         }
+
+        return result;
     }
 
 
-    /// NOTE: This is the only intended helper function to parse relative URIs, using the current lexer & parser.
-    auto parse_simple_uri(std::string_view uri) -> std::expected<Uri, std::string> {
+    /// NOTE: This is the only intended helper function to parse relative URIs, using the current lexer & parser. The decoded copy of `uri` is allocated from `resource`.
+    auto parse_simple_uri(std::string_view uri, std::pmr::memory_resource* resource) -> std::expected<Uri, UriError> {
         Lexer tokenizer {uri};
         Parser parser;
 
-        return parser(uri, tokenizer);
+        return parser(uri, tokenizer, resource);
     }
 }
@@ -1,30 +1,46 @@
-#include <algorithm>
 #include <utility>
 
 #include "myuri/uri.hpp"
 
 namespace DerkHttpd::Uri {
     Uri::Uri()
-    : m_path {}, m_query {} {}
+    : m_text {}, m_path {0, 0}, m_query {}, m_query_n {0} {}
 
-    Uri::Uri(std::string rel_path, std::map<std::string, QueryValue> query_items) noexcept
-    : m_path (std::move(rel_path)), m_query (std::move(query_items)) {}
+    Uri::Uri(std::string_view source_text, std::pmr::memory_resource* resource)
+    : m_text {source_text, resource}, m_path {0, 0}, m_query {}, m_query_n {0} {}
 
-    auto Uri::path() const noexcept -> const std::string& {
-        return m_path;
+    auto Uri::path() const noexcept -> std::string_view {
+        return m_path.view_of(m_text);
     }
 
-    auto Uri::param(const std::string& name) const noexcept -> std::optional<const QueryValue*> {
-        if (auto param_result = std::find_if(m_query.begin(), m_query.end(), [&name](const auto& key_value) {
-            return key_value.first == name;
-        }); param_result != m_query.end()) {
-            return { &param_result->second };
-        }
+    auto Uri::param(std::string_view name) const noexcept -> std::optional<QueryValue> {
+        return params().get(name);
+    }
 
-        return {};
+    auto Uri::params() const noexcept -> QueryParams {
+        return {m_text, std::span<const QuerySlot> {m_query.data(), m_query_n}};
     }
 
-    auto Uri::params() const noexcept -> const std::map<std::string, QueryValue>& {
-        return m_query;
+    auto operator==(const Uri& lhs, const Uri& rhs) noexcept -> bool {
+        if (lhs.path() != rhs.path()) {
+            return false;
+        }
+
+        const auto lhs_params = lhs.params();
+        const auto rhs_params = rhs.params();
+
+        if (lhs_params.size() != rhs_params.size()) {
+            return false;
+        }
+
+        for (std::size_t item_idx = 0; item_idx < lhs_params.size(); ++item_idx) {
+            const auto [q_key, q_value] = lhs_params[item_idx];
+
+            if (rhs_params.get(q_key) != q_value) {
+                return false;
+            }
+        }
+
+        return true;
     }
 }
@@ -0,0 +1,252 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "mynet/handles.hpp"
+#include "myhttp/enums.hpp"
+#include "myhttp/msgs.hpp"
+#include "myuri/uri.hpp"
+#include "myapp/connection_pool.hpp"
+#include "myapp/msg_task.hpp"
+#include "myapp/static_routes.hpp"
+#include "myapp/vhosts.hpp"
+
+/**
+ * @brief Counts global heap allocations per typical GET exchange, by replacing the global `operator new`. The intake and routing stages must not allocate at all, as their headers and URI live in the connection's arena, so any allocation there makes this exit with 1. The whole exchange is only reported, since the queued response head and the `Date` text still come from the heap.
+ * @details usage: bench_allocs [exchanges]
+ */
+
+namespace {
+    std::atomic<std::size_t> global_alloc_n {0};
+
+    [[nodiscard]] auto counted_alloc(std::size_t n, std::size_t alignment) -> void* {
+        global_alloc_n.fetch_add(1, std::memory_order_relaxed);
+
+        const auto size = (n > 0) ? n : 1;
+        void* block_p = (alignment > alignof(std::max_align_t))
+            ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+            : std::malloc(size);
+
+        if (!block_p) {
+            throw std::bad_alloc {};
+        }
+
+        return block_p;
+    }
+}
+
+auto operator new(std::size_t n) -> void* {
+    return counted_alloc(n, alignof(std::max_align_t));
+}
+
+auto operator new(std::size_t n, std::align_val_t alignment) -> void* {
+    return counted_alloc(n, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* block_p) noexcept {
+    std::free(block_p);
+}
+
+void operator delete(void* block_p, [[maybe_unused]] std::size_t n) noexcept {
+    std::free(block_p);
+}
+
+void operator delete(void* block_p, [[maybe_unused]] std::align_val_t alignment) noexcept {
+    std::free(block_p);
+}
+
+void operator delete(void* block_p, [[maybe_unused]] std::size_t n, [[maybe_unused]] std::align_val_t alignment) noexcept {
+    std::free(block_p);
+}
+
+namespace {
+    using namespace DerkHttpd;
+
+    constexpr std::size_t default_exchanges = 10'000;
+    constexpr std::size_t outbound_high_water_n = 64 * 1024;
+
+    constexpr std::string_view typical_get =
+        "GET /lorem?page=2 HTTP/1.1\r\n"
+        "Host: localhost:8080\r\n"
+        "User-Agent: curl/8.5.0\r\n"
+        "Accept: */*\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n";
+
+    constexpr std::string_view lorem_text = "Lorem ipsum dolor sit amet, consectetur adipiscing elit.";
+
+    [[nodiscard]] auto serve_lorem(Http::Request& req, [[maybe_unused]] const Uri::QueryParams& query_params) -> Http::Response {
+        Http::Response res = req.make_response();
+
+        res.body = Http::StaticBytes {
+            .bytes = lorem_text,
+            .coded_variants = {},
+        };
+        res.headers.emplace("Content-Length", "56");
+        res.headers.emplace("Content-Type", "text/plain");
+        res.http_status = Http::Status::http_ok;
+
+        return res;
+    }
+
+    static_assert(lorem_text.size() == 56);
+
+    /// NOTE: Tallies the allocations of each stage across every measured exchange.
+    struct StageCounts {
+        std::size_t intake_n;
+        std::size_t dispatch_n;
+        std::size_t exchange_n;
+    };
+
+    template <typename Step>
+    [[nodiscard]] auto count_allocs(Step&& step) -> std::size_t {
+        const auto before_n = global_alloc_n.load(std::memory_order_relaxed);
+
+        step();
+
+        return global_alloc_n.load(std::memory_order_relaxed) - before_n;
+    }
+
+    /// NOTE: The completer sink of exchanges run without an executor, which report before the call returns.
+    void store_result(void* result_vp, Net::IOTaskResult result) noexcept {
+        *static_cast<Net::IOTaskResult*>(result_vp) = result;
+    }
+
+    [[nodiscard]] auto send_request(int client_fd) -> bool {
+        return send(client_fd, typical_get.data(), typical_get.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(typical_get.size());
+    }
+
+    /// NOTE: Empties the client's receive buffer, so the server's next flush never fills the socket.
+    void drain_response(int client_fd) {
+        char sink[4096];
+
+        while (recv(client_fd, sink, sizeof(sink), MSG_DONTWAIT) > 0) {}
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto exchanges = default_exchanges;
+
+    if (argc > 2) {
+        std::println(std::cerr, "usage: bench_allocs [exchanges]");
+        return 1;
+    }
+
+    if (argc == 2) {
+        try {
+            exchanges = std::stoul(argv[1]);
+        } catch (const std::exception& arg_err) {
+            std::println(std::cerr, "bench_allocs: invalid exchange count!");
+            return 1;
+        }
+    }
+
+    // 1. Set up one keep-alive connection over a socket pair, as the reactor would for an accepted client.
+    int sock_fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sock_fds) == -1) {
+        std::println(std::cerr, "bench_allocs: socketpair failed!");
+        return 1;
+    }
+
+    const auto [server_fd, client_fd] = sock_fds;
+
+    App::VirtualHosts hosts;
+    auto site_routes_p = hosts.add_host("localhost");
+
+    if (!site_routes_p) {
+        std::println(std::cerr, "bench_allocs: invalid host!");
+        return 1;
+    }
+
+    site_routes_p->use_static_table<App::StaticRouteTable<
+        App::StaticRoute<"/lorem", serve_lorem, Http::Verb::http_get>
+    >>();
+
+    auto conn_p = std::make_unique<App::ConnectionState>(Http::IntakeConfig {});
+    auto outbound_p = std::make_unique<Net::OutboundQueue>(outbound_high_water_n);
+    App::MsgExchangeTask<Net::IOTaskResult> exchange_task;
+    const Net::ConnectionId conn_id {.fd = server_fd, .generation = 0};
+
+    StageCounts counts {.intake_n = 0, .dispatch_n = 0, .exchange_n = 0};
+    auto all_ok = true;
+
+    // 2. Warm up once, so the host binding and the queue's first blocks are not counted, then measure the stages apart and whole.
+    for (std::size_t exchange_idx = 0; exchange_idx <= exchanges && all_ok; ++exchange_idx) {
+        const auto is_measured = exchange_idx > 0;
+
+        all_ok = send_request(client_fd);
+        conn_p->rewind_arena();
+
+        std::optional<Http::Request> req;
+        const auto intake_n = count_allocs([&] {
+            if (auto req_result = conn_p->intake(server_fd, &conn_p->arena); req_result) {
+                req.emplace(std::move(req_result.value()));
+            }
+        });
+
+        if (!req) {
+            all_ok = false;
+            break;
+        }
+
+        std::optional<Http::Response> res;
+        const auto dispatch_n = count_allocs([&] {
+            res.emplace(hosts.dispatch_handler(server_fd, req.value()));
+        });
+
+        all_ok = all_ok && res->http_status == Http::Status::http_ok;
+        res.reset();
+        req.reset();
+        conn_p->intake.release_body_budget();
+
+        all_ok = all_ok && send_request(client_fd);
+
+        Net::IOTaskResult exchange_result {.conn = conn_id, .ok = false};
+        const auto exchange_n = count_allocs([&] {
+            exchange_task(conn_id, *outbound_p, *conn_p, hosts, Net::TaskCompleter {store_result, &exchange_result, conn_id});
+        });
+
+        all_ok = all_ok && exchange_result.ok;
+
+        drain_response(client_fd);
+
+        if (is_measured) {
+            counts.intake_n += intake_n;
+            counts.dispatch_n += dispatch_n;
+            counts.exchange_n += exchange_n;
+        }
+    }
+
+    close(client_fd);
+    close(server_fd);
+
+    if (!all_ok) {
+        std::println(std::cerr, "bench_allocs: an exchange failed!");
+        return 1;
+    }
+
+    const auto per_exchange = [exchanges](std::size_t total_n) -> double {
+        return static_cast<double>(total_n) / static_cast<double>(exchanges);
+    };
+
+    std::println("bench_allocs: {} GET exchanges", exchanges);
+    std::println("  intake          {:6.2f} allocations / exchange", per_exchange(counts.intake_n));
+    std::println("  dispatch        {:6.2f} allocations / exchange", per_exchange(counts.dispatch_n));
+    std::println("  whole exchange  {:6.2f} allocations / exchange", per_exchange(counts.exchange_n));
+
+    return (counts.intake_n == 0 && counts.dispatch_n == 0) ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory_resource>
+#include <print>
+#include <string>
+#include <string_view>
+
+#include "myhttp/enums.hpp"
+#include "myhttp/msgs.hpp"
+#include "myuri/uri.hpp"
+#include "myapp/radix_router.hpp"
+#include "myapp/routes.hpp"
+#include "myapp/static_routes.hpp"
+
+/**
+ * @brief Benchmark of `StaticRouteTable` against the dynamic routes: times the bare path lookups, then whole `Routes::dispatch_handler` calls on routers holding the same exact paths.
+ * @details usage: bench_routes [iterations]
+ */
+
+namespace {
+    using namespace DerkHttpd;
+
+    constexpr std::size_t default_iterations = 1'000'000;
+
+    constexpr std::array<std::string_view, 8> bench_paths {
+        "/", "/lorem", "/about", "/contact", "/api/status", "/api/version", "/docs/index", "/health",
+    };
+
+    [[nodiscard]] auto bench_handler(Http::Request& req, [[maybe_unused]] const Uri::QueryParams& query_params) -> Http::Response {
+        Http::Response res = req.make_response();
+        res.http_status = Http::Status::http_ok;
+
+        return res;
+    }
+
+    using BenchTable = App::StaticRouteTable<
+        App::StaticRoute<"/", bench_handler, Http::Verb::http_get>,
+        App::StaticRoute<"/lorem", bench_handler, Http::Verb::http_get>,
+        App::StaticRoute<"/about", bench_handler, Http::Verb::http_get>,
+        App::StaticRoute<"/contact", bench_handler, Http::Verb::http_get>,
+        App::StaticRoute<"/api/status", bench_handler, Http::Verb::http_get>,
+        App::StaticRoute<"/api/version", bench_handler, Http::Verb::http_get>,
+        App::StaticRoute<"/docs/index", bench_handler, Http::Verb::http_get>,
+        App::StaticRoute<"/health", bench_handler, Http::Verb::http_get>
+    >;
+
+    /// NOTE: Runs `step` once per iteration over the paths in turn, giving the mean nanoseconds per call. Each step's result is folded into `sink`, so the optimizer cannot drop the calls.
+    template <typename Step>
+    [[nodiscard]] auto time_per_call(std::size_t iterations, std::uint64_t& sink, Step&& step) -> double {
+        const auto start_time = std::chrono::steady_clock::now();
+
+        for (std::size_t iter_idx = 0; iter_idx < iterations; ++iter_idx) {
+            sink += step(bench_paths[iter_idx % bench_paths.size()]);
+        }
+
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start_time;
+
+        return elapsed.count() / static_cast<double>(iterations);
+    }
+
+    [[nodiscard]] auto make_get_request(std::string_view path) -> Http::Request {
+        return Http::Request {
+            .body = {},
+            .headers = {},
+            .uri = std::pmr::string {path},
+            .http_verb = Http::Verb::http_get,
+            .http_schema = Http::Schema::http_1_1,
+        };
+    }
+}
+
+int main(int argc, char* argv[]) {
+    auto iterations = default_iterations;
+
+    if (argc > 2) {
+        std::println(std::cerr, "usage: bench_routes [iterations]");
+        return 1;
+    }
+
+    if (argc == 2) {
+        try {
+            iterations = std::stoul(argv[1]);
+        } catch (const std::exception& arg_err) {
+            std::println(std::cerr, "bench_routes: invalid iteration count!");
+            return 1;
+        }
+    }
+
+    // 1. Build the dynamic side from the same paths and handler as `BenchTable`.
+    App::RadixRouter radix_router;
+    App::Routes static_routes;
+    App::Routes dynamic_routes;
+
+    static_routes.use_static_table<BenchTable>();
+
+    for (std::size_t path_idx = 0; path_idx < bench_paths.size(); ++path_idx) {
+        const std::string path {bench_paths[path_idx]};
+
+        if (!radix_router.insert(path, path_idx) || !dynamic_routes.set_handler(Http::Verb::http_get, path, App::Middleware {bench_handler})) {
+            std::println(std::cerr, "bench_routes: failed to bind {}", path);
+            return 1;
+        }
+    }
+
+    std::uint64_t sink = 0;
+
+    // 2. Time the bare lookups, which is where the two paths differ.
+    const auto static_find_ns = time_per_call(iterations, sink, [](std::string_view path) noexcept -> std::uint64_t {
+        return static_cast<std::uint64_t>(!BenchTable::find(path).empty());
+    });
+
+    const auto radix_find_ns = time_per_call(iterations, sink, [&radix_router](std::string_view path) noexcept -> std::uint64_t {
+        App::RouteParams route_params;
+
+        return radix_router.find(path, route_params).value_or(0);
+    });
+
+    // 3. Time whole dispatches, including the URI parse and the response both sides share.
+    const auto dispatch_step = [](const App::Routes& routes) {
+        return [&routes](std::string_view path) -> std::uint64_t {
+            auto req = make_get_request(path);
+
+            return static_cast<std::uint64_t>(routes.dispatch_handler(req).http_status);
+        };
+    };
+
+    const auto static_dispatch_ns = time_per_call(iterations, sink, dispatch_step(static_routes));
+    const auto dynamic_dispatch_ns = time_per_call(iterations, sink, dispatch_step(dynamic_routes));
+
+    std::println("bench_routes: {} iterations over {} exact paths", iterations, bench_paths.size());
+    std::println("  lookup    static table {:8.1f} ns/op   radix router     {:8.1f} ns/op", static_find_ns, radix_find_ns);
+    std::println("  dispatch  static table {:8.1f} ns/op   dynamic handlers {:8.1f} ns/op", static_dispatch_ns, dynamic_dispatch_ns);
+    std::println("  (checksum {})", sink);
+}
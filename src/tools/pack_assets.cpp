@@ -0,0 +1,249 @@
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "myhttp/enums.hpp"
+#include "myapp/mime_types.hpp"
+
+/**
+ * @brief Build-time tool for `DERKHTTPD_EMBED_ASSETS`: packs every regular, non-hidden file under a directory into a generated translation unit that defines `DerkHttpd::App::embedded_asset_index()`.
+ * @details usage: pack_assets <asset-dir> <output.cpp>
+ */
+
+namespace {
+    using namespace DerkHttpd;
+
+    constexpr auto pack_zlib_level = 9;
+    constexpr auto zlib_window_bits = 15;
+    constexpr auto zlib_gzip_wrapper_bits = 16;
+    constexpr auto zlib_mem_level = 8;
+    constexpr auto literal_line_bytes = 32;
+
+    struct PackedAsset {
+        std::string uri_path;
+        std::string_view mime;
+        std::string etag;
+        std::string last_modified;
+        std::int64_t modify_epoch_s;
+        std::string identity;
+        std::array<std::optional<std::string>, Http::scoped_enum_len<Http::ContentCoding>()> coded_variants;
+    };
+
+    [[nodiscard]] auto compress_bytes(std::string_view input, int window_bits) -> std::optional<std::string> {
+        z_stream zs {};
+
+        if (deflateInit2(&zs, pack_zlib_level, Z_DEFLATED, window_bits, zlib_mem_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return {};
+        }
+
+        std::string output;
+        output.resize(deflateBound(&zs, static_cast<uLong>(input.size())));
+
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        zs.avail_in = static_cast<uInt>(input.size());
+        zs.next_out = reinterpret_cast<Bytef*>(output.data());
+        zs.avail_out = static_cast<uInt>(output.size());
+
+        const auto zlib_rc = deflate(&zs, Z_FINISH);
+
+        output.resize(zs.total_out);
+        deflateEnd(&zs);
+
+        if (zlib_rc != Z_STREAM_END) {
+            return {};
+        }
+
+        return output;
+    }
+
+    /// NOTE: A content hash makes the tag stable across rebuilds of unchanged assets, unlike the inode-based tags of on-disk files.
+    [[nodiscard]] auto make_content_etag(std::string_view bytes) noexcept -> std::string {
+        constexpr std::uint64_t fnv_offset = 0xcbf29ce484222325ULL;
+        constexpr std::uint64_t fnv_prime = 0x100000001b3ULL;
+
+        auto hash = fnv_offset;
+
+        for (const auto b : bytes) {
+            hash ^= static_cast<unsigned char>(b);
+            hash *= fnv_prime;
+        }
+
+        return std::format("\"e{:x}-{:x}\"", bytes.size(), hash);
+    }
+
+    /// NOTE: Octal escapes are at most 3 digits, so unlike `\x` escapes they never swallow a following digit.
+    void write_bytes_literal(std::ostream& out, std::string_view bytes) {
+        if (bytes.empty()) {
+            out << "\"\"";
+            return;
+        }
+
+        for (std::size_t line_pos = 0; line_pos < bytes.size(); line_pos += literal_line_bytes) {
+            out << "\n            \"";
+
+            for (const auto b : bytes.substr(line_pos, literal_line_bytes)) {
+                out << std::format("\\{:03o}", static_cast<unsigned char>(b));
+            }
+
+            out << '"';
+        }
+    }
+
+    [[nodiscard]] auto pack_file(const std::filesystem::path& file_path, const std::filesystem::path& root_dir) -> std::optional<PackedAsset> {
+        std::ifstream file_reader {file_path, std::ios::binary};
+
+        if (!file_reader) {
+            return {};
+        }
+
+        PackedAsset asset {
+            .uri_path = "/" + file_path.lexically_relative(root_dir).generic_string(),
+            .mime = App::lookup_mime_type(file_path.extension().string()),
+            .etag = {},
+            .last_modified = {},
+            .modify_epoch_s = 0,
+            .identity = std::string {std::istreambuf_iterator<char> {file_reader}, std::istreambuf_iterator<char> {}},
+            .coded_variants = {},
+        };
+
+        const auto modify_sys_time = std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::file_clock::to_sys(std::filesystem::last_write_time(file_path)));
+
+        asset.etag = make_content_etag(asset.identity);
+        asset.last_modified = std::format("{0:%a}, {0:%e} {0:%b} {0:%Y} {0:%H}:{0:%M}:{0:%S} UTC", modify_sys_time);
+        asset.modify_epoch_s = modify_sys_time.time_since_epoch().count();
+
+        // Only keep variants that actually shrink the asset, e.g already-compressed images are skipped.
+        const std::array<std::pair<Http::ContentCoding, int>, 2> packed_codings {{
+            {Http::ContentCoding::deflate, zlib_window_bits},
+            {Http::ContentCoding::gzip, zlib_window_bits + zlib_gzip_wrapper_bits},
+        }};
+
+        for (const auto& [coding, window_bits] : packed_codings) {
+            if (auto coded = compress_bytes(asset.identity, window_bits); coded && coded->size() < asset.identity.size()) {
+                asset.coded_variants[static_cast<std::size_t>(coding)] = std::move(coded);
+            }
+        }
+
+        return asset;
+    }
+
+    void write_bundle(std::ostream& out, const std::vector<PackedAsset>& assets, const std::filesystem::path& root_dir) {
+        std::println(out, "// Generated by pack_assets from {}: do not edit.", root_dir.generic_string());
+        std::println(out, "#include <algorithm>\n#include <array>\n\n#include \"myapp/embedded_assets.hpp\"\n");
+        std::println(out, "namespace DerkHttpd::App {{\n    namespace {{");
+
+        for (std::size_t asset_idx = 0; asset_idx < assets.size(); ++asset_idx) {
+            const auto& asset = assets[asset_idx];
+
+            out << std::format("        constexpr char asset_{}_identity[] =", asset_idx);
+            write_bytes_literal(out, asset.identity);
+            out << ";\n";
+
+            for (std::size_t coding_idx = 0; coding_idx < asset.coded_variants.size(); ++coding_idx) {
+                if (const auto& coded = asset.coded_variants[coding_idx]; coded) {
+                    out << std::format("        constexpr char asset_{}_coded_{}[] =", asset_idx, coding_idx);
+                    write_bytes_literal(out, coded.value());
+                    out << ";\n";
+                }
+            }
+        }
+
+        std::println(out, "\n        constexpr std::array<EmbeddedAsset, {}> asset_index {{{{", assets.size());
+
+        for (std::size_t asset_idx = 0; asset_idx < assets.size(); ++asset_idx) {
+            const auto& asset = assets[asset_idx];
+
+            std::println(out, "            EmbeddedAsset {{");
+            // File names may hold quotes or backslashes, so the path is escaped like the payloads.
+            out << "                .path = ";
+            write_bytes_literal(out, asset.uri_path);
+            out << ",\n";
+            std::println(out, "                .mime = \"{}\",", asset.mime);
+            std::println(out, "                .etag = R\"({})\",", asset.etag);
+            std::println(out, "                .last_modified = \"{}\",", asset.last_modified);
+            std::println(out, "                .modify_epoch_s = {},", asset.modify_epoch_s);
+            std::println(out, "                .identity = {{asset_{0}_identity, sizeof(asset_{0}_identity) - 1}},", asset_idx);
+            out << "                .coded_variants = {";
+
+            for (std::size_t coding_idx = 0; coding_idx < asset.coded_variants.size(); ++coding_idx) {
+                if (asset.coded_variants[coding_idx]) {
+                    out << std::format("std::string_view {{asset_{0}_coded_{1}, sizeof(asset_{0}_coded_{1}) - 1}}, ", asset_idx, coding_idx);
+                } else {
+                    out << "std::string_view {}, ";
+                }
+            }
+
+            std::println(out, "}},\n            }},");
+        }
+
+        std::println(out, "        }}}};\n");
+        std::println(out, "        static_assert(std::ranges::is_sorted(asset_index, {{}}, &EmbeddedAsset::path), \"pack_assets must emit assets sorted by path\");");
+        std::println(out, "    }}\n");
+        std::println(out, "    auto embedded_asset_index() noexcept -> std::span<const EmbeddedAsset> {{\n        return asset_index;\n    }}\n}}");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::println(std::cerr, "usage: pack_assets <asset-dir> <output.cpp>");
+        return 1;
+    }
+
+    std::error_code fs_err;
+    const auto root_dir = std::filesystem::canonical(argv[1], fs_err);
+
+    if (fs_err || !std::filesystem::is_directory(root_dir)) {
+        std::println(std::cerr, "pack_assets ERR: {} is not a directory.", argv[1]);
+        return 1;
+    }
+
+    std::vector<PackedAsset> assets;
+
+    for (auto entry_it = std::filesystem::recursive_directory_iterator {root_dir}; entry_it != std::filesystem::recursive_directory_iterator {}; ++entry_it) {
+        // Hidden files and directories are never served, matching `StaticMount::resolve`.
+        if (entry_it->path().filename().string().starts_with('.')) {
+            if (entry_it->is_directory()) {
+                entry_it.disable_recursion_pending();
+            }
+
+            continue;
+        }
+
+        if (!entry_it->is_regular_file()) {
+            continue;
+        }
+
+        if (auto packed = pack_file(entry_it->path(), root_dir); packed) {
+            assets.push_back(std::move(packed.value()));
+        } else {
+            std::println(std::cerr, "pack_assets ERR: could not read {}.", entry_it->path().string());
+            return 1;
+        }
+    }
+
+    std::ranges::sort(assets, {}, &PackedAsset::uri_path);
+
+    std::ofstream bundle_writer {argv[2], std::ios::trunc};
+
+    if (!bundle_writer) {
+        std::println(std::cerr, "pack_assets ERR: could not write {}.", argv[2]);
+        return 1;
+    }
+
+    write_bundle(bundle_writer, assets, root_dir);
+
+    return bundle_writer.good() ? 0 : 1;
+}